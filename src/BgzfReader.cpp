@@ -0,0 +1,237 @@
+#include "BgzfReader.h"
+
+const unsigned int BgzfReader::MAX_BLOCK_SIZE = 65536u;
+const unsigned int BgzfReader::DEFAULT_MAX_BLOCKS = 64u;
+
+static inline unsigned int read_le16(const unsigned char* bytes) {
+    return (unsigned int)bytes[0] | ((unsigned int)bytes[1] << 8u);
+}
+
+static inline unsigned int read_le32(const unsigned char* bytes) {
+    return (unsigned int)bytes[0] | ((unsigned int)bytes[1] << 8u) | ((unsigned int)bytes[2] << 16u) | ((unsigned int)bytes[3] << 24u);
+}
+
+bool BgzfReader::is_bgzf(const string& file_name) {
+    unsigned char header[18];
+    size_t n = 0u;
+    FILE* f = fopen(file_name.c_str(), "rb");
+
+    if (f == nullptr) {
+        return false;
+    }
+    n = fread(header, 1u, 18u, f);
+    fclose(f);
+    // gzip member with FEXTRA, XLEN = 6 and a single 'BC' subfield holding the block size
+    return (n == 18u) && (header[0] == 31u) && (header[1] == 139u) && (header[2] == 8u) && ((header[3] & 4u) != 0u) &&
+           (read_le16(header + 10) == 6u) && (header[12] == 'B') && (header[13] == 'C') && (read_le16(header + 14) == 2u);
+}
+
+BgzfReader::BgzfReader(unsigned int max_blocks) noexcept(false): file(nullptr), file_eof(false), file_offset(0u), max_blocks(max_blocks), compressed(nullptr), data(nullptr), data_size(0u), streams(nullptr), n_streams(0) {
+    try {
+        compressed = new unsigned char[max_blocks * MAX_BLOCK_SIZE];
+        data = new char[max_blocks * MAX_BLOCK_SIZE];
+    } catch (bad_alloc& e) {
+        delete[] compressed;
+        compressed = nullptr;
+        throw runtime_error("Error in memory allocation");
+    }
+    blocks.reserve(max_blocks);
+}
+
+BgzfReader::~BgzfReader() {
+    delete[] compressed;
+    compressed = nullptr;
+    delete[] data;
+    data = nullptr;
+    for (int i = 0; i < n_streams; ++i) {
+        inflateEnd(&streams[i]);
+    }
+    delete[] streams;
+    streams = nullptr;
+    if (file != nullptr) {
+        fclose(file);
+        file = nullptr;
+    }
+}
+
+void BgzfReader::open(const string& file_name) noexcept(false) {
+    if (file == nullptr) {
+        this->file_name = file_name;
+        file = fopen(file_name.c_str(), "rb");
+        if (file == nullptr) {
+            throw runtime_error("Error while opening '" + file_name + "' file.");
+        }
+        file_eof = false;
+        file_offset = 0u;
+        data_size = 0u;
+    }
+}
+
+void BgzfReader::close() noexcept(false) {
+    if (file != nullptr) {
+        int status = fclose(file);
+        file = nullptr;
+        if (status != 0) {
+            throw runtime_error("Error while closing '" + file_name + "' file.");
+        }
+    }
+}
+
+void BgzfReader::reset() noexcept(false) {
+    if (fseek(file, 0L, SEEK_SET) != 0) {
+        throw runtime_error("Error while resetting '" + file_name + "' file.");
+    }
+    file_eof = false;
+    file_offset = 0u;
+    data_size = 0u;
+}
+
+bool BgzfReader::eof() {
+    return file_eof;
+}
+
+const char* BgzfReader::get_data() {
+    return data;
+}
+
+// Reads gzip member header. Returns number of header bytes (0 at the end of file) and sets total size of the block.
+int BgzfReader::read_block_header(unsigned int& block_size) noexcept(false) {
+    unsigned char header[12];
+    unsigned char extra[MAX_BLOCK_SIZE];
+    unsigned int extra_length = 0u, subfield_length = 0u;
+    size_t n = fread(header, 1u, 12u, file);
+
+    if ((n == 0u) && (feof(file) != 0)) {
+        return 0;
+    }
+    if ((n != 12u) || (header[0] != 31u) || (header[1] != 139u) || (header[2] != 8u) || ((header[3] & 4u) == 0u)) {
+        throw runtime_error("Error while reading BGZF block header from '" + file_name + "' file.");
+    }
+    extra_length = read_le16(header + 10);
+    if (fread(extra, 1u, extra_length, file) != extra_length) {
+        throw runtime_error("Error while reading BGZF block header from '" + file_name + "' file.");
+    }
+    block_size = 0u;
+    for (unsigned int i = 0u; i + 4u <= extra_length; i += 4u + subfield_length) {
+        subfield_length = read_le16(extra + i + 2);
+        if ((extra[i] == 'B') && (extra[i + 1] == 'C') && (subfield_length == 2u)) {
+            block_size = read_le16(extra + i + 4) + 1u;
+            break;
+        }
+    }
+    if (block_size < 12u + extra_length + 8u) {
+        throw runtime_error("Error while reading BGZF block header from '" + file_name + "' file.");
+    }
+    return 12 + (int)extra_length;
+}
+
+// Reads up to max_blocks compressed blocks and inflates them on n_threads threads.
+// Returns the number of decompressed bytes available through get_data() (0 at the end of file).
+int BgzfReader::fill(int n_threads) noexcept(false) {
+    unsigned int block_size = 0u, used = 0u, payload_size = 0u;
+    int header_size = 0;
+    bool failed = false;
+
+    if (n_threads < 1) {
+        n_threads = 1;
+    }
+    if (n_threads > n_streams) { // z_stream can't be moved after inflateInit, so we re-create all of them
+        for (int i = 0; i < n_streams; ++i) {
+            inflateEnd(&streams[i]);
+        }
+        delete[] streams;
+        streams = new z_stream[n_threads];
+        for (n_streams = 0; n_streams < n_threads; ++n_streams) {
+            memset(&streams[n_streams], 0, sizeof(z_stream));
+            if (inflateInit2(&streams[n_streams], -15) != Z_OK) { // raw deflate data
+                throw runtime_error("Error while initializing decompression of '" + file_name + "' file.");
+            }
+        }
+    }
+
+    data_size = 0u;
+    while ((data_size == 0u) && !file_eof) { // skip batches of empty blocks (e.g. the EOF marker)
+        blocks.clear();
+        used = 0u;
+        while (blocks.size() < max_blocks) {
+            if ((header_size = read_block_header(block_size)) == 0) {
+                file_eof = true;
+                break;
+            }
+            payload_size = block_size - (unsigned int)header_size;
+            if (fread(compressed + used, 1u, payload_size, file) != payload_size) {
+                throw runtime_error("Error while reading BGZF block from '" + file_name + "' file.");
+            }
+            Block block;
+            block.file_offset = file_offset;
+            block.data_offset = 0u;
+            block.compressed_offset = used;
+            block.compressed_size = payload_size - 8u;
+            block.crc = read_le32(compressed + used + block.compressed_size);
+            block.size = read_le32(compressed + used + block.compressed_size + 4u);
+            block.status = Z_OK;
+            if (block.size > MAX_BLOCK_SIZE) {
+                throw runtime_error("Error while reading BGZF block from '" + file_name + "' file.");
+            }
+            blocks.push_back(block);
+            used += payload_size;
+            file_offset += block_size;
+        }
+
+        #pragma omp parallel for num_threads(n_threads) schedule(dynamic)
+        for (int i = 0; i < (int)blocks.size(); ++i) {
+            int thread = 0;
+#ifdef _OPENMP
+            thread = omp_get_thread_num();
+#endif
+            z_stream& stream = streams[thread];
+            char* out = data + (size_t)i * MAX_BLOCK_SIZE;
+            inflateReset(&stream);
+            stream.next_in = compressed + blocks[i].compressed_offset;
+            stream.avail_in = blocks[i].compressed_size;
+            stream.next_out = (Bytef*)out;
+            stream.avail_out = MAX_BLOCK_SIZE;
+            blocks[i].status = inflate(&stream, Z_FINISH);
+            if ((blocks[i].status == Z_STREAM_END) && (stream.total_out == blocks[i].size) && (crc32(0L, (const Bytef*)out, blocks[i].size) == blocks[i].crc)) {
+                blocks[i].status = Z_OK;
+            } else {
+                blocks[i].status = Z_DATA_ERROR;
+            }
+        }
+
+        for (unsigned int i = 0u; i < blocks.size(); ++i) { // compact inflated blocks, keeping their order
+            if (blocks[i].status != Z_OK) {
+                failed = true;
+                break;
+            }
+            memmove(data + data_size, data + (size_t)i * MAX_BLOCK_SIZE, blocks[i].size);
+            blocks[i].data_offset = data_size;
+            data_size += blocks[i].size;
+        }
+        if (failed) {
+            throw runtime_error("Error while decompressing BGZF block from '" + file_name + "' file.");
+        }
+    }
+    return (int)data_size;
+}
+
+uint64_t BgzfReader::get_virtual_offset(unsigned int data_position) {
+    // last block which starts at or before the position (empty blocks share data offset with the next block)
+    auto block = upper_bound(blocks.begin(), blocks.end(), data_position, [](unsigned int position, const Block& b) { return position < b.data_offset; });
+    if (block != blocks.begin()) {
+        --block;
+    }
+    return (block->file_offset << 16u) | (data_position - block->data_offset);
+}
+
+// Moves to the given virtual offset and inflates the next batch of blocks. Returns the number of decompressed bytes
+// available through get_data(), starting with the block that contains the virtual offset.
+int BgzfReader::seek(uint64_t virtual_offset, int n_threads) noexcept(false) {
+    file_offset = virtual_offset >> 16u;
+    if (fseek(file, (long int)file_offset, SEEK_SET) != 0) {
+        throw runtime_error("Error while seeking in '" + file_name + "' file.");
+    }
+    file_eof = false;
+    data_size = 0u;
+    return fill(n_threads);
+}
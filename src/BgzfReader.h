@@ -0,0 +1,71 @@
+#ifndef LASER_BGZFREADER_H
+#define LASER_BGZFREADER_H
+
+#include <iostream>
+#include <string>
+#include <stdexcept>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <zlib.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+
+// Reads BGZF files (series of independent gzip blocks, each at most 64 KB) and inflates batches of blocks in parallel.
+class BgzfReader {
+
+private:
+    struct Block {
+        unsigned int compressed_offset; // offset of the block payload inside the compressed buffer
+        unsigned int compressed_size;   // size of the raw deflate payload
+        unsigned int size;              // size after inflate (ISIZE)
+        unsigned int crc;
+        int status;
+        uint64_t file_offset;           // offset of the block in the file
+        unsigned int data_offset;       // offset of the inflated block inside the data buffer
+    };
+
+    string file_name;
+    FILE* file;
+    bool file_eof;
+    uint64_t file_offset; // offset of the next block to read
+
+    unsigned int max_blocks; // number of blocks inflated per batch
+    unsigned char* compressed;
+    char* data;
+    unsigned int data_size;
+    vector<Block> blocks;
+    z_stream* streams; // one inflate stream per thread
+    int n_streams;
+
+    int read_block_header(unsigned int& block_size) noexcept(false);
+
+public:
+    static const unsigned int MAX_BLOCK_SIZE;
+    static const unsigned int DEFAULT_MAX_BLOCKS;
+
+    static bool is_bgzf(const string& file_name);
+
+    BgzfReader(unsigned int max_blocks = DEFAULT_MAX_BLOCKS) noexcept(false);
+    virtual ~BgzfReader();
+
+    void open(const string& file_name) noexcept(false);
+    void close() noexcept(false);
+    void reset() noexcept(false);
+    bool eof();
+
+    int fill(int n_threads) noexcept(false);
+    const char* get_data();
+
+    // Virtual offsets follow the BGZF convention: block offset in the file << 16 | offset inside the inflated block.
+    uint64_t get_virtual_offset(unsigned int data_position);
+    int seek(uint64_t virtual_offset, int n_threads) noexcept(false);
+};
+
+
+#endif //LASER_BGZFREADER_H
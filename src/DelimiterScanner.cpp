@@ -0,0 +1,305 @@
+#include "DelimiterScanner.h"
+#include <cstring>
+#include <algorithm>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#include <immintrin.h>
+#define LASER_SCAN_SSE2
+#if defined(__GNUC__) // GCC and Clang can compile AVX2 functions without -mavx2 and pick them at run time
+#define LASER_SCAN_AVX2
+#endif
+#endif
+
+namespace {
+
+#ifdef LASER_SCAN_AVX2
+// Detected on first use: __builtin_cpu_supports needs __builtin_cpu_init if it may run before the constructors of libgcc,
+// as in static initializers.
+bool has_avx2() {
+    static const bool supported = []() {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+    }();
+    return supported;
+}
+
+__attribute__((target("avx2"))) const char* find_line_end_avx2(const char* begin, const char* end) {
+    const __m256i lf = _mm256_set1_epi8('\n');
+    const __m256i cr = _mm256_set1_epi8('\r');
+    for (; begin + 32 <= end; begin += 32) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i*)begin);
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, lf), _mm256_cmpeq_epi8(chunk, cr)));
+        if (mask != 0u) {
+            return begin + __builtin_ctz(mask);
+        }
+    }
+    for (; (begin < end) && (*begin != '\n') && (*begin != '\r'); ++begin);
+    return begin;
+}
+
+__attribute__((target("avx2"))) size_t count_avx2(const char* begin, const char* end, char c) {
+    const __m256i value = _mm256_set1_epi8(c);
+    size_t n = 0u;
+    for (; begin + 32 <= end; begin += 32) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i*)begin);
+        n += (size_t)__builtin_popcount((unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, value)));
+    }
+    for (; begin < end; ++begin) {
+        n += (*begin == c);
+    }
+    return n;
+}
+
+template <typename Sink> __attribute__((target("avx2"))) char* split_avx2(char* begin, char* end, char separator, Sink& sink) {
+    const __m256i value = _mm256_set1_epi8(separator);
+    char* field = begin;
+    char* position = nullptr;
+    for (; begin + 32 <= end; begin += 32) {
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)begin), value));
+        while (mask != 0u) { // one bit per separator in this chunk
+            position = begin + __builtin_ctz(mask);
+            *position = '\0';
+            sink(field);
+            field = position + 1;
+            mask &= mask - 1u;
+        }
+    }
+    for (; begin < end; ++begin) {
+        if (*begin == separator) {
+            *begin = '\0';
+            sink(field);
+            field = begin + 1;
+        }
+    }
+    return field;
+}
+
+template <typename Sink> __attribute__((target("avx2"))) void find_separators_avx2(const char* begin, const char* end, char separator, Sink& sink) {
+    const __m256i value = _mm256_set1_epi8(separator);
+    for (; begin + 32 <= end; begin += 32) {
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)begin), value));
+        while (mask != 0u) {
+            if (!sink(begin + __builtin_ctz(mask))) {
+                return;
+            }
+            mask &= mask - 1u;
+        }
+    }
+    for (; begin < end; ++begin) {
+        if ((*begin == separator) && !sink(begin)) {
+            return;
+        }
+    }
+}
+#endif
+
+#ifdef LASER_SCAN_SSE2
+const char* find_line_end_sse2(const char* begin, const char* end) {
+    const __m128i lf = _mm_set1_epi8('\n');
+    const __m128i cr = _mm_set1_epi8('\r');
+    for (; begin + 16 <= end; begin += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)begin);
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, lf), _mm_cmpeq_epi8(chunk, cr)));
+        if (mask != 0u) {
+            return begin + __builtin_ctz(mask);
+        }
+    }
+    for (; (begin < end) && (*begin != '\n') && (*begin != '\r'); ++begin);
+    return begin;
+}
+
+size_t count_sse2(const char* begin, const char* end, char c) {
+    const __m128i value = _mm_set1_epi8(c);
+    size_t n = 0u;
+    for (; begin + 16 <= end; begin += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)begin);
+        n += (size_t)__builtin_popcount((unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, value)));
+    }
+    for (; begin < end; ++begin) {
+        n += (*begin == c);
+    }
+    return n;
+}
+
+template <typename Sink> char* split_sse2(char* begin, char* end, char separator, Sink& sink) {
+    const __m128i value = _mm_set1_epi8(separator);
+    char* field = begin;
+    char* position = nullptr;
+    for (; begin + 16 <= end; begin += 16) {
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)begin), value));
+        while (mask != 0u) {
+            position = begin + __builtin_ctz(mask);
+            *position = '\0';
+            sink(field);
+            field = position + 1;
+            mask &= mask - 1u;
+        }
+    }
+    for (; begin < end; ++begin) {
+        if (*begin == separator) {
+            *begin = '\0';
+            sink(field);
+            field = begin + 1;
+        }
+    }
+    return field;
+}
+
+template <typename Sink> void find_separators_sse2(const char* begin, const char* end, char separator, Sink& sink) {
+    const __m128i value = _mm_set1_epi8(separator);
+    for (; begin + 16 <= end; begin += 16) {
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)begin), value));
+        while (mask != 0u) {
+            if (!sink(begin + __builtin_ctz(mask))) {
+                return;
+            }
+            mask &= mask - 1u;
+        }
+    }
+    for (; begin < end; ++begin) {
+        if ((*begin == separator) && !sink(begin)) {
+            return;
+        }
+    }
+}
+#endif
+
+template <typename Sink> char* split_scalar(char* begin, char* end, char separator, Sink& sink) {
+    char* field = begin;
+    for (; begin < end; ++begin) {
+        if (*begin == separator) {
+            *begin = '\0';
+            sink(field);
+            field = begin + 1;
+        }
+    }
+    return field;
+}
+
+template <typename Sink> void find_separators_scalar(const char* begin, const char* end, char separator, Sink& sink) {
+    for (; begin < end; ++begin) {
+        if ((*begin == separator) && !sink(begin)) {
+            return;
+        }
+    }
+}
+
+// Splits with the fastest available implementation; sink is called with the start of every field that ends with a separator.
+template <typename Sink> char* split_fields(char* begin, char* end, char separator, Sink& sink) {
+#ifdef LASER_SCAN_AVX2
+    if (has_avx2()) {
+        return split_avx2(begin, end, separator, sink);
+    }
+#endif
+#ifdef LASER_SCAN_SSE2
+    return split_sse2(begin, end, separator, sink);
+#else
+    return split_scalar(begin, end, separator, sink);
+#endif
+}
+
+// Same for read-only input; sink is called with the position of every separator and returns false to stop the scan.
+template <typename Sink> void find_separators(const char* begin, const char* end, char separator, Sink& sink) {
+#ifdef LASER_SCAN_AVX2
+    if (has_avx2()) {
+        find_separators_avx2(begin, end, separator, sink);
+        return;
+    }
+#endif
+#ifdef LASER_SCAN_SSE2
+    find_separators_sse2(begin, end, separator, sink);
+#else
+    find_separators_scalar(begin, end, separator, sink);
+#endif
+}
+
+}
+
+const char* DelimiterScanner::find_line_end(const char* begin, const char* end) {
+#ifdef LASER_SCAN_AVX2
+    if (has_avx2()) {
+        return find_line_end_avx2(begin, end);
+    }
+#endif
+#ifdef LASER_SCAN_SSE2
+    return find_line_end_sse2(begin, end);
+#else
+    for (; (begin < end) && (*begin != '\n') && (*begin != '\r'); ++begin);
+    return begin;
+#endif
+}
+
+size_t DelimiterScanner::count(const char* begin, const char* end, char c) {
+#ifdef LASER_SCAN_AVX2
+    if (has_avx2()) {
+        return count_avx2(begin, end, c);
+    }
+#endif
+#ifdef LASER_SCAN_SSE2
+    return count_sse2(begin, end, c);
+#else
+    size_t n = 0u;
+    for (; begin < end; ++begin) {
+        n += (*begin == c);
+    }
+    return n;
+#endif
+}
+
+char* DelimiterScanner::split(char* begin, char* end, char separator, vector<char*>& fields) {
+    auto sink = [&fields](char* field) { fields.push_back(field); };
+    return split_fields(begin, end, separator, sink);
+}
+
+char* DelimiterScanner::split(char* begin, char* end, char separator, const vector<bool>& selected, vector<char*>& fields) {
+    size_t column = 0u;
+    size_t n_selected = selected.size();
+    char* field = nullptr;
+    auto sink = [&](char* field) {
+        if ((column < n_selected) && selected[column]) {
+            fields.push_back(field);
+        }
+        ++column;
+    };
+    field = split_fields(begin, end, separator, sink);
+    return ((column < n_selected) && selected[column]) ? field : nullptr;
+}
+
+void DelimiterScanner::select(const char* begin, const char* end, char separator, const vector<bool>& selected, size_t& column,
+                              vector<char>& out, size_t& used, vector<size_t>& offsets) {
+    size_t n_selected = selected.size();
+    const char* run = nullptr; // consecutive selected fields are copied at once, together with the separators between them
+    auto terminate = [](char*) { };
+    auto copy = [&](const char* run_end) {
+        size_t length = (size_t)(run_end - run);
+        if (used + length + 1u > out.size()) {
+            out.resize(max(used + length + 1u, 2u * out.size()));
+        }
+        memcpy(out.data() + used, run, length);
+        split_fields(out.data() + used, out.data() + used + length, separator, terminate); // separators become '\0'
+        used += length;
+    };
+    auto sink = [&](const char* position) -> bool {
+        ++column;
+        if ((column < n_selected) && selected[column]) {
+            if (run == nullptr) {
+                run = position + 1;
+            }
+            offsets.push_back(used + (size_t)(position + 1 - run));
+        } else if (run != nullptr) {
+            copy(position + 1);
+            run = nullptr;
+        }
+        return column < n_selected; // the rest of the line has no selected columns
+    };
+    if (column >= n_selected) { // nothing else is selected in this line
+        return;
+    }
+    if (selected[column]) {
+        run = begin;
+    }
+    find_separators(begin, end, separator, sink);
+    if (run != nullptr) {
+        copy(end);
+    }
+}
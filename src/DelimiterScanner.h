@@ -0,0 +1,35 @@
+#ifndef LASER_DELIMITERSCANNER_H
+#define LASER_DELIMITERSCANNER_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+// Locates delimiters in text buffers 32 (AVX2) or 16 (SSE2) bytes at a time using compare-and-movemask, with a
+// scalar fallback on other platforms. AVX2 is used only if the CPU supports it, so no special build flags are needed.
+class DelimiterScanner {
+
+public:
+    // Returns position of the first '\n' or '\r' in [begin, end), or end if there is none.
+    static const char* find_line_end(const char* begin, const char* end);
+    // Returns number of c characters in [begin, end).
+    static size_t count(const char* begin, const char* end, char c);
+    // Replaces every separator in [begin, end) with '\0' and appends start of each field that ends with a separator
+    // to fields. Returns start of the last field (the one after the last separator).
+    static char* split(char* begin, char* end, char separator, vector<char*>& fields);
+    // Same as above, but only fields whose 0-based column is set in selected are appended (in the order of columns).
+    // Returns start of the last field if its column is selected, and nullptr otherwise.
+    static char* split(char* begin, char* end, char separator, const vector<bool>& selected, vector<char*>& fields);
+    // Copies a part [begin, end) of a line without modifying it: fields whose 0-based column is set in selected are
+    // written to out at used (out grows if needed) and terminated by '\0', and the offset in out of every selected field
+    // that starts after a separator is appended to offsets. column is the column of the field at begin and is moved past
+    // every separator (scanning stops at the separator after the last selected column). The field at end isn't terminated,
+    // because it may continue in the next part.
+    static void select(const char* begin, const char* end, char separator, const vector<bool>& selected, size_t& column,
+                       vector<char>& out, size_t& used, vector<size_t>& offsets);
+};
+
+
+#endif //LASER_DELIMITERSCANNER_H
@@ -0,0 +1,302 @@
+#include "MultiTableReader.h"
+
+static const int BATCH_ROWS = 4096;
+static const size_t BATCH_BYTES = 67108864u;
+
+MultiTableReader::MultiTableReader(unsigned int index_columns): index_columns(index_columns), row(0), selected(nullptr), selected_size(0u), selected_ids(0u) {
+
+}
+
+MultiTableReader::~MultiTableReader() {
+
+}
+
+void MultiTableReader::set_file_name(const string& file_names) {
+    this->file_names = split_file_list(file_names);
+}
+
+const string& MultiTableReader::get_file_name() {
+    return file_names.front();
+}
+
+size_t MultiTableReader::get_n_files() {
+    return file_names.size();
+}
+
+void MultiTableReader::open() noexcept(false) {
+    close();
+    for (auto&& file_name: file_names) {
+        readers.emplace_back(new TableReader());
+        readers.back()->set_file_name(file_name);
+        readers.back()->open();
+    }
+    file_tokens.resize(readers.size());
+    n_columns.assign(readers.size(), 0u);
+    if (readers.size() > 1u) { // number of columns in every file is needed to split the combined columns between files
+        for (size_t f = 0u; f < readers.size(); ++f) {
+            if (readers[f]->read_row(file_tokens[f], '\t') >= 0) {
+                n_columns[f] = file_tokens[f].size();
+            }
+            readers[f]->reset();
+        }
+    }
+    row = 0;
+}
+
+void MultiTableReader::close() noexcept(false) {
+    for (auto&& reader: readers) {
+        reader->close();
+    }
+    readers.clear();
+    selected = nullptr;
+    selected_size = 0u;
+}
+
+void MultiTableReader::reset() noexcept(false) {
+    for (auto&& reader: readers) {
+        reader->reset();
+    }
+    row = 0;
+}
+
+bool MultiTableReader::is_open() {
+    return !readers.empty() && readers.front()->is_open();
+}
+
+void MultiTableReader::select_columns(const vector<bool>& columns) {
+    size_t first = 0u; // combined column of the first data column of the file
+
+    if ((selected == &columns) && (selected_size == columns.size())) {
+        return;
+    }
+    selected = &columns;
+    selected_size = columns.size();
+    selected_ids = 0u;
+    for (size_t c = 0u; (c < index_columns) && (c < columns.size()); ++c) {
+        selected_ids += columns[c] ? 1u : 0u;
+    }
+    file_selected.resize(readers.size());
+    file_selected[0].assign(columns.begin(), columns.end());
+    first = n_columns[0];
+    for (size_t f = 1u; f < readers.size(); ++f) {
+        vector<bool>& file_columns = file_selected[f];
+        file_columns.assign(n_columns[f], false);
+        for (size_t c = 0u; c < n_columns[f]; ++c) {
+            size_t column = (c < index_columns) ? c : first + c - index_columns;
+            file_columns[c] = (column < columns.size()) && columns[column];
+        }
+        first += (n_columns[f] > index_columns) ? n_columns[f] - index_columns : 0u;
+    }
+}
+
+long int MultiTableReader::read_files(char separator, const vector<bool>* columns) noexcept(false) {
+    long int length = 0, n = 0;
+
+    for (size_t f = 0u; f < readers.size(); ++f) {
+        n = (columns == nullptr) ? readers[f]->read_row(file_tokens[f], separator) : readers[f]->read_row(file_tokens[f], separator, file_selected[f]);
+        if ((f > 0u) && ((n < 0) != (length < 0))) {
+            throw runtime_error("Files '" + file_names[0] + "' and '" + file_names[f] + "' have different numbers of rows.");
+        }
+        length = (n < 0) ? n : length + n;
+    }
+    return length;
+}
+
+void MultiTableReader::combine(vector<char*>& tokens, size_t n_ids) noexcept(false) {
+    const vector<char*>& first = file_tokens[0];
+
+    tokens.assign(first.begin(), first.end());
+    for (size_t f = 1u; f < readers.size(); ++f) {
+        const vector<char*>& file = file_tokens[f];
+        size_t ids = (file.size() < n_ids) ? file.size() : n_ids;
+        bool same = (ids == ((first.size() < n_ids) ? first.size() : n_ids));
+        for (size_t c = 0u; same && (c < ids); ++c) {
+            same = (strcmp(file[c], first[c]) == 0);
+        }
+        if (!same) {
+            throw runtime_error("Sample IDs in row " + to_string(row) + " of '" + file_names[f] + "' don't match '" + file_names[0] + "'.");
+        }
+        tokens.insert(tokens.end(), file.begin() + ids, file.end());
+    }
+}
+
+long int MultiTableReader::read_row(vector<char*>& tokens, char separator) noexcept(false) {
+    long int length = 0;
+
+    if (readers.size() == 1u) {
+        return readers[0]->read_row(tokens, separator);
+    }
+    tokens.clear();
+    if ((length = read_files(separator, nullptr)) < 0) {
+        return length;
+    }
+    ++row;
+    combine(tokens, index_columns);
+    return length;
+}
+
+long int MultiTableReader::read_row(vector<char*>& tokens, char separator, const vector<bool>& columns) noexcept(false) {
+    long int length = 0;
+
+    if (readers.size() == 1u) {
+        return readers[0]->read_row(tokens, separator, columns);
+    }
+    tokens.clear();
+    select_columns(columns);
+    if ((length = read_files(separator, &columns)) < 0) {
+        return length;
+    }
+    ++row;
+    combine(tokens, selected_ids);
+    return length;
+}
+
+int MultiTableReader::scan(int& nrow, int& ncol, char separator, int header_rows, int index_columns, TableReader::Format format, bool check, string& message,
+                           const function<void(size_t, int, const vector<char*>&, size_t)>& row_callback) noexcept(false) {
+    size_t n_files = readers.size();
+    vector<int> nrows(n_files, 0), ncols(n_files, 0), valid(n_files, 1);
+    vector<string> messages(n_files);
+    vector<vector<string>> ids(n_files); // sample IDs of every row, compared between files once all of them are scanned
+    vector<size_t> first_columns(n_files, this->index_columns); // combined column of the first data column of every file
+    vector<future<void>> tasks;
+    atomic<size_t> next_file(0u);
+    size_t n_tasks = (size_t)max(TableReader::get_num_threads(), 1);
+    int result = 1;
+
+    if (n_files == 1u) {
+        if (!row_callback) {
+            return readers[0]->scan(nrow, ncol, separator, header_rows, index_columns, format, check, message);
+        }
+        return readers[0]->scan(nrow, ncol, separator, header_rows, index_columns, format, check, message, [&](int r, const vector<char*>& row_tokens) {
+            row_callback(0u, r, row_tokens, this->index_columns);
+        });
+    }
+    for (size_t f = 1u; f < n_files; ++f) {
+        first_columns[f] = first_columns[f - 1u] + ((n_columns[f - 1u] > this->index_columns) ? n_columns[f - 1u] - this->index_columns : 0u);
+    }
+    n_tasks = (n_tasks > n_files) ? n_files : n_tasks;
+    for (size_t f = 0u; f < n_files; ++f) { // threads are split between the files scanned at once
+        readers[f]->set_threads(max(TableReader::get_num_threads() / (int)n_tasks, 1));
+    }
+    for (size_t t = 0u; t < n_tasks; ++t) {
+        tasks.push_back(async(launch::async, [&]() {
+            size_t f = 0u;
+            while ((f = next_file++) < n_files) {
+                valid[f] = readers[f]->scan(nrows[f], ncols[f], separator, header_rows, index_columns, format, check, messages[f],
+                        [&](int r, const vector<char*>& row_tokens) {
+                            string id;
+                            for (size_t c = 0u; (c < this->index_columns) && (c < row_tokens.size()); ++c) {
+                                id.append(row_tokens[c]).push_back('\t');
+                            }
+                            ids[f].push_back(move(id));
+                            if (row_callback) {
+                                row_callback(f, r, row_tokens, first_columns[f]);
+                            }
+                        });
+            }
+        }));
+    }
+    for (auto&& task: tasks) { // get() rethrows errors of the readers in this thread
+        task.get();
+    }
+    for (auto&& reader: readers) {
+        reader->set_threads(0);
+    }
+
+    nrow = nrows[0];
+    ncol = ncols[0];
+    message = "";
+    for (size_t f = 0u; f < n_files; ++f) {
+        if (nrows[f] != nrow) {
+            throw runtime_error("Files '" + file_names[0] + "' and '" + file_names[f] + "' have different numbers of rows.");
+        }
+        for (size_t r = 0u; (r < ids[f].size()) && (r < ids[0].size()); ++r) {
+            if (ids[f][r] != ids[0][r]) {
+                throw runtime_error("Sample IDs in row " + to_string(header_rows + r + 1u) + " of '" + file_names[f] + "' don't match '" + file_names[0] + "'.");
+            }
+        }
+        if (f > 0u) {
+            ncol += (ncols[f] > index_columns) ? ncols[f] - index_columns : 0;
+        }
+        if ((result == 1) && (valid[f] == 0)) {
+            result = 0;
+            message = messages[f];
+        }
+    }
+    reset();
+    return result;
+}
+
+int MultiTableReader::read_rows(char separator, long int max_rows, const function<bool(long int, const vector<char*>&, string&)>& row_callback,
+                                string& message) noexcept(false) {
+    vector<char*> tokens;
+    vector<string> messages;
+    vector<int> processed;
+    long int first_row = 0;
+    int n_rows = 0;
+
+    if (readers.size() == 1u) {
+        return readers[0]->read_rows(separator, max_rows, row_callback, message);
+    }
+    message = "";
+    while ((max_rows < 0) || (first_row < max_rows)) {
+        // Fields of the combined rows are copied, because the next row of a file overwrites the previous one.
+        batch_data.clear();
+        batch_fields.clear();
+        batch_rows.clear();
+        n_rows = 0;
+        while ((n_rows < BATCH_ROWS) && (batch_data.size() < BATCH_BYTES) && ((max_rows < 0) || (first_row + n_rows < max_rows)) &&
+               (read_row(tokens, separator) >= 0)) {
+            batch_rows.push_back(batch_fields.size());
+            for (auto&& token: tokens) {
+                batch_fields.push_back(batch_data.size());
+                batch_data.insert(batch_data.end(), token, token + strlen(token) + 1); // keep the terminating '\0'
+            }
+            ++n_rows;
+        }
+        if (n_rows == 0) {
+            break;
+        }
+        batch_rows.push_back(batch_fields.size());
+        if (batch_tokens.size() < (size_t)n_rows) {
+            batch_tokens.resize((size_t)n_rows);
+        }
+        messages.assign((size_t)n_rows, string());
+        processed.assign((size_t)n_rows, 1);
+        #pragma omp parallel for num_threads(TableReader::get_num_threads()) schedule(dynamic, 1)
+        for (int k = 0; k < n_rows; ++k) {
+            vector<char*>& row_tokens = batch_tokens[k];
+            row_tokens.clear();
+            for (size_t field = batch_rows[k]; field < batch_rows[k + 1]; ++field) {
+                row_tokens.push_back(batch_data.data() + batch_fields[field]);
+            }
+            try {
+                processed[k] = row_callback(first_row + k + 1, row_tokens, messages[k]) ? 1 : 0;
+            } catch (exception& e) { // exceptions must not leave the parallel region
+                messages[k] = e.what();
+                processed[k] = 0;
+            }
+        }
+        for (int k = 0; k < n_rows; ++k) {
+            if (processed[k] == 0) {
+                message = messages[k];
+                return 0;
+            }
+        }
+        first_row += n_rows;
+    }
+    return 1;
+}
+
+bool MultiTableReader::seek_row(long int row) noexcept(false) {
+    for (auto&& reader: readers) {
+        if (!reader->seek_row(row)) {
+            if (readers.size() > 1u) {
+                reset();
+            }
+            return false;
+        }
+    }
+    this->row = row;
+    return true;
+}
@@ -0,0 +1,79 @@
+#ifndef LASER_MULTITABLEREADER_H
+#define LASER_MULTITABLEREADER_H
+
+#include <iostream>
+#include <string>
+#include <stdexcept>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <future>
+#include <functional>
+#include <cstring>
+#include <algorithm>
+#include "TableReader.h"
+#include "aux.h"
+
+using namespace std;
+
+// Reads a list of tables with the same rows (e.g. GENO or SEQ files of the same samples, one file per chromosome) as
+// one table whose columns are the columns of all files side by side. Index columns (popID and indivID) are taken from
+// the first file; the other files must have the same IDs in every row and contribute only their data columns.
+// The list is a comma-separated string of file names (see expand_file_list in aux.h). A single file is read directly.
+class MultiTableReader {
+private:
+    vector<string> file_names;
+    vector<unique_ptr<TableReader>> readers;
+    unsigned int index_columns;
+    long int row; // rows read since the beginning of the files
+
+    vector<size_t> n_columns; // columns of every file, counted in its first row when the files are opened
+    vector<vector<char*>> file_tokens;
+
+    // Projection of the combined columns onto the files, computed for the last columns passed to read_row.
+    const vector<bool>* selected;
+    size_t selected_size;
+    size_t selected_ids; // selected index columns
+    vector<vector<bool>> file_selected;
+
+    // Combined rows read ahead in one batch by read_rows
+    vector<char> batch_data;      // '\0'-terminated fields
+    vector<size_t> batch_fields;  // start of every field in batch_data
+    vector<size_t> batch_rows;    // first field of every row in batch_fields
+    vector<vector<char*>> batch_tokens;
+
+    void select_columns(const vector<bool>& columns);
+    long int read_files(char separator, const vector<bool>* columns) noexcept(false);
+    void combine(vector<char*>& tokens, size_t n_ids) noexcept(false);
+
+public:
+    explicit MultiTableReader(unsigned int index_columns);
+    virtual ~MultiTableReader();
+
+    void set_file_name(const string& file_names);
+    const string& get_file_name(); // first file of the list
+    size_t get_n_files();
+
+    void open() noexcept(false);
+    void close() noexcept(false);
+    void reset() noexcept(false);
+    bool is_open();
+
+    // Same as in TableReader. Throws runtime_error if the files have different numbers of rows or sample IDs.
+    long int read_row(vector<char*>& tokens, char separator) noexcept(false);
+    // Columns are the combined columns and must not be changed while they are used for a sequence of rows.
+    long int read_row(vector<char*>& tokens, char separator, const vector<bool>& columns) noexcept(false);
+    // Files are scanned concurrently on up to TableReader::get_num_threads() threads, which are split between them; nrow is
+    // the number of rows in every file and ncol the number of combined columns. Data rows are not combined: row_callback
+    // gets the file, the 1-based row, the fields of the row in that file (index columns included) and the combined column
+    // of the first data column of the file. Rows of one file come in order, but rows of different files come concurrently.
+    int scan(int& nrow, int& ncol, char separator, int header_rows, int index_columns, TableReader::Format format, bool check, string& message,
+             const function<void(size_t, int, const vector<char*>&, size_t)>& row_callback = nullptr) noexcept(false);
+    int read_rows(char separator, long int max_rows, const function<bool(long int, const vector<char*>&, string&)>& row_callback,
+                  string& message) noexcept(false);
+    // Moves every file to the 0-based row. Returns false (and goes back to the first row) if some file has no index.
+    bool seek_row(long int row) noexcept(false);
+};
+
+
+#endif //LASER_MULTITABLEREADER_H
@@ -0,0 +1,235 @@
+#include "OutputWriter.h"
+
+const string OutputWriter::EXTENSION = ".gz";
+const unsigned int OutputWriter::BUFFER_SIZE = 1048576u;
+
+// Uncompressed data per BGZF block; same as in bgzip, so that a compressed block always fits into 64 KB.
+static const unsigned int BGZF_BLOCK_DATA = 65280u;
+static const unsigned int BGZF_HEADER_SIZE = 18u;
+static const unsigned int BGZF_FOOTER_SIZE = 8u;
+static const unsigned char BGZF_HEADER[BGZF_HEADER_SIZE] = { 0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0, 0, 0 };
+static const unsigned char BGZF_EOF[28] = { 0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0, 0x1b, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+OutputWriter::OutputWriter(): file(nullptr), compressed(false), failed(false), used(0u) {
+    memset(&stream, 0, sizeof(stream));
+}
+
+OutputWriter::~OutputWriter() {
+    close();
+}
+
+void OutputWriter::open(const string& file_name) {
+    close();
+    this->file_name = file_name;
+    failed = false;
+    used = 0u;
+    compressed = (file_name.length() > EXTENSION.length()) &&
+                 (file_name.compare(file_name.length() - EXTENSION.length(), EXTENSION.length(), EXTENSION) == 0);
+    file = fopen(file_name.c_str(), "wb");
+    if (file == nullptr) {
+        failed = true;
+        return;
+    }
+    buffer.resize(BUFFER_SIZE);
+    if (compressed) {
+        memset(&stream, 0, sizeof(stream));
+        if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) { // raw deflate
+            fclose(file);
+            file = nullptr;
+            failed = true;
+            return;
+        }
+        block.resize(BGZF_HEADER_SIZE + deflateBound(&stream, BGZF_BLOCK_DATA) + BGZF_FOOTER_SIZE);
+    }
+}
+
+void OutputWriter::write_block(const char* data, unsigned int size) {
+    uint32_t crc = 0u, block_size = 0u;
+
+    if (deflateReset(&stream) != Z_OK) {
+        failed = true;
+        return;
+    }
+    stream.next_in = (Bytef*)data;
+    stream.avail_in = size;
+    stream.next_out = block.data() + BGZF_HEADER_SIZE;
+    stream.avail_out = (uInt)(block.size() - BGZF_HEADER_SIZE - BGZF_FOOTER_SIZE);
+    if (deflate(&stream, Z_FINISH) != Z_STREAM_END) {
+        failed = true;
+        return;
+    }
+    block_size = BGZF_HEADER_SIZE + (uint32_t)stream.total_out + BGZF_FOOTER_SIZE;
+    if (block_size > 65536u) { // doesn't happen for BGZF_BLOCK_DATA bytes of input
+        failed = true;
+        return;
+    }
+    crc = (uint32_t)crc32(crc32(0L, Z_NULL, 0), (const Bytef*)data, size);
+    memcpy(block.data(), BGZF_HEADER, BGZF_HEADER_SIZE);
+    block[16] = (unsigned char)((block_size - 1u) & 0xffu); // BSIZE: total block size minus 1
+    block[17] = (unsigned char)((block_size - 1u) >> 8u);
+    for (unsigned int i = 0u; i < 4u; ++i) { // CRC32 and ISIZE, little-endian
+        block[block_size - 8u + i] = (unsigned char)((crc >> (8u * i)) & 0xffu);
+        block[block_size - 4u + i] = (unsigned char)((size >> (8u * i)) & 0xffu);
+    }
+    if (fwrite(block.data(), 1u, block_size, file) != block_size) {
+        failed = true;
+    }
+}
+
+void OutputWriter::flush_buffer() {
+    if ((file == nullptr) || (used == 0u)) {
+        used = 0u;
+        return;
+    }
+    if (compressed) {
+        for (size_t offset = 0u; offset < used; offset += BGZF_BLOCK_DATA) {
+            write_block(buffer.data() + offset, (unsigned int)min((size_t)BGZF_BLOCK_DATA, used - offset));
+        }
+    } else if (fwrite(buffer.data(), 1u, used, file) != used) {
+        failed = true;
+    }
+    used = 0u;
+}
+
+void OutputWriter::close() {
+    if (file == nullptr) {
+        return;
+    }
+    flush_buffer();
+    if (compressed) {
+        if (fwrite(BGZF_EOF, 1u, sizeof(BGZF_EOF), file) != sizeof(BGZF_EOF)) {
+            failed = true;
+        }
+        deflateEnd(&stream);
+    }
+    if (fclose(file) != 0) {
+        failed = true;
+    }
+    file = nullptr;
+}
+
+bool OutputWriter::is_open() {
+    return file != nullptr;
+}
+
+bool OutputWriter::fail() {
+    return failed;
+}
+
+OutputWriter& OutputWriter::operator<<(const string& value) {
+    return *this << value.c_str();
+}
+
+OutputWriter& OutputWriter::operator<<(const char* value) {
+    size_t length = strlen(value);
+    while (length > 0u) { // strings may be longer than the buffer
+        size_t n = min(length, buffer.size() - used);
+        if (n == 0u) {
+            flush_buffer();
+            if (buffer.empty()) { // not open
+                return *this;
+            }
+            continue;
+        }
+        memcpy(buffer.data() + used, value, n);
+        used += n;
+        value += n;
+        length -= n;
+    }
+    return *this;
+}
+
+OutputWriter& OutputWriter::operator<<(char value) {
+    if (!buffer.empty()) {
+        *reserve(1u) = value;
+        ++used;
+    }
+    return *this;
+}
+
+void OutputWriter::write_unsigned(unsigned long long value, bool negative) {
+    char digits[24];
+    char* digit = digits + sizeof(digits);
+    char* out = nullptr;
+    size_t n = 0u;
+
+    if (buffer.empty()) {
+        return;
+    }
+    do {
+        *--digit = (char)('0' + value % 10u);
+        value /= 10u;
+    } while (value > 0u);
+    if (negative) {
+        *--digit = '-';
+    }
+    n = (size_t)(digits + sizeof(digits) - digit);
+    out = reserve(n);
+    memcpy(out, digit, n);
+    used += n;
+}
+
+OutputWriter& OutputWriter::operator<<(int value) {
+    return *this << (long long)value;
+}
+
+OutputWriter& OutputWriter::operator<<(unsigned int value) {
+    write_unsigned(value, false);
+    return *this;
+}
+
+OutputWriter& OutputWriter::operator<<(long value) {
+    return *this << (long long)value;
+}
+
+OutputWriter& OutputWriter::operator<<(unsigned long value) {
+    write_unsigned(value, false);
+    return *this;
+}
+
+OutputWriter& OutputWriter::operator<<(long long value) {
+    write_unsigned(value < 0 ? 0ull - (unsigned long long)value : (unsigned long long)value, value < 0);
+    return *this;
+}
+
+OutputWriter& OutputWriter::operator<<(unsigned long long value) {
+    write_unsigned(value, false);
+    return *this;
+}
+
+OutputWriter& OutputWriter::operator<<(double value) {
+    char text[32];
+
+    if ((value == trunc(value)) && (fabs(value) < 1e15) && !((value == 0.0) && signbit(value))) { // integral values
+        return *this << (long long)value;
+    }
+    for (int precision = 15; precision <= 17; ++precision) { // shortest of 15, 16 or 17 significant digits that reads back exactly
+        snprintf(text, sizeof(text), "%.*g", precision, value);
+        if (strtod(text, nullptr) == value) {
+            break;
+        }
+    }
+    return *this << (const char*)text;
+}
+
+OutputWriter& OutputWriter::operator<<(float value) {
+    char text[32];
+
+    if ((value == truncf(value)) && (fabsf(value) < 1e7f) && !((value == 0.0f) && signbit(value))) {
+        return *this << (long long)value;
+    }
+    for (int precision = 6; precision <= 9; ++precision) {
+        snprintf(text, sizeof(text), "%.*g", precision, (double)value);
+        if (strtof(text, nullptr) == value) {
+            break;
+        }
+    }
+    return *this << (const char*)text;
+}
+
+OutputWriter& OutputWriter::operator<<(ostream& (*manipulator)(ostream&)) {
+    if (manipulator == static_cast<ostream& (*)(ostream&)>(endl)) {
+        *this << '\n';
+    }
+    return *this;
+}
@@ -0,0 +1,69 @@
+#ifndef LASER_OUTPUTWRITER_H
+#define LASER_OUTPUTWRITER_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <zlib.h>
+
+using namespace std;
+
+// Buffered writer for result tables. Replaces ofstream: lines are not flushed one by one, integers are formatted by hand
+// and floating-point numbers get the shortest representation that reads back to the same value. Files with names that
+// end with EXTENSION are written BGZF-compressed (readable by gzip, zcat and bgzip).
+class OutputWriter {
+
+private:
+    string file_name;
+    FILE* file;
+    bool compressed;
+    bool failed;
+    vector<char> buffer;
+    size_t used;
+    vector<unsigned char> block; // one compressed BGZF block
+    z_stream stream;
+
+    void write_block(const char* data, unsigned int size);
+    void flush_buffer();
+    char* reserve(size_t size) {
+        if (used + size > buffer.size()) {
+            flush_buffer();
+        }
+        return buffer.data() + used;
+    }
+    void write_unsigned(unsigned long long value, bool negative);
+
+public:
+    static const string EXTENSION;
+    static const unsigned int BUFFER_SIZE;
+
+    OutputWriter();
+    virtual ~OutputWriter();
+
+    void open(const string& file_name);
+    void close();
+    bool is_open();
+    bool fail();
+
+    OutputWriter& operator<<(const string& value);
+    OutputWriter& operator<<(const char* value);
+    OutputWriter& operator<<(char value);
+    OutputWriter& operator<<(int value);
+    OutputWriter& operator<<(unsigned int value);
+    OutputWriter& operator<<(long value);
+    OutputWriter& operator<<(unsigned long value);
+    OutputWriter& operator<<(long long value);
+    OutputWriter& operator<<(unsigned long long value);
+    OutputWriter& operator<<(double value);
+    OutputWriter& operator<<(float value);
+    // Accepts endl, which only ends the line (other manipulators are ignored); data is flushed when the buffer is full or
+    // the file is closed.
+    OutputWriter& operator<<(ostream& (*manipulator)(ostream&));
+};
+
+
+#endif //LASER_OUTPUTWRITER_H
@@ -0,0 +1,182 @@
+#include "PackedGenotypeReader.h"
+#include "VcfReader.h"
+#include "aux.h"
+
+const char PackedGenotypeReader::MAGIC[8] = { 'L', 'A', 'S', 'E', 'R', 'P', 'G', 'T' };
+const uint32_t PackedGenotypeReader::VERSION = 1u;
+const uint32_t PackedGenotypeReader::MISSING_CODE = 3u;
+const float PackedGenotypeReader::VALUES[4] = { 0.0f, 1.0f, 2.0f, -9.0f };
+const string PackedGenotypeReader::EXTENSION = ".pgeno";
+const uint32_t PackedGenotypeReader::SAMPLE_MAJOR = 0u;
+const uint32_t PackedGenotypeReader::LOCUS_MAJOR = 1u;
+
+bool PackedGenotypeReader::is_packed(const string& file_name) {
+    return (file_name.length() > EXTENSION.length()) && (file_name.compare(file_name.length() - EXTENSION.length(), EXTENSION.length(), EXTENSION) == 0);
+}
+
+bool PackedGenotypeReader::can_read(const string& file_name) {
+    vector<string> names = split_file_list(file_name);
+    if ((names.size() == 1u) && is_packed(names[0])) {
+        return true;
+    }
+    for (auto&& name: names) {
+        if (!VcfReader::is_vcf(name)) {
+            return false;
+        }
+    }
+    return !names.empty();
+}
+
+PackedGenotypeReader::PackedGenotypeReader(): mapping(nullptr), mapping_size(0u), row_size(0u) {
+    memset(&header, 0, sizeof(header));
+}
+
+PackedGenotypeReader::~PackedGenotypeReader() {
+    close();
+}
+
+void PackedGenotypeReader::set_file_name(const string& file_name) {
+    this->file_name = file_name;
+}
+
+const string& PackedGenotypeReader::get_file_name() {
+    return file_name;
+}
+
+void PackedGenotypeReader::open() noexcept(false) {
+    struct stat file_stat;
+    const char* ids = nullptr;
+    const char* ids_end = nullptr;
+    const char* tab = nullptr;
+    const char* line_end = nullptr;
+    int fd = 0;
+
+    if (mapping != nullptr) {
+        return;
+    }
+    if (!is_packed(file_name)) {
+        open_vcf();
+        return;
+    }
+    fd = ::open(file_name.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw runtime_error("Error while opening '" + file_name + "' file.");
+    }
+    if ((fstat(fd, &file_stat) != 0) || ((size_t)file_stat.st_size < sizeof(Header))) {
+        ::close(fd);
+        throw runtime_error("Error while reading header of '" + file_name + "' file.");
+    }
+    mapping_size = (size_t)file_stat.st_size;
+    mapping = (char*)mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        throw runtime_error("Error while opening '" + file_name + "' file.");
+    }
+    memcpy(&header, mapping, sizeof(Header));
+    if (header.layout == LOCUS_MAJOR) {
+        row_size = get_row_size(header.n_samples);
+    } else {
+        row_size = get_row_size(header.n_loci);
+    }
+    if ((memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) || (header.version != VERSION) || (header.layout > LOCUS_MAJOR) ||
+        (header.ids_offset != sizeof(Header) + (uint64_t)((header.layout == LOCUS_MAJOR) ? header.n_loci : header.n_samples) * row_size) ||
+        (header.ids_offset > mapping_size)) {
+        close();
+        throw runtime_error("'" + file_name + "' is not a valid packed genotype file.");
+    }
+
+    ids = mapping + header.ids_offset;
+    ids_end = mapping + mapping_size;
+    population_ids.clear();
+    individual_ids.clear();
+    population_ids.reserve(header.n_samples);
+    individual_ids.reserve(header.n_samples);
+    for (unsigned int i = 0u; i < header.n_samples; ++i) {
+        tab = (const char*)memchr(ids, '\t', ids_end - ids);
+        line_end = (tab != nullptr) ? (const char*)memchr(tab, '\n', ids_end - tab) : nullptr;
+        if (line_end == nullptr) {
+            close();
+            throw runtime_error("Error while reading sample IDs from '" + file_name + "' file.");
+        }
+        population_ids.emplace_back(ids, tab);
+        individual_ids.emplace_back(tab + 1, line_end);
+        ids = line_end + 1;
+    }
+    madvise(mapping, header.ids_offset, MADV_SEQUENTIAL);
+}
+
+void PackedGenotypeReader::open_vcf() noexcept(false) {
+    vector<string> names = split_file_list(file_name);
+
+    decoded.assign(sizeof(Header), 0);
+    memset(&header, 0, sizeof(header));
+    for (size_t f = 0u; f < names.size(); ++f) { // loci of the files follow each other
+        VcfReader reader;
+        reader.set_file_name(names[f]);
+        reader.open();
+        if (f == 0u) {
+            population_ids = reader.get_sample_ids();
+            individual_ids = reader.get_sample_ids();
+        } else if (reader.get_sample_ids() != individual_ids) {
+            reader.close();
+            decoded.clear();
+            throw runtime_error("Samples in '" + names[f] + "' don't match '" + names[0] + "'.");
+        }
+        header.n_loci += reader.read_genotypes(decoded);
+        reader.close();
+    }
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.n_samples = (uint32_t)individual_ids.size();
+    header.layout = LOCUS_MAJOR;
+    header.ids_offset = decoded.size();
+    memcpy(decoded.data(), &header, sizeof(Header));
+    row_size = get_row_size(header.n_samples);
+    mapping = decoded.data();
+    mapping_size = decoded.size();
+}
+
+void PackedGenotypeReader::close() {
+    if ((mapping != nullptr) && decoded.empty()) {
+        munmap(mapping, mapping_size);
+    }
+    mapping = nullptr;
+    mapping_size = 0u;
+    decoded.clear();
+    decoded.shrink_to_fit();
+}
+
+unsigned int PackedGenotypeReader::get_n_samples() {
+    return header.n_samples;
+}
+
+unsigned int PackedGenotypeReader::get_n_loci() {
+    return header.n_loci;
+}
+
+const string& PackedGenotypeReader::get_population_id(unsigned int sample) noexcept(false) {
+    return population_ids.at(sample);
+}
+
+const string& PackedGenotypeReader::get_individual_id(unsigned int sample) noexcept(false) {
+    return individual_ids.at(sample);
+}
+
+const unsigned char* PackedGenotypeReader::get_row(unsigned int sample) noexcept(false) {
+    if ((mapping == nullptr) || (sample >= header.n_samples) || (header.layout != SAMPLE_MAJOR)) {
+        throw runtime_error("Error while reading genotypes from '" + file_name + "' file.");
+    }
+    return (const unsigned char*)mapping + sizeof(Header) + (size_t)sample * row_size;
+}
+
+bool PackedGenotypeReader::is_locus_major() {
+    return header.layout == LOCUS_MAJOR;
+}
+
+const unsigned char* PackedGenotypeReader::get_locus(unsigned int locus) noexcept(false) {
+    if ((mapping == nullptr) || (locus >= header.n_loci) || (header.layout != LOCUS_MAJOR)) {
+        throw runtime_error("Error while reading genotypes from '" + file_name + "' file.");
+    }
+    return (const unsigned char*)mapping + sizeof(Header) + (size_t)locus * row_size;
+}
@@ -0,0 +1,85 @@
+#ifndef LASER_PACKEDGENOTYPEREADER_H
+#define LASER_PACKEDGENOTYPEREADER_H
+
+#include <iostream>
+#include <string>
+#include <stdexcept>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+// Packed genotype file (*.pgeno): the same samples x loci table as *.geno, but every genotype takes 2 bits.
+// Layout: header, genotype rows (one per sample, 4 loci per byte, first locus in the lowest bits), sample IDs.
+// Codes 0, 1, 2 are the genotypes and code 3 is a missing genotype (-9).
+// In locus-major files (LOCUS_MAJOR layout in the header) the rows are loci instead: every row has the genotypes of all
+// samples, 4 samples per byte, so that consecutive loci of all samples can be read block by block.
+// VCF files (or lists of VCF files with the same samples, e.g. one per chromosome) are read too: their genotypes are
+// decoded into memory in the locus-major layout when the file is opened (see VcfReader).
+class PackedGenotypeReader {
+
+public:
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t n_samples;
+        uint32_t n_loci;
+        uint32_t layout;     // SAMPLE_MAJOR or LOCUS_MAJOR
+        uint64_t ids_offset; // sample IDs: "popID\tindivID\n" for every sample
+    };
+
+    static const char MAGIC[8];
+    static const uint32_t VERSION;
+    static const uint32_t MISSING_CODE;
+    static const float VALUES[4];
+    static const string EXTENSION;
+    static const uint32_t SAMPLE_MAJOR;
+    static const uint32_t LOCUS_MAJOR;
+
+private:
+    string file_name;
+    char* mapping;
+    size_t mapping_size;
+    vector<char> decoded; // header and genotypes of VCF files, which mapping points to instead of a mapped file
+    Header header;
+    size_t row_size; // bytes in one stored row (sample or locus)
+    vector<string> population_ids;
+    vector<string> individual_ids;
+
+    void open_vcf() noexcept(false);
+
+public:
+    static bool is_packed(const string& file_name);
+    // True for a packed genotype file, a VCF file or a list of VCF files.
+    static bool can_read(const string& file_name);
+    static size_t get_row_size(unsigned int n_loci) { return (n_loci + 3u) / 4u; }
+    static unsigned int get_code(const unsigned char* row, unsigned int locus) { return (row[locus >> 2u] >> ((locus & 3u) << 1u)) & 3u; }
+    static float get_value(const unsigned char* row, unsigned int locus) { return VALUES[get_code(row, locus)]; }
+
+    PackedGenotypeReader();
+    virtual ~PackedGenotypeReader();
+
+    void set_file_name(const string& file_name);
+    const string& get_file_name();
+
+    void open() noexcept(false);
+    void close();
+
+    unsigned int get_n_samples();
+    unsigned int get_n_loci();
+    const string& get_population_id(unsigned int sample) noexcept(false);
+    const string& get_individual_id(unsigned int sample) noexcept(false);
+    // Packed genotypes of the 0-based sample of a sample-major file; points into the memory-mapped file.
+    const unsigned char* get_row(unsigned int sample) noexcept(false);
+    bool is_locus_major();
+    // Packed genotypes of all samples at the 0-based locus of a locus-major file (use get_code with the sample index).
+    const unsigned char* get_locus(unsigned int locus) noexcept(false);
+};
+
+
+#endif //LASER_PACKEDGENOTYPEREADER_H
@@ -0,0 +1,120 @@
+#include "PackedGenotypeWriter.h"
+
+PackedGenotypeWriter::PackedGenotypeWriter(): file(nullptr), n_samples(0u), mapping(nullptr), mapping_size(0u) {
+    memset(&header, 0, sizeof(header));
+}
+
+PackedGenotypeWriter::~PackedGenotypeWriter() {
+    if (mapping != nullptr) {
+        munmap(mapping, sizeof(header) + mapping_size);
+        mapping = nullptr;
+    }
+    if (file != nullptr) {
+        fclose(file);
+        file = nullptr;
+    }
+}
+
+void PackedGenotypeWriter::open(const string& file_name, unsigned int n_loci) noexcept(false) {
+    this->file_name = file_name;
+    file = fopen(file_name.c_str(), "w+b"); // read access is needed to map locus-major files
+    if (file == nullptr) {
+        throw runtime_error("Error while creating '" + file_name + "' file.");
+    }
+    memcpy(header.magic, PackedGenotypeReader::MAGIC, sizeof(header.magic));
+    header.version = PackedGenotypeReader::VERSION;
+    header.n_samples = 0u;
+    header.n_loci = n_loci;
+    header.layout = PackedGenotypeReader::SAMPLE_MAJOR;
+    header.ids_offset = sizeof(header);
+    row.assign(PackedGenotypeReader::get_row_size(n_loci), 0u);
+    ids.clear();
+    if (fwrite(&header, sizeof(header), 1u, file) != 1u) { // rewritten by close()
+        throw runtime_error("Error while writing '" + file_name + "' file.");
+    }
+}
+
+void PackedGenotypeWriter::open_locus_major(const string& file_name, unsigned int n_samples, unsigned int n_loci) noexcept(false) {
+    open(file_name, n_loci);
+    header.layout = PackedGenotypeReader::LOCUS_MAJOR;
+    this->n_samples = n_samples;
+    mapping_size = (size_t)n_loci * PackedGenotypeReader::get_row_size(n_samples);
+    if ((fflush(file) != 0) || (ftruncate(fileno(file), sizeof(header) + mapping_size) != 0)) { // new bytes are zeros
+        throw runtime_error("Error while writing '" + file_name + "' file.");
+    }
+    if (mapping_size > 0u) {
+        mapping = (unsigned char*)mmap(nullptr, sizeof(header) + mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fileno(file), 0);
+        if (mapping == MAP_FAILED) {
+            mapping = nullptr;
+            throw runtime_error("Error while writing '" + file_name + "' file.");
+        }
+    }
+}
+
+long int PackedGenotypeWriter::write_row(const char* population_id, const char* individual_id, const vector<char*>& genotypes, unsigned int first_genotype) noexcept(false) {
+    unsigned int code = 0u;
+    const char* genotype = nullptr;
+
+    if (genotypes.size() != first_genotype + header.n_loci) {
+        return (long int)(genotypes.size() > first_genotype ? genotypes.size() : first_genotype);
+    }
+    fill(row.begin(), row.end(), 0u);
+    for (unsigned int j = 0u; j < header.n_loci; ++j) {
+        genotype = genotypes[first_genotype + j];
+        if ((genotype[0] >= '0') && (genotype[0] <= '2') && (genotype[1] == '\0')) {
+            code = (unsigned int)(genotype[0] - '0');
+        } else if (strcmp(genotype, "-9") == 0) {
+            code = PackedGenotypeReader::MISSING_CODE;
+        } else {
+            return first_genotype + j;
+        }
+        row[j >> 2u] |= (unsigned char)(code << ((j & 3u) << 1u));
+    }
+    if (header.layout == PackedGenotypeReader::LOCUS_MAJOR) {
+        if (header.n_samples >= n_samples) {
+            throw runtime_error("Error while writing '" + file_name + "' file: more than " + to_string(n_samples) + " samples.");
+        }
+        size_t locus_size = PackedGenotypeReader::get_row_size(n_samples);
+        unsigned char* locus = mapping + sizeof(header) + (header.n_samples >> 2u);
+        unsigned int shift = (header.n_samples & 3u) << 1u;
+        for (unsigned int j = 0u; j < header.n_loci; ++j, locus += locus_size) {
+            *locus |= (unsigned char)(PackedGenotypeReader::get_code(row.data(), j) << shift);
+        }
+    } else {
+        if (!row.empty() && (fwrite(row.data(), 1u, row.size(), file) != row.size())) {
+            throw runtime_error("Error while writing '" + file_name + "' file.");
+        }
+        header.ids_offset += row.size();
+    }
+    ids.append(population_id).append("\t").append(individual_id).append("\n");
+    ++header.n_samples;
+    return -1;
+}
+
+void PackedGenotypeWriter::close() noexcept(false) {
+    bool failed = false;
+
+    if (file == nullptr) {
+        return;
+    }
+    if (header.layout == PackedGenotypeReader::LOCUS_MAJOR) {
+        if (mapping != nullptr) {
+            failed = (munmap(mapping, sizeof(header) + mapping_size) != 0);
+            mapping = nullptr;
+        }
+        if (header.n_samples != n_samples) {
+            fclose(file);
+            file = nullptr;
+            throw runtime_error("Error while writing '" + file_name + "' file: " + to_string(header.n_samples) + " samples instead of " + to_string(n_samples) + ".");
+        }
+        header.ids_offset = sizeof(header) + mapping_size;
+        failed = (fseeko(file, (off_t)header.ids_offset, SEEK_SET) != 0) || failed;
+    }
+    failed = (fwrite(ids.data(), 1u, ids.size(), file) != ids.size()) || (fseek(file, 0L, SEEK_SET) != 0) ||
+             (fwrite(&header, sizeof(header), 1u, file) != 1u) || failed;
+    failed = (fclose(file) != 0) || failed;
+    file = nullptr;
+    if (failed) {
+        throw runtime_error("Error while writing '" + file_name + "' file.");
+    }
+}
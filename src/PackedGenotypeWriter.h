@@ -0,0 +1,45 @@
+#ifndef LASER_PACKEDGENOTYPEWRITER_H
+#define LASER_PACKEDGENOTYPEWRITER_H
+
+#include <iostream>
+#include <string>
+#include <stdexcept>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "PackedGenotypeReader.h"
+
+using namespace std;
+
+// Writes packed genotype files (see PackedGenotypeReader). Rows are written as they come; sample IDs and the final
+// number of samples are written by close(). Locus-major files are written from the same sample rows: the file is sized
+// for all samples when it is opened and every row is scattered into the memory-mapped loci.
+class PackedGenotypeWriter {
+
+private:
+    string file_name;
+    FILE* file;
+    PackedGenotypeReader::Header header;
+    vector<unsigned char> row;
+    string ids;
+    unsigned int n_samples;  // expected samples of a locus-major file
+    unsigned char* mapping;  // genotypes of a locus-major file
+    size_t mapping_size;
+
+public:
+    PackedGenotypeWriter();
+    virtual ~PackedGenotypeWriter();
+
+    void open(const string& file_name, unsigned int n_loci) noexcept(false);
+    // Opens a locus-major file; exactly n_samples rows must be written before close().
+    void open_locus_major(const string& file_name, unsigned int n_samples, unsigned int n_loci) noexcept(false);
+    // Genotypes must be "0", "1", "2" or "-9". Returns index of the first invalid genotype, or -1 if all are valid.
+    long int write_row(const char* population_id, const char* individual_id, const vector<char*>& genotypes, unsigned int first_genotype) noexcept(false);
+    void close() noexcept(false);
+};
+
+
+#endif //LASER_PACKEDGENOTYPEWRITER_H
@@ -0,0 +1,162 @@
+#include "PileupReader.h"
+
+const size_t PileupReader::NOT_FOUND = (size_t)-1;
+const string PileupReader::EXTENSION = ".pileup";
+
+static const uint32_t NO_LOCUS = UINT32_MAX; // rows at positions that are not in the site file
+
+static bool ends_with(const string& file_name, const string& extension) {
+    return (file_name.length() > extension.length()) && (file_name.compare(file_name.length() - extension.length(), extension.length(), extension) == 0);
+}
+
+// Error rate of every phred+33 base quality character.
+static const vector<double>& get_error_rates() {
+    static const vector<double> error_rates = []() {
+        vector<double> rates(256u, 1.0);
+        for (int c = 33; c < 256; ++c) {
+            rates[c] = pow(10.0, -(c - 33) / 10.0);
+        }
+        return rates;
+    }();
+    return error_rates;
+}
+
+bool PileupReader::is_pileup(const string& file_name) {
+    return ends_with(file_name, EXTENSION) || ends_with(file_name, EXTENSION + ".gz");
+}
+
+string PileupReader::get_sample_id(const string& file_name) {
+    size_t slash = file_name.find_last_of('/');
+    string id = (slash == string::npos) ? file_name : file_name.substr(slash + 1u);
+    if (ends_with(id, ".gz")) {
+        id.resize(id.length() - 3u);
+    }
+    if (ends_with(id, EXTENSION)) {
+        id.resize(id.length() - EXTENSION.length());
+    }
+    return id;
+}
+
+bool PileupReader::parse_position(const char* field, uint32_t& position) {
+    char* end = nullptr;
+    unsigned long value = 0u;
+
+    errno = 0;
+    value = strtoul(field, &end, 10);
+    if ((end == field) || (*end != '\0') || (errno == ERANGE) || (value > UINT32_MAX)) {
+        return false;
+    }
+    position = (uint32_t)value;
+    return true;
+}
+
+void PileupReader::count(const vector<char*>& tokens, Locus& locus) {
+    const vector<double>& error_rates = get_error_rates();
+    char* end = nullptr;
+    unsigned long length = 0u;
+    double error = 0.0;
+    size_t n = 0u;
+
+    locus.coverage = 0u;
+    locus.reads = 0u;
+    locus.quality = 0.0f;
+    if ((tokens.size() < 6u) || (tokens[2][0] == '\0') || (tokens[2][1] != '\0')) { // no reads, or reference is not one base
+        return;
+    }
+    for (const char* base = tokens[4]; *base != '\0'; ++base) {
+        switch (*base) {
+            case '.':
+            case ',':
+                ++locus.reads;
+                ++locus.coverage;
+                break;
+            case '^': // start of a read is followed by its mapping quality
+                if (base[1] != '\0') {
+                    ++base;
+                }
+                break;
+            case '+': // inserted or deleted bases follow their number
+            case '-':
+                length = strtoul(base + 1, &end, 10);
+                base = end - 1;
+                for (; (length > 0u) && (base[1] != '\0'); --length) {
+                    ++base;
+                }
+                break;
+            default:
+                if (strchr("ACGTNacgtn", *base) != nullptr) {
+                    ++locus.coverage;
+                }
+                break;
+        }
+    }
+    for (const char* quality = tokens[5]; *quality != '\0'; ++quality, ++n) {
+        error += error_rates[(unsigned char)*quality];
+    }
+    if (n > 0u) {
+        locus.quality = (float)round(-10.0 * log10(error / n));
+    }
+}
+
+PileupReader::PileupReader() {
+
+}
+
+PileupReader::~PileupReader() {
+
+}
+
+void PileupReader::set_file_name(const string& file_name) {
+    this->file_name = file_name;
+}
+
+const string& PileupReader::get_file_name() {
+    return file_name;
+}
+
+void PileupReader::read(const Locator& locator, vector<Locus>& loci) noexcept(false) {
+    size_t kept = 0u;          // loci of the previous batches
+    long int batch_first = 1;  // number of the first row in the current batch
+    string message;
+    auto keep_loci = [&]() {
+        for (size_t r = kept; r < rows.size(); ++r) {
+            if (rows[r].locus != NO_LOCUS) {
+                rows[kept++] = rows[r];
+            }
+        }
+        rows.resize(kept);
+    };
+
+    rows.clear();
+    reader.set_file_name(file_name);
+    reader.open();
+    int result = reader.read_rows('\t', -1, [&](long int row, const vector<char*>& tokens, string& message) -> bool {
+        Locus& locus = rows[kept + (size_t)(row - batch_first)];
+        uint32_t position = 0u;
+        size_t found = NOT_FOUND;
+        locus.locus = NO_LOCUS;
+        if ((tokens.size() >= 4u) && parse_position(tokens[1], position) && ((found = locator(tokens[0], position)) != NOT_FOUND)) {
+            locus.locus = (uint32_t)found;
+            count(tokens, locus);
+        }
+        return true;
+    }, message, [&](long int first_row, int n_rows) { // loci of the previous batch are kept and other rows are dropped
+        keep_loci();
+        rows.resize(kept + (size_t)n_rows);
+        batch_first = first_row;
+    });
+    reader.close();
+    if (result == 0) {
+        throw runtime_error(message);
+    }
+    keep_loci();
+
+    // the last line of a locus counts, so loci are sorted with their lines in order and only the last one is taken
+    stable_sort(rows.begin(), rows.end(), [](const Locus& a, const Locus& b) { return a.locus < b.locus; });
+    loci.clear();
+    for (size_t r = 0u; r < rows.size(); ++r) {
+        if ((r + 1u == rows.size()) || (rows[r + 1u].locus != rows[r].locus)) {
+            loci.push_back(rows[r]);
+        }
+    }
+}
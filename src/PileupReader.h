@@ -0,0 +1,66 @@
+#ifndef LASER_PILEUPREADER_H
+#define LASER_PILEUPREADER_H
+
+#include <iostream>
+#include <string>
+#include <stdexcept>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <cerrno>
+#include <cmath>
+#include "TableReader.h"
+
+using namespace std;
+
+// Reads the sequence data of one sample from a samtools pileup file (*.pileup or *.pileup.gz): CHROM, POS, REF, depth,
+// read bases and base qualities of every covered position. Positions that are loci of the site file become loci with
+// the same values as in a SEQ file (computed as by pileup2seq.py): the coverage is the number of read bases,
+// reads is the number of bases with the reference allele, and quality is the phred-scaled mean error rate of the base
+// qualities. Inserted and deleted bases, deletions ('*') and reference skips are not counted. Lines with less than 4
+// columns or an invalid position are skipped.
+class PileupReader {
+
+public:
+    struct Locus {
+        uint32_t locus; // 0-based row in the site file
+        uint32_t coverage;
+        uint32_t reads;
+        float quality;
+    };
+
+    // Returns the 0-based locus at the chromosome and position, or NOT_FOUND.
+    typedef function<size_t(const string&, uint32_t)> Locator;
+
+    static const size_t NOT_FOUND;
+    static const string EXTENSION;
+
+private:
+    string file_name;
+    TableReader reader;
+    vector<Locus> rows; // loci of the previous batches followed by the rows of the current batch
+
+    static bool parse_position(const char* field, uint32_t& position);
+    static void count(const vector<char*>& tokens, Locus& locus);
+
+public:
+    static bool is_pileup(const string& file_name);
+    // File name without directories and the extension (e.g. NA12878 for /data/NA12878.pileup.gz), as in pileup2seq.py.
+    static string get_sample_id(const string& file_name);
+
+    PileupReader();
+    virtual ~PileupReader();
+
+    void set_file_name(const string& file_name);
+    const string& get_file_name();
+
+    // Reads the whole file on TableReader threads. Loci are sorted and a locus covered by several lines gets the values of
+    // the last one.
+    void read(const Locator& locator, vector<Locus>& loci) noexcept(false);
+};
+
+
+#endif //LASER_PILEUPREADER_H
@@ -0,0 +1,222 @@
+#include "ReferenceSnapshotReader.h"
+#include "PackedGenotypeReader.h"
+
+const char ReferenceSnapshotReader::MAGIC[8] = { 'L', 'A', 'S', 'E', 'R', 'R', 'E', 'F' };
+const uint32_t ReferenceSnapshotReader::VERSION = 1u;
+const uint64_t ReferenceSnapshotReader::ALIGNMENT;
+
+bool ReferenceSnapshotReader::get_file_key(const string& file_name, uint64_t& size, int64_t& mtime) {
+    struct stat file_stat;
+
+    size = 0u;
+    mtime = 0;
+    for (auto&& name: split_file_list(file_name)) { // list of files: total size and the latest modification time
+        if (stat(name.c_str(), &file_stat) != 0) {
+            return false;
+        }
+        size += (uint64_t)file_stat.st_size;
+        mtime = ((int64_t)file_stat.st_mtime > mtime) ? (int64_t)file_stat.st_mtime : mtime;
+    }
+    return true;
+}
+
+ReferenceSnapshotReader::ReferenceSnapshotReader(): mapping(nullptr), mapping_size(0u), row_size(0u) {
+    memset(&header, 0, sizeof(header));
+}
+
+ReferenceSnapshotReader::~ReferenceSnapshotReader() {
+    close();
+}
+
+bool ReferenceSnapshotReader::open(const string& file_name, const string& geno_file_name, const string& site_file_name, const string& coord_file_name) noexcept(false) {
+    struct stat file_stat;
+    uint64_t geno_size = 0u, site_size = 0u, coord_size = 0u;
+    int64_t geno_mtime = 0, site_mtime = 0, coord_mtime = 0;
+    const char* text = nullptr;
+    const char* text_end = nullptr;
+    const char* tab = nullptr;
+    const char* line_end = nullptr;
+    int fd = 0;
+
+    close();
+    this->file_name = file_name;
+    if (!get_file_key(geno_file_name, geno_size, geno_mtime) || !get_file_key(site_file_name, site_size, site_mtime)) {
+        return false;
+    }
+    if (!coord_file_name.empty() && !get_file_key(coord_file_name, coord_size, coord_mtime)) {
+        return false;
+    }
+    fd = ::open(file_name.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    if ((fstat(fd, &file_stat) != 0) || ((size_t)file_stat.st_size < sizeof(Header))) {
+        ::close(fd);
+        return false;
+    }
+    mapping_size = (size_t)file_stat.st_size;
+    mapping = (char*)mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        return false;
+    }
+    memcpy(&header, mapping, sizeof(Header));
+    if ((memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) || (header.version != VERSION) ||
+        (header.geno_size != geno_size) || (header.geno_mtime != geno_mtime) ||
+        (header.site_size != site_size) || (header.site_mtime != site_mtime) ||
+        (header.coord_size != coord_size) || (header.coord_mtime != coord_mtime) || (coord_file_name.empty() != (header.coord_pcs == 0u))) {
+        close();
+        return false;
+    }
+    for (unsigned int s = 0u; s < N_SECTIONS; ++s) {
+        if ((header.offsets[s] % ALIGNMENT != 0u) || (header.offsets[s] > mapping_size) || (header.sizes[s] > mapping_size - header.offsets[s])) {
+            close();
+            return false;
+        }
+    }
+    row_size = PackedGenotypeReader::get_row_size(header.n_loci);
+    if ((header.sizes[SAMPLES] != 4u * (uint64_t)header.n_samples) || (header.sizes[LOCI] != 4u * (uint64_t)header.n_loci) ||
+        (header.sizes[GENOTYPES] != (uint64_t)header.n_samples * row_size) || (header.offsets[SAMPLE_IDS] == 0u) || (header.offsets[SITE_KEYS] == 0u)) {
+        close();
+        return false;
+    }
+
+    text = mapping + header.offsets[SAMPLE_IDS];
+    text_end = text + header.sizes[SAMPLE_IDS];
+    population_ids.clear();
+    individual_ids.clear();
+    population_ids.reserve(header.n_samples);
+    individual_ids.reserve(header.n_samples);
+    for (unsigned int i = 0u; i < header.n_samples; ++i) {
+        tab = (const char*)memchr(text, '\t', text_end - text);
+        line_end = (tab != nullptr) ? (const char*)memchr(tab, '\n', text_end - tab) : nullptr;
+        if (line_end == nullptr) {
+            close();
+            return false;
+        }
+        population_ids.emplace_back(text, tab);
+        individual_ids.emplace_back(tab + 1, line_end);
+        text = line_end + 1;
+    }
+    text = mapping + header.offsets[SITE_KEYS];
+    text_end = text + header.sizes[SITE_KEYS];
+    site_keys.clear();
+    site_keys.reserve(header.n_loci);
+    for (unsigned int j = 0u; j < header.n_loci; ++j) {
+        line_end = (const char*)memchr(text, '\n', text_end - text);
+        if (line_end == nullptr) {
+            close();
+            return false;
+        }
+        site_keys.emplace_back(text, line_end);
+        text = line_end + 1;
+    }
+    return true;
+}
+
+void ReferenceSnapshotReader::close() {
+    if (mapping != nullptr) {
+        munmap(mapping, mapping_size);
+        mapping = nullptr;
+        mapping_size = 0u;
+    }
+    population_ids.clear();
+    individual_ids.clear();
+    site_keys.clear();
+}
+
+bool ReferenceSnapshotReader::is_open() {
+    return mapping != nullptr;
+}
+
+bool ReferenceSnapshotReader::has_section(Section section) {
+    return (mapping != nullptr) && (header.offsets[section] != 0u);
+}
+
+bool ReferenceSnapshotReader::matches(const vector<uint32_t>& samples, const vector<uint32_t>& loci, unsigned int dim, const vector<Section>& required) {
+    if ((mapping == nullptr) || (samples.size() != header.n_samples) || (loci.size() != header.n_loci) || (dim != header.dim)) {
+        return false;
+    }
+    for (auto section : required) {
+        if (header.offsets[section] == 0u) {
+            return false;
+        }
+    }
+    return (memcmp(samples.data(), mapping + header.offsets[SAMPLES], header.sizes[SAMPLES]) == 0) &&
+           (memcmp(loci.data(), mapping + header.offsets[LOCI], header.sizes[LOCI]) == 0);
+}
+
+unsigned int ReferenceSnapshotReader::get_n_samples() {
+    return header.n_samples;
+}
+
+unsigned int ReferenceSnapshotReader::get_n_loci() {
+    return header.n_loci;
+}
+
+unsigned int ReferenceSnapshotReader::get_dim() {
+    return header.dim;
+}
+
+unsigned int ReferenceSnapshotReader::get_geno_samples() {
+    return header.geno_samples;
+}
+
+unsigned int ReferenceSnapshotReader::get_geno_loci() {
+    return header.geno_loci;
+}
+
+unsigned int ReferenceSnapshotReader::get_coord_pcs() {
+    return header.coord_pcs;
+}
+
+bool ReferenceSnapshotReader::is_checked(uint32_t checked) {
+    return (header.checked & checked) == checked;
+}
+
+const string& ReferenceSnapshotReader::get_population_id(unsigned int sample) noexcept(false) {
+    return population_ids.at(sample);
+}
+
+const string& ReferenceSnapshotReader::get_individual_id(unsigned int sample) noexcept(false) {
+    return individual_ids.at(sample);
+}
+
+const string& ReferenceSnapshotReader::get_site_key(unsigned int locus) noexcept(false) {
+    return site_keys.at(locus);
+}
+
+const char* ReferenceSnapshotReader::get_section(Section section, uint64_t size) noexcept(false) {
+    if ((mapping == nullptr) || (header.offsets[section] == 0u) || (header.sizes[section] != size)) {
+        throw runtime_error("Error while reading '" + file_name + "' file.");
+    }
+    return mapping + header.offsets[section];
+}
+
+const unsigned char* ReferenceSnapshotReader::get_genotypes(unsigned int sample) noexcept(false) {
+    if (sample >= header.n_samples) {
+        throw runtime_error("Error while reading '" + file_name + "' file.");
+    }
+    return (const unsigned char*)get_section(GENOTYPES, (uint64_t)header.n_samples * row_size) + (size_t)sample * row_size;
+}
+
+const float* ReferenceSnapshotReader::get_ref_mean() noexcept(false) {
+    return (const float*)get_section(REF_MEAN, sizeof(float) * (uint64_t)header.n_loci);
+}
+
+const float* ReferenceSnapshotReader::get_ref_sd() noexcept(false) {
+    return (const float*)get_section(REF_SD, sizeof(float) * (uint64_t)header.n_loci);
+}
+
+const double* ReferenceSnapshotReader::get_ref_m() noexcept(false) {
+    return (const double*)get_section(REF_M, sizeof(double) * (uint64_t)header.n_samples * header.n_samples);
+}
+
+const double* ReferenceSnapshotReader::get_ref_pc() noexcept(false) {
+    return (const double*)get_section(REF_PC, sizeof(double) * (uint64_t)header.n_samples * header.dim);
+}
+
+const double* ReferenceSnapshotReader::get_pc_var() noexcept(false) {
+    return (const double*)get_section(PC_VAR, sizeof(double) * (uint64_t)header.dim);
+}
@@ -0,0 +1,115 @@
+#ifndef LASER_REFERENCESNAPSHOTREADER_H
+#define LASER_REFERENCESNAPSHOTREADER_H
+
+#include <iostream>
+#include <string>
+#include <stdexcept>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "aux.h"
+
+using namespace std;
+
+// Snapshot of a loaded reference panel (written by ReferenceSnapshotWriter), so that laser and trace don't have to
+// re-read GENO_FILE and COORD_FILE and to recompute the reference covariance matrix and PCA in every run.
+// Layout: header followed by sections, each one starting at a 64-byte aligned offset given in the header:
+//   SAMPLES      uint32 x n_samples: 0-based rows of the selected reference individuals in GENO_FILE
+//   LOCI         uint32 x n_loci: 0-based columns of the selected loci in GENO_FILE
+//   GENOTYPES    one row per sample with 2-bit genotype codes as in *.pgeno (see PackedGenotypeReader)
+//   REF_MEAN     float x n_loci: genotype means (trace only)
+//   REF_SD       float x n_loci: genotype standard deviations (trace only)
+//   REF_M        double x n_samples x n_samples: covariance matrix of the normalized genotypes (trace only)
+//   REF_PC       double x n_samples x dim: reference coordinates, column by column
+//   PC_VAR       double x dim: variances explained by the PCs (only if there was no COORD_FILE)
+//   SAMPLE_IDS   "popID\tindivID\n" for every sample
+//   SITE_KEYS    "CHROM:POS\n" for every locus
+// Size and modification time of GENO_FILE, its site file and COORD_FILE are stored in the header (total size and the
+// latest time for lists of files); a snapshot that doesn't match them is stale. The checked flags tell whether the
+// format of GENO_FILE and COORD_FILE was checked in the run that wrote the snapshot, so that later runs can skip it.
+class ReferenceSnapshotReader {
+
+public:
+    enum Section { SAMPLES, LOCI, GENOTYPES, REF_MEAN, REF_SD, REF_M, REF_PC, PC_VAR, SAMPLE_IDS, SITE_KEYS, N_SECTIONS };
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t n_samples;     // selected reference individuals
+        uint32_t n_loci;        // selected loci
+        uint32_t dim;           // number of columns in REF_PC
+        uint32_t geno_samples;  // individuals in GENO_FILE
+        uint32_t geno_loci;     // loci in GENO_FILE
+        uint32_t coord_pcs;     // PCs in COORD_FILE (0 if reference coordinates come from PCA)
+        uint32_t checked;       // CHECKED_GENO and CHECKED_COORD flags
+        uint64_t geno_size;
+        int64_t geno_mtime;
+        uint64_t site_size;
+        int64_t site_mtime;
+        uint64_t coord_size;    // 0 if there is no COORD_FILE
+        int64_t coord_mtime;
+        uint64_t offsets[N_SECTIONS]; // 0 if the section is absent
+        uint64_t sizes[N_SECTIONS];
+    };
+
+    static const char MAGIC[8];
+    static const uint32_t VERSION;
+    static const uint64_t ALIGNMENT = 64u;
+    static const uint32_t CHECKED_GENO = 1u;
+    static const uint32_t CHECKED_COORD = 2u;
+
+private:
+    string file_name;
+    char* mapping;
+    size_t mapping_size;
+    Header header;
+    size_t row_size;
+    vector<string> population_ids;
+    vector<string> individual_ids;
+    vector<string> site_keys;
+
+    const char* get_section(Section section, uint64_t size) noexcept(false);
+
+public:
+    static bool get_file_key(const string& file_name, uint64_t& size, int64_t& mtime);
+
+    ReferenceSnapshotReader();
+    virtual ~ReferenceSnapshotReader();
+
+    // Opens the snapshot. Returns false if there is no snapshot, it is damaged or it was made from other (or since
+    // modified) GENO_FILE, site file or COORD_FILE. The coord_file_name is empty if there is no COORD_FILE.
+    bool open(const string& file_name, const string& geno_file_name, const string& site_file_name, const string& coord_file_name) noexcept(false);
+    void close();
+    bool is_open();
+    bool has_section(Section section);
+
+    // Returns true if the snapshot was made for exactly these reference individuals, loci and number of PCs, and has
+    // all of the required sections.
+    bool matches(const vector<uint32_t>& samples, const vector<uint32_t>& loci, unsigned int dim, const vector<Section>& required);
+
+    unsigned int get_n_samples();
+    unsigned int get_n_loci();
+    unsigned int get_dim();
+    unsigned int get_geno_samples();
+    unsigned int get_geno_loci();
+    unsigned int get_coord_pcs();
+    // Returns true if the format of the files with all of these CHECKED_GENO and CHECKED_COORD flags was checked.
+    bool is_checked(uint32_t checked);
+    const string& get_population_id(unsigned int sample) noexcept(false);
+    const string& get_individual_id(unsigned int sample) noexcept(false);
+    const string& get_site_key(unsigned int locus) noexcept(false);
+    // Data of the sections; point into the memory-mapped snapshot.
+    const unsigned char* get_genotypes(unsigned int sample) noexcept(false);
+    const float* get_ref_mean() noexcept(false);
+    const float* get_ref_sd() noexcept(false);
+    const double* get_ref_m() noexcept(false);
+    const double* get_ref_pc() noexcept(false);
+    const double* get_pc_var() noexcept(false);
+};
+
+
+#endif //LASER_REFERENCESNAPSHOTREADER_H
@@ -0,0 +1,121 @@
+#include "ReferenceSnapshotWriter.h"
+
+ReferenceSnapshotWriter::ReferenceSnapshotWriter(): ref_mean(nullptr), ref_sd(nullptr), ref_m(nullptr), ref_pc(nullptr), pc_var(nullptr) {
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ReferenceSnapshotReader::MAGIC, sizeof(header.magic));
+    header.version = ReferenceSnapshotReader::VERSION;
+}
+
+ReferenceSnapshotWriter::~ReferenceSnapshotWriter() {
+
+}
+
+bool ReferenceSnapshotWriter::set_sources(const string& geno_file_name, const string& site_file_name, const string& coord_file_name,
+                                          unsigned int geno_samples, unsigned int geno_loci, unsigned int coord_pcs) {
+    header.geno_samples = geno_samples;
+    header.geno_loci = geno_loci;
+    header.coord_pcs = coord_file_name.empty() ? 0u : coord_pcs;
+    header.coord_size = 0u;
+    header.coord_mtime = 0;
+    if (!ReferenceSnapshotReader::get_file_key(geno_file_name, header.geno_size, header.geno_mtime) ||
+        !ReferenceSnapshotReader::get_file_key(site_file_name, header.site_size, header.site_mtime)) {
+        return false;
+    }
+    return coord_file_name.empty() || ReferenceSnapshotReader::get_file_key(coord_file_name, header.coord_size, header.coord_mtime);
+}
+
+void ReferenceSnapshotWriter::set_checked(uint32_t checked) {
+    header.checked = checked;
+}
+
+void ReferenceSnapshotWriter::set_samples(const vector<uint32_t>& samples, const string* population_ids, const string* individual_ids) {
+    this->samples = samples;
+    header.n_samples = samples.size();
+    sample_ids.clear();
+    for (unsigned int i = 0u; i < header.n_samples; ++i) {
+        sample_ids.append(population_ids[i]).append("\t").append(individual_ids[i]).append("\n");
+    }
+}
+
+void ReferenceSnapshotWriter::set_loci(const vector<uint32_t>& loci, const vector<string>& site_keys) {
+    this->loci = loci;
+    header.n_loci = loci.size();
+    this->site_keys.clear();
+    for (auto&& key : site_keys) {
+        this->site_keys.append(key).append("\n");
+    }
+}
+
+void ReferenceSnapshotWriter::set_ref_stats(const float* ref_mean, const float* ref_sd) {
+    this->ref_mean = ref_mean;
+    this->ref_sd = ref_sd;
+}
+
+void ReferenceSnapshotWriter::set_ref_m(const double* ref_m) {
+    this->ref_m = ref_m;
+}
+
+void ReferenceSnapshotWriter::set_ref_pc(const double* ref_pc, unsigned int dim, const double* pc_var) {
+    this->ref_pc = ref_pc;
+    this->pc_var = pc_var;
+    header.dim = dim;
+}
+
+// Pads the file to the next aligned offset and writes the section there. Sections without data are left out.
+bool ReferenceSnapshotWriter::write_section(FILE* file, uint64_t& offset, const void* data, uint64_t size, uint64_t& section_offset, uint64_t& section_size) {
+    static const char padding[ReferenceSnapshotReader::ALIGNMENT] = { 0 };
+    uint64_t padding_size = (ReferenceSnapshotReader::ALIGNMENT - offset % ReferenceSnapshotReader::ALIGNMENT) % ReferenceSnapshotReader::ALIGNMENT;
+
+    section_offset = 0u;
+    section_size = 0u;
+    if (data == nullptr) {
+        return true;
+    }
+    if (fwrite(padding, 1u, padding_size, file) != padding_size) {
+        return false;
+    }
+    offset += padding_size;
+    if ((size > 0u) && (fwrite(data, 1u, size, file) != size)) {
+        return false;
+    }
+    section_offset = offset;
+    section_size = size;
+    offset += size;
+    return true;
+}
+
+bool ReferenceSnapshotWriter::write(const string& file_name) {
+    typedef ReferenceSnapshotReader R;
+    string tmp_file_name = file_name + ".tmp." + to_string(getpid());
+    uint64_t offset = sizeof(header);
+    uint64_t n_loci = header.n_loci;
+    uint64_t n_samples = header.n_samples;
+    bool failed = false;
+    FILE* file = nullptr;
+
+    if ((samples.size() != n_samples) || (genotypes.size() != n_samples * PackedGenotypeReader::get_row_size(header.n_loci))) {
+        return false;
+    }
+    file = fopen(tmp_file_name.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    failed = (fwrite(&header, sizeof(header), 1u, file) != 1u) || // rewritten below with the section offsets
+             !write_section(file, offset, samples.data(), 4u * n_samples, header.offsets[R::SAMPLES], header.sizes[R::SAMPLES]) ||
+             !write_section(file, offset, loci.data(), 4u * n_loci, header.offsets[R::LOCI], header.sizes[R::LOCI]) ||
+             !write_section(file, offset, genotypes.data(), genotypes.size(), header.offsets[R::GENOTYPES], header.sizes[R::GENOTYPES]) ||
+             !write_section(file, offset, ref_mean, sizeof(float) * n_loci, header.offsets[R::REF_MEAN], header.sizes[R::REF_MEAN]) ||
+             !write_section(file, offset, ref_sd, sizeof(float) * n_loci, header.offsets[R::REF_SD], header.sizes[R::REF_SD]) ||
+             !write_section(file, offset, ref_m, sizeof(double) * n_samples * n_samples, header.offsets[R::REF_M], header.sizes[R::REF_M]) ||
+             !write_section(file, offset, ref_pc, sizeof(double) * n_samples * header.dim, header.offsets[R::REF_PC], header.sizes[R::REF_PC]) ||
+             !write_section(file, offset, pc_var, sizeof(double) * header.dim, header.offsets[R::PC_VAR], header.sizes[R::PC_VAR]) ||
+             !write_section(file, offset, sample_ids.data(), sample_ids.size(), header.offsets[R::SAMPLE_IDS], header.sizes[R::SAMPLE_IDS]) ||
+             !write_section(file, offset, site_keys.data(), site_keys.size(), header.offsets[R::SITE_KEYS], header.sizes[R::SITE_KEYS]) ||
+             (fseek(file, 0L, SEEK_SET) != 0) || (fwrite(&header, sizeof(header), 1u, file) != 1u);
+    failed = (fclose(file) != 0) || failed;
+    if (failed || (rename(tmp_file_name.c_str(), file_name.c_str()) != 0)) {
+        remove(tmp_file_name.c_str());
+        return false;
+    }
+    return true;
+}
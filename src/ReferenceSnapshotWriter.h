@@ -0,0 +1,79 @@
+#ifndef LASER_REFERENCESNAPSHOTWRITER_H
+#define LASER_REFERENCESNAPSHOTWRITER_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <unistd.h>
+#include "ReferenceSnapshotReader.h"
+#include "PackedGenotypeReader.h"
+
+using namespace std;
+
+// Collects the loaded reference panel and writes it as a snapshot (see ReferenceSnapshotReader).
+// The snapshot is written to a temporary file and moved in place by write(), so concurrent runs never see partial
+// snapshots. Floating-point sections are not copied: the arrays passed to set_ref_stats, set_ref_m and set_ref_pc
+// must stay valid until write().
+class ReferenceSnapshotWriter {
+
+private:
+    ReferenceSnapshotReader::Header header;
+    vector<uint32_t> samples;
+    vector<uint32_t> loci;
+    vector<unsigned char> genotypes;
+    string sample_ids;
+    string site_keys;
+    const float* ref_mean;
+    const float* ref_sd;
+    const double* ref_m;
+    const double* ref_pc;
+    const double* pc_var;
+
+    static bool write_section(FILE* file, uint64_t& offset, const void* data, uint64_t size, uint64_t& section_offset, uint64_t& section_size);
+
+public:
+    ReferenceSnapshotWriter();
+    virtual ~ReferenceSnapshotWriter();
+
+    // Returns false if any of the files can't be accessed. The coord_file_name is empty if there is no COORD_FILE.
+    bool set_sources(const string& geno_file_name, const string& site_file_name, const string& coord_file_name,
+                     unsigned int geno_samples, unsigned int geno_loci, unsigned int coord_pcs);
+    // Flags (see ReferenceSnapshotReader) of the files whose format was checked in this run.
+    void set_checked(uint32_t checked);
+    void set_samples(const vector<uint32_t>& samples, const string* population_ids, const string* individual_ids);
+    void set_loci(const vector<uint32_t>& loci, const vector<string>& site_keys);
+    // Genotypes of samples x loci stored column by column (as in armadillo matrices). Returns false if some genotype
+    // is not 0, 1, 2 or -9, because such genotypes can't be packed.
+    template<typename T> bool set_genotypes(const T* values) {
+        size_t row_size = PackedGenotypeReader::get_row_size(header.n_loci);
+        unsigned int code = 0u;
+
+        genotypes.assign((size_t)header.n_samples * row_size, 0u);
+        for (unsigned int j = 0u; j < header.n_loci; ++j) {
+            for (unsigned int i = 0u; i < header.n_samples; ++i) {
+                T value = values[(size_t)j * header.n_samples + i];
+                if ((value == 0) || (value == 1) || (value == 2)) {
+                    code = (unsigned int)value;
+                } else if (value == -9) {
+                    code = PackedGenotypeReader::MISSING_CODE;
+                } else {
+                    genotypes.clear();
+                    return false;
+                }
+                genotypes[(size_t)i * row_size + (j >> 2u)] |= (unsigned char)(code << ((j & 3u) << 1u));
+            }
+        }
+        return true;
+    }
+    void set_ref_stats(const float* ref_mean, const float* ref_sd);
+    void set_ref_m(const double* ref_m);
+    // pc_var is nullptr if the coordinates were read from COORD_FILE.
+    void set_ref_pc(const double* ref_pc, unsigned int dim, const double* pc_var);
+    bool write(const string& file_name);
+};
+
+
+#endif //LASER_REFERENCESNAPSHOTWRITER_H
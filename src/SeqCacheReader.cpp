@@ -0,0 +1,127 @@
+#include "SeqCacheReader.h"
+
+const char SeqCacheReader::MAGIC[8] = { 'L', 'A', 'S', 'E', 'R', 'S', 'Q', 'C' };
+const uint32_t SeqCacheReader::VERSION = 1u;
+const string SeqCacheReader::EXTENSION = ".seqcache";
+
+bool SeqCacheReader::get_source_key(const string& seq_file_name, uint64_t& size, int64_t& mtime) {
+    struct stat file_stat;
+
+    if (stat(seq_file_name.c_str(), &file_stat) != 0) {
+        return false;
+    }
+    size = (uint64_t)file_stat.st_size;
+    mtime = (int64_t)file_stat.st_mtime;
+    return true;
+}
+
+SeqCacheReader::SeqCacheReader(): mapping(nullptr), mapping_size(0u), row_size(0u) {
+    memset(&header, 0, sizeof(header));
+}
+
+SeqCacheReader::~SeqCacheReader() {
+    close();
+}
+
+bool SeqCacheReader::open(const string& seq_file_name) noexcept(false) {
+    struct stat file_stat;
+    uint64_t source_size = 0u;
+    int64_t source_mtime = 0;
+    const char* ids = nullptr;
+    const char* ids_end = nullptr;
+    const char* tab = nullptr;
+    const char* line_end = nullptr;
+    int fd = 0;
+
+    close();
+    file_name = seq_file_name + EXTENSION;
+    if (!get_source_key(seq_file_name, source_size, source_mtime)) {
+        return false;
+    }
+    fd = ::open(file_name.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    if ((fstat(fd, &file_stat) != 0) || ((size_t)file_stat.st_size < sizeof(Header))) {
+        ::close(fd);
+        return false;
+    }
+    mapping_size = (size_t)file_stat.st_size;
+    mapping = (char*)mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        return false;
+    }
+    memcpy(&header, mapping, sizeof(Header));
+    row_size = get_row_size(header.n_loci);
+    if ((memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) || (header.version != VERSION) ||
+        (header.source_size != source_size) || (header.source_mtime != source_mtime) ||
+        (header.ids_offset != sizeof(Header) + (uint64_t)header.n_samples * row_size) || (header.ids_offset > mapping_size)) {
+        close();
+        return false;
+    }
+
+    ids = mapping + header.ids_offset;
+    ids_end = mapping + mapping_size;
+    population_ids.clear();
+    individual_ids.clear();
+    population_ids.reserve(header.n_samples);
+    individual_ids.reserve(header.n_samples);
+    for (unsigned int i = 0u; i < header.n_samples; ++i) {
+        tab = (const char*)memchr(ids, '\t', ids_end - ids);
+        line_end = (tab != nullptr) ? (const char*)memchr(tab, '\n', ids_end - tab) : nullptr;
+        if (line_end == nullptr) {
+            close();
+            return false;
+        }
+        population_ids.emplace_back(ids, tab);
+        individual_ids.emplace_back(tab + 1, line_end);
+        ids = line_end + 1;
+    }
+    madvise(mapping, header.ids_offset, MADV_SEQUENTIAL);
+    return true;
+}
+
+void SeqCacheReader::close() {
+    if (mapping != nullptr) {
+        munmap(mapping, mapping_size);
+        mapping = nullptr;
+        mapping_size = 0u;
+    }
+}
+
+unsigned int SeqCacheReader::get_n_samples() {
+    return header.n_samples;
+}
+
+unsigned int SeqCacheReader::get_n_loci() {
+    return header.n_loci;
+}
+
+const string& SeqCacheReader::get_population_id(unsigned int sample) noexcept(false) {
+    return population_ids.at(sample);
+}
+
+const string& SeqCacheReader::get_individual_id(unsigned int sample) noexcept(false) {
+    return individual_ids.at(sample);
+}
+
+const char* SeqCacheReader::get_row(unsigned int sample) noexcept(false) {
+    if ((mapping == nullptr) || (sample >= header.n_samples)) {
+        throw runtime_error("Error while reading '" + file_name + "' file.");
+    }
+    return mapping + sizeof(Header) + (size_t)sample * row_size;
+}
+
+const uint16_t* SeqCacheReader::get_coverage(unsigned int sample) noexcept(false) {
+    return (const uint16_t*)get_row(sample);
+}
+
+const uint16_t* SeqCacheReader::get_reads(unsigned int sample) noexcept(false) {
+    return (const uint16_t*)(get_row(sample) + 2u * (size_t)header.n_loci);
+}
+
+const uint8_t* SeqCacheReader::get_quality(unsigned int sample) noexcept(false) {
+    return (const uint8_t*)(get_row(sample) + 4u * (size_t)header.n_loci);
+}
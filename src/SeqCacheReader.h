@@ -0,0 +1,72 @@
+#ifndef LASER_SEQCACHEREADER_H
+#define LASER_SEQCACHEREADER_H
+
+#include <iostream>
+#include <string>
+#include <stdexcept>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+// Binary cache of a SEQ file (SEQ_FILE + EXTENSION), written next to the SEQ file by SeqCacheWriter.
+// Layout: header, one row per sample with coverage (uint16 x n_loci), reference reads (uint16 x n_loci) and
+// quality (uint8 x n_loci) padded to 8 bytes, then sample IDs ("popID\tindivID\n" per sample).
+// Size and modification time of the SEQ file are stored in the header; a cache that doesn't match them is stale.
+class SeqCacheReader {
+
+public:
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t n_samples;
+        uint32_t n_loci;
+        uint32_t reserved;
+        uint64_t source_size;
+        int64_t source_mtime;
+        uint64_t ids_offset;
+    };
+
+    static const char MAGIC[8];
+    static const uint32_t VERSION;
+    static const string EXTENSION;
+
+private:
+    string file_name;
+    char* mapping;
+    size_t mapping_size;
+    Header header;
+    size_t row_size;
+    vector<string> population_ids;
+    vector<string> individual_ids;
+
+    const char* get_row(unsigned int sample) noexcept(false);
+
+public:
+    static size_t get_row_size(unsigned int n_loci) { return ((5u * (size_t)n_loci + 7u) / 8u) * 8u; }
+    static bool get_source_key(const string& seq_file_name, uint64_t& size, int64_t& mtime);
+
+    SeqCacheReader();
+    virtual ~SeqCacheReader();
+
+    // Opens cache of the SEQ file. Returns false if there is no cache or it is stale.
+    bool open(const string& seq_file_name) noexcept(false);
+    void close();
+
+    unsigned int get_n_samples();
+    unsigned int get_n_loci();
+    const string& get_population_id(unsigned int sample) noexcept(false);
+    const string& get_individual_id(unsigned int sample) noexcept(false);
+    // Values of the 0-based sample; point into the memory-mapped cache.
+    const uint16_t* get_coverage(unsigned int sample) noexcept(false);
+    const uint16_t* get_reads(unsigned int sample) noexcept(false);
+    const uint8_t* get_quality(unsigned int sample) noexcept(false);
+};
+
+
+#endif //LASER_SEQCACHEREADER_H
@@ -0,0 +1,116 @@
+#include "SeqCacheWriter.h"
+
+SeqCacheWriter::SeqCacheWriter(): file(nullptr) {
+    memset(&header, 0, sizeof(header));
+}
+
+SeqCacheWriter::~SeqCacheWriter() {
+    discard();
+}
+
+bool SeqCacheWriter::open(const string& seq_file_name, unsigned int n_loci) {
+    discard();
+    file_name = seq_file_name + SeqCacheReader::EXTENSION;
+    tmp_file_name = file_name + ".tmp." + to_string(getpid());
+    memcpy(header.magic, SeqCacheReader::MAGIC, sizeof(header.magic));
+    header.version = SeqCacheReader::VERSION;
+    header.n_samples = 0u;
+    header.n_loci = n_loci;
+    header.ids_offset = sizeof(header);
+    if (!SeqCacheReader::get_source_key(seq_file_name, header.source_size, header.source_mtime)) {
+        return false;
+    }
+    file = fopen(tmp_file_name.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    row.assign(SeqCacheReader::get_row_size(n_loci), 0);
+    ids.clear();
+    if (fwrite(&header, sizeof(header), 1u, file) != 1u) { // rewritten by close()
+        discard();
+        return false;
+    }
+    return true;
+}
+
+bool SeqCacheWriter::is_open() {
+    return file != nullptr;
+}
+
+// Parses unsigned integer followed by the terminator and moves the token past the terminator.
+bool SeqCacheWriter::parse_value(const char*& token, char terminator, unsigned int max_value, unsigned int& value) {
+    const char* start = token;
+
+    value = 0u;
+    while ((*token >= '0') && (*token <= '9')) {
+        value = value * 10u + (unsigned int)(*token - '0');
+        if (value > max_value) {
+            return false;
+        }
+        ++token;
+    }
+    if ((token == start) || (*token != terminator)) {
+        return false;
+    }
+    ++token;
+    return true;
+}
+
+bool SeqCacheWriter::write_row(const vector<char*>& tokens, unsigned int first_value) {
+    uint16_t* coverage = (uint16_t*)row.data();
+    uint16_t* reads = coverage + header.n_loci;
+    uint8_t* quality = (uint8_t*)(reads + header.n_loci);
+    const char* token = nullptr;
+    unsigned int c = 0u, s = 0u, q = 0u;
+
+    if (file == nullptr) {
+        return false;
+    }
+    if (tokens.size() != first_value + header.n_loci) {
+        discard();
+        return false;
+    }
+    for (unsigned int j = 0u; j < header.n_loci; ++j) {
+        token = tokens[first_value + j];
+        if (!parse_value(token, ' ', UINT16_MAX, c) || !parse_value(token, ' ', c, s) || !parse_value(token, '\0', UINT8_MAX, q)) {
+            discard();
+            return false;
+        }
+        coverage[j] = (uint16_t)c;
+        reads[j] = (uint16_t)s;
+        quality[j] = (uint8_t)q;
+    }
+    if (fwrite(row.data(), 1u, row.size(), file) != row.size()) {
+        discard();
+        return false;
+    }
+    ids.append(tokens[0]).append("\t").append(tokens[1]).append("\n");
+    ++header.n_samples;
+    header.ids_offset += row.size();
+    return true;
+}
+
+bool SeqCacheWriter::close() {
+    bool failed = false;
+
+    if (file == nullptr) {
+        return false;
+    }
+    failed = (fwrite(ids.data(), 1u, ids.size(), file) != ids.size()) || (fseek(file, 0L, SEEK_SET) != 0) ||
+             (fwrite(&header, sizeof(header), 1u, file) != 1u);
+    failed = (fclose(file) != 0) || failed;
+    file = nullptr;
+    if (failed || (rename(tmp_file_name.c_str(), file_name.c_str()) != 0)) {
+        remove(tmp_file_name.c_str());
+        return false;
+    }
+    return true;
+}
+
+void SeqCacheWriter::discard() {
+    if (file != nullptr) {
+        fclose(file);
+        file = nullptr;
+        remove(tmp_file_name.c_str());
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef LASER_SEQCACHEWRITER_H
+#define LASER_SEQCACHEWRITER_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <unistd.h>
+#include "SeqCacheReader.h"
+
+using namespace std;
+
+// Writes binary cache of a SEQ file (see SeqCacheReader) row by row while the SEQ file is being read.
+// The cache is written to a temporary file and moved in place by close(), so concurrent runs never see partial caches.
+// Any failure (values that don't fit, I/O errors) just leaves no cache behind.
+class SeqCacheWriter {
+
+private:
+    string file_name;
+    string tmp_file_name;
+    FILE* file;
+    SeqCacheReader::Header header;
+    vector<char> row;
+    string ids;
+
+    static bool parse_value(const char*& token, char terminator, unsigned int max_value, unsigned int& value);
+
+public:
+    SeqCacheWriter();
+    virtual ~SeqCacheWriter();
+
+    bool open(const string& seq_file_name, unsigned int n_loci);
+    bool is_open();
+    // Returns false (and discards the cache) if the row can't be cached exactly.
+    bool write_row(const vector<char*>& tokens, unsigned int first_value);
+    bool close();
+    void discard();
+};
+
+
+#endif //LASER_SEQCACHEWRITER_H
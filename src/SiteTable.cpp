@@ -0,0 +1,201 @@
+#include "SiteTable.h"
+
+const size_t SiteTable::NOT_FOUND = (size_t)-1;
+
+SiteTable::SiteTable(): sorted(true) {
+
+}
+
+SiteTable::~SiteTable() {
+
+}
+
+uint32_t SiteTable::intern(const string& name, vector<string>& names, unordered_map<string, uint32_t>& ids) {
+    auto inserted = ids.emplace(name, (uint32_t)names.size());
+    if (inserted.second) {
+        names.push_back(name);
+    }
+    return inserted.first->second;
+}
+
+bool SiteTable::read(const string& file_name, const unordered_set<string>* excluded_ids, string& message) noexcept(false) {
+    TableReader reader;
+    vector<char*> tokens;
+    string alleles;
+    Site site;
+    bool vcf = VcfReader::is_vcf(file_name);
+    vector<bool> vcf_columns(5u, true); // CHROM, POS, ID, REF and ALT are the first columns of VCF records
+
+    reader.set_file_name(file_name);
+    reader.open();
+    if (!vcf) {
+        reader.read_row(tokens, '\t'); //skip header TODO: check if header = CHR\tPOS\tID\tREF\tALT
+    }
+    while ((vcf ? reader.read_row(tokens, '\t', vcf_columns) : reader.read_row(tokens, '\t')) >= 0) {
+        if (vcf && !tokens.empty() && (tokens[0][0] == '#')) { // meta-information and header lines
+            continue;
+        }
+        if (tokens.size() != 5) {
+            message = "Error: incorrect number of columns in '" + file_name + "'.";
+            reader.close();
+            return false;
+        }
+        uint64_t position = 0u;
+        const char* digit = tokens[1];
+        while ((*digit >= '0') && (*digit <= '9') && (position <= UINT32_MAX)) {
+            position = position * 10u + (uint64_t)(*digit - '0');
+            ++digit;
+        }
+        if ((digit == tokens[1]) || (*digit != '\0') || (position > UINT32_MAX)) {
+            message = "Error: invalid position '" + string(tokens[1]) + "' in '" + file_name + "'.";
+            reader.close();
+            return false;
+        }
+        alleles.assign(tokens[3]).append(",").append(tokens[4]);
+        site.chromosome = intern(tokens[0], chromosome_names, chromosome_ids);
+        site.position = (uint32_t)position;
+        site.alleles = intern(alleles, allele_names, allele_ids);
+
+        if (site.chromosome >= blocks.size()) { // first site on this chromosome
+            blocks.emplace_back(sites.size(), sites.size());
+        } else if ((site.chromosome != sites.back().chromosome) || (site.position <= sites.back().position)) {
+            sorted = false; // chromosome is split into several blocks or positions are not increasing
+        }
+        blocks[site.chromosome].second = sites.size() + 1u;
+        sites.push_back(site);
+        excluded.push_back((excluded_ids != nullptr) && (excluded_ids->count(tokens[2]) > 0));
+    }
+    reader.close();
+    return true;
+}
+
+bool SiteTable::load(const string& file_name, const unordered_set<string>* excluded_ids, string& message) noexcept(false) {
+    clear();
+    for (auto&& name: split_file_list(file_name)) { // sites of a list of files (e.g. one per chromosome) follow each other
+        if (!read(name, excluded_ids, message)) {
+            return false;
+        }
+    }
+    if (!sorted) {
+        blocks.clear();
+        index.reserve(sites.size());
+        for (size_t i = 0u; i < sites.size(); ++i) {
+            index[get_key(sites[i])] = i;
+        }
+    }
+    return true;
+}
+
+void SiteTable::clear() {
+    sites.clear();
+    excluded.clear();
+    chromosome_names.clear();
+    chromosome_ids.clear();
+    allele_names.clear();
+    allele_ids.clear();
+    blocks.clear();
+    index.clear();
+    sorted = true;
+}
+
+size_t SiteTable::size() const {
+    return sites.size();
+}
+
+bool SiteTable::is_sorted() const {
+    return sorted;
+}
+
+bool SiteTable::is_excluded(size_t site) const {
+    return excluded[site];
+}
+
+string SiteTable::get_name(size_t site) const {
+    return chromosome_names[sites[site].chromosome] + ":" + to_string(sites[site].position);
+}
+
+const string& SiteTable::get_alleles(size_t site) const {
+    return allele_names[sites[site].alleles];
+}
+
+size_t SiteTable::find(uint32_t chromosome, uint32_t position) const {
+    if (sorted) {
+        if (chromosome >= blocks.size()) {
+            return NOT_FOUND;
+        }
+        auto first = sites.begin() + blocks[chromosome].first;
+        auto last = sites.begin() + blocks[chromosome].second;
+        auto found = lower_bound(first, last, position, [](const Site& site, uint32_t position) { return site.position < position; });
+        return ((found != last) && (found->position == position)) ? (size_t)(found - sites.begin()) : NOT_FOUND;
+    }
+    Site site = { chromosome, position, 0u };
+    auto found = index.find(get_key(site));
+    return (found != index.end()) ? found->second : NOT_FOUND;
+}
+
+size_t SiteTable::find(const string& chromosome, uint32_t position) const {
+    auto found = chromosome_ids.find(chromosome);
+    if (found == chromosome_ids.end()) {
+        found = chromosome_ids.find((chromosome.compare(0u, 3u, "chr") == 0) ? chromosome.substr(3u) : "chr" + chromosome);
+        if (found == chromosome_ids.end()) {
+            return NOT_FOUND;
+        }
+    }
+    return find(found->second, position);
+}
+
+size_t SiteTable::get_last(size_t site) const {
+    return sorted ? site : find(sites[site].chromosome, sites[site].position);
+}
+
+void SiteTable::intersect(const SiteTable& other, const function<void(size_t, size_t, bool)>& visit) const {
+    vector<size_t> chromosome_map(chromosome_names.size(), NOT_FOUND); // ids of this table's chromosomes and alleles in the other table
+    vector<size_t> allele_map(allele_names.size(), NOT_FOUND);
+
+    for (size_t c = 0u; c < chromosome_names.size(); ++c) {
+        auto found = other.chromosome_ids.find(chromosome_names[c]);
+        if (found != other.chromosome_ids.end()) {
+            chromosome_map[c] = found->second;
+        }
+    }
+    for (size_t a = 0u; a < allele_names.size(); ++a) {
+        auto found = other.allele_ids.find(allele_names[a]);
+        if (found != other.allele_ids.end()) {
+            allele_map[a] = found->second;
+        }
+    }
+
+    if (sorted && other.sorted) { // merge join chromosome by chromosome
+        uint32_t chromosome = 0u;
+        size_t j = 0u, end = 0u;
+        for (size_t i = 0u; i < sites.size(); ++i) {
+            const Site& site = sites[i];
+            if ((i == 0u) || (site.chromosome != chromosome)) {
+                chromosome = site.chromosome;
+                if (chromosome_map[chromosome] == NOT_FOUND) {
+                    j = end = 0u;
+                } else {
+                    j = other.blocks[chromosome_map[chromosome]].first;
+                    end = other.blocks[chromosome_map[chromosome]].second;
+                }
+            }
+            while ((j < end) && (other.sites[j].position < site.position)) {
+                ++j;
+            }
+            if ((j < end) && (other.sites[j].position == site.position)) {
+                visit(i, j, allele_map[site.alleles] == other.sites[j].alleles);
+            }
+        }
+    } else {
+        for (size_t i = 0u; i < sites.size(); ++i) {
+            const Site& site = sites[i];
+            if (chromosome_map[site.chromosome] == NOT_FOUND) {
+                continue;
+            }
+            size_t j = other.find((uint32_t)chromosome_map[site.chromosome], site.position);
+            if (j != NOT_FOUND) {
+                visit(i, j, allele_map[site.alleles] == other.sites[j].alleles);
+            }
+        }
+    }
+}
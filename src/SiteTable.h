@@ -0,0 +1,77 @@
+#ifndef LASER_SITETABLE_H
+#define LASER_SITETABLE_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include "TableReader.h"
+#include "aux.h"
+#include "VcfReader.h"
+
+using namespace std;
+
+// Compact in-memory copy of a site file (CHROM, POS, ID, REF, ALT). Every site takes 12 bytes: chromosome and alleles
+// ("REF,ALT") are interned per table, and site IDs are not kept at all; they are only looked up in the exclusion list
+// while the file is read. If every chromosome forms one block with strictly increasing positions (the usual case),
+// two tables are intersected by a linear merge join; otherwise a hash index of the sites is used.
+class SiteTable {
+
+public:
+    struct Site {
+        uint32_t chromosome;
+        uint32_t position;
+        uint32_t alleles;
+    };
+
+    static const size_t NOT_FOUND;
+
+private:
+    vector<Site> sites;
+    vector<bool> excluded;
+    vector<string> chromosome_names;
+    unordered_map<string, uint32_t> chromosome_ids;
+    vector<string> allele_names;
+    unordered_map<string, uint32_t> allele_ids;
+    bool sorted;
+    vector<pair<size_t, size_t>> blocks;   // [first, last) sites of every chromosome if the table is sorted
+    unordered_map<uint64_t, size_t> index; // chromosome and position to the last site with them if it isn't sorted
+
+    static uint64_t get_key(const Site& site) { return ((uint64_t)site.chromosome << 32u) | site.position; }
+    uint32_t intern(const string& name, vector<string>& names, unordered_map<string, uint32_t>& ids);
+    size_t find(uint32_t chromosome, uint32_t position) const;
+    bool read(const string& file_name, const unordered_set<string>* excluded_ids, string& message) noexcept(false);
+
+public:
+    SiteTable();
+    virtual ~SiteTable();
+
+    // Reads the site file (header line and 5 columns per site) or a comma-separated list of site files, e.g. one per
+    // chromosome, whose sites are appended in the order of the list. VCF files are read as site files of their own
+    // records. Sites with IDs in excluded_ids are flagged as excluded. Returns false and sets message if a file has
+    // wrong format.
+    bool load(const string& file_name, const unordered_set<string>* excluded_ids, string& message) noexcept(false);
+    void clear();
+
+    size_t size() const;
+    bool is_sorted() const;
+    bool is_excluded(size_t site) const;
+    string get_name(size_t site) const;           // "CHROM:POS"
+    const string& get_alleles(size_t site) const; // "REF,ALT"
+    // Index of the last site with the same chromosome and position (the site itself if there are no duplicates).
+    size_t get_last(size_t site) const;
+    // Index of a site at the chromosome and position, or NOT_FOUND. Chromosome names match with or without "chr".
+    size_t find(const string& chromosome, uint32_t position) const;
+
+    // Calls visit(i, j, same_alleles) for every site i of this table (in order) that has the same chromosome and position
+    // as site j of the other table; j is the last such site of the other table.
+    void intersect(const SiteTable& other, const function<void(size_t, size_t, bool)>& visit) const;
+};
+
+
+#endif //LASER_SITETABLE_H
@@ -0,0 +1,267 @@
+#include "SparseSeqReader.h"
+
+const char SparseSeqReader::MAGIC[8] = { 'L', 'A', 'S', 'E', 'R', 'S', 'S', 'Q' };
+const uint32_t SparseSeqReader::VERSION = 1u;
+const string SparseSeqReader::TEXT_EXTENSION = ".sseq";
+const string SparseSeqReader::BINARY_EXTENSION = ".bseq";
+
+static bool ends_with(const string& file_name, const string& extension) {
+    return (file_name.length() > extension.length()) && (file_name.compare(file_name.length() - extension.length(), extension.length(), extension) == 0);
+}
+
+bool SparseSeqReader::is_sparse(const string& file_name) {
+    return ends_with(file_name, TEXT_EXTENSION) || ends_with(file_name, TEXT_EXTENSION + ".gz") || ends_with(file_name, BINARY_EXTENSION);
+}
+
+bool SparseSeqReader::is_binary(const string& file_name) {
+    return ends_with(file_name, BINARY_EXTENSION);
+}
+
+bool SparseSeqReader::is_pileup(const string& file_name) {
+    for (auto&& name : split_file_list(file_name)) {
+        if (!PileupReader::is_pileup(name)) {
+            return false;
+        }
+    }
+    return !file_name.empty();
+}
+
+bool SparseSeqReader::can_read(const string& file_name) {
+    return is_sparse(file_name) || is_pileup(file_name);
+}
+
+bool SparseSeqReader::parse_values(const char* field, Record& record) {
+    char* end = nullptr;
+    unsigned long coverage = 0u;
+
+    errno = 0;
+    coverage = strtoul(field, &end, 10);
+    if ((end == field) || (*end != ' ') || (errno == ERANGE) || (coverage > UINT32_MAX)) {
+        return false;
+    }
+    record.coverage = (uint32_t)coverage;
+    field = end;
+    record.reads = strtof(field, &end);
+    if ((end == field) || (*end != ' ') || (errno == ERANGE) || (record.reads < 0) || (record.reads > record.coverage)) {
+        return false;
+    }
+    field = end;
+    record.quality = strtof(field, &end);
+    return (end != field) && (*end == '\0') && (errno != ERANGE) && (record.quality >= 0);
+}
+
+SparseSeqReader::SparseSeqReader(): binary(false), pileup(false), n_loci(0u), sample(0u), mapping(nullptr), mapping_size(0u), index(nullptr) {
+    memset(&header, 0, sizeof(header));
+}
+
+SparseSeqReader::~SparseSeqReader() {
+    if (mapping != nullptr) {
+        munmap(mapping, mapping_size);
+    }
+}
+
+void SparseSeqReader::set_file_name(const string& file_name) {
+    this->file_name = file_name;
+}
+
+const string& SparseSeqReader::get_file_name() {
+    return file_name;
+}
+
+void SparseSeqReader::set_locator(const PileupReader::Locator& locator) {
+    this->locator = locator;
+}
+
+void SparseSeqReader::open(unsigned int n_loci) noexcept(false) {
+    struct stat file_stat;
+    const char* ids = nullptr;
+    const char* ids_end = nullptr;
+    const char* tab = nullptr;
+    const char* line_end = nullptr;
+    int fd = 0;
+
+    close();
+    sample = 0u;
+    binary = is_binary(file_name);
+    pileup = is_pileup(file_name);
+    if (pileup) {
+        this->n_loci = n_loci;
+        pileup_files = split_file_list(file_name);
+        for (auto&& name : pileup_files) {
+            if (access(name.c_str(), R_OK) != 0) {
+                throw runtime_error("Error while opening '" + name + "' file.");
+            }
+        }
+        return;
+    }
+    if (!binary) {
+        this->n_loci = n_loci;
+        text_reader.set_file_name(file_name);
+        text_reader.open();
+        return;
+    }
+    fd = ::open(file_name.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw runtime_error("Error while opening '" + file_name + "' file.");
+    }
+    if ((fstat(fd, &file_stat) != 0) || ((size_t)file_stat.st_size < sizeof(Header))) {
+        ::close(fd);
+        throw runtime_error("Error while reading header of '" + file_name + "' file.");
+    }
+    mapping_size = (size_t)file_stat.st_size;
+    mapping = (char*)mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        throw runtime_error("Error while opening '" + file_name + "' file.");
+    }
+    memcpy(&header, mapping, sizeof(Header));
+    if ((memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) || (header.version != VERSION) ||
+        (header.index_offset != sizeof(Header) + header.n_records * sizeof(BinaryRecord)) ||
+        (header.ids_offset != header.index_offset + 8u * ((uint64_t)header.n_samples + 1u)) || (header.ids_offset > mapping_size)) {
+        close();
+        throw runtime_error("'" + file_name + "' is not a valid sparse SEQ file.");
+    }
+    this->n_loci = header.n_loci;
+    index = (const uint64_t*)(mapping + header.index_offset);
+    if (index[header.n_samples] != header.n_records) {
+        close();
+        throw runtime_error("'" + file_name + "' is not a valid sparse SEQ file.");
+    }
+
+    ids = mapping + header.ids_offset;
+    ids_end = mapping + mapping_size;
+    population_ids.reserve(header.n_samples);
+    individual_ids.reserve(header.n_samples);
+    for (unsigned int i = 0u; i < header.n_samples; ++i) {
+        tab = (const char*)memchr(ids, '\t', ids_end - ids);
+        line_end = (tab != nullptr) ? (const char*)memchr(tab, '\n', ids_end - tab) : nullptr;
+        if (line_end == nullptr) {
+            close();
+            throw runtime_error("Error while reading sample IDs from '" + file_name + "' file.");
+        }
+        population_ids.emplace_back(ids, tab);
+        individual_ids.emplace_back(tab + 1, line_end);
+        ids = line_end + 1;
+    }
+    madvise(mapping, header.index_offset, MADV_SEQUENTIAL);
+}
+
+void SparseSeqReader::close() noexcept(false) {
+    if (text_reader.is_open()) {
+        text_reader.close();
+    }
+    if (mapping != nullptr) {
+        munmap(mapping, mapping_size);
+        mapping = nullptr;
+        mapping_size = 0u;
+    }
+    index = nullptr;
+    pileup_files.clear();
+    population_ids.clear();
+    individual_ids.clear();
+}
+
+unsigned int SparseSeqReader::get_n_loci() {
+    return n_loci;
+}
+
+unsigned int SparseSeqReader::get_n_samples() {
+    return binary ? header.n_samples : (unsigned int)pileup_files.size();
+}
+
+void SparseSeqReader::seek_sample(unsigned int sample) noexcept(false) {
+    if (binary || pileup) {
+        this->sample = sample;
+    } else if (text_reader.seek_row(sample)) {
+        this->sample = sample;
+    } else {
+        if (sample < this->sample) {
+            text_reader.reset();
+            this->sample = 0u;
+        }
+        while ((this->sample < sample) && (text_reader.read_row(tokens, '\t') >= 0)) {
+            ++this->sample;
+        }
+    }
+}
+
+string SparseSeqReader::get_error(const char* field) const {
+    return "Error: invalid covered locus '" + string(field) + "' of individual " + to_string(sample) + " in '" + file_name + "'.";
+}
+
+bool SparseSeqReader::read_sample(string& population_id, string& individual_id, vector<Record>& records) noexcept(false) {
+    Record record;
+    char* end = nullptr;
+    unsigned long locus = 0u;
+
+    records.clear();
+    if (binary) {
+        if ((mapping == nullptr) || (sample >= header.n_samples)) {
+            return false;
+        }
+        if ((index[sample] > index[sample + 1u]) || (index[sample + 1u] > header.n_records)) {
+            throw runtime_error("Error while reading '" + file_name + "' file.");
+        }
+        const BinaryRecord* binary_records = (const BinaryRecord*)(mapping + sizeof(Header));
+        records.reserve(index[sample + 1u] - index[sample]);
+        for (uint64_t r = index[sample]; r < index[sample + 1u]; ++r) {
+            if ((binary_records[r].locus >= n_loci) || (!records.empty() && (binary_records[r].locus <= records.back().locus))) {
+                throw runtime_error("Error while reading '" + file_name + "' file.");
+            }
+            record.locus = binary_records[r].locus;
+            record.coverage = binary_records[r].coverage;
+            record.reads = binary_records[r].reads;
+            record.quality = binary_records[r].quality;
+            records.push_back(record);
+        }
+        population_id = population_ids[sample];
+        individual_id = individual_ids[sample];
+        ++sample;
+        return true;
+    }
+
+    if (pileup) {
+        if (sample >= pileup_files.size()) {
+            return false;
+        }
+        if (!locator) {
+            throw runtime_error("Error: loci of the pileup files in '" + file_name + "' are unknown.");
+        }
+        pileup_reader.set_file_name(pileup_files[sample]);
+        pileup_reader.read(locator, pileup_loci);
+        records.reserve(pileup_loci.size());
+        for (auto&& locus : pileup_loci) {
+            record.locus = locus.locus;
+            record.coverage = locus.coverage;
+            record.reads = (float)locus.reads;
+            record.quality = locus.quality;
+            records.push_back(record);
+        }
+        population_id = individual_id = PileupReader::get_sample_id(pileup_files[sample]);
+        ++sample;
+        return true;
+    }
+
+    if (text_reader.read_row(tokens, '\t') < 0) {
+        return false;
+    }
+    ++sample;
+    if (tokens.size() < 2u) {
+        throw runtime_error("Error: incorrect number of columns in row " + to_string(sample) + " in '" + file_name + "'.");
+    }
+    population_id.assign(tokens[0]);
+    individual_id.assign(tokens[1]);
+    records.reserve(tokens.size() - 2u);
+    for (size_t j = 2u; j < tokens.size(); ++j) {
+        errno = 0;
+        locus = strtoul(tokens[j], &end, 10);
+        if ((end == tokens[j]) || (*end != ' ') || (errno == ERANGE) || (locus == 0u) || (locus > n_loci) ||
+            (!records.empty() && (locus - 1u <= records.back().locus)) || !parse_values(end + 1, record)) {
+            throw runtime_error(get_error(tokens[j]));
+        }
+        record.locus = (uint32_t)(locus - 1u);
+        records.push_back(record);
+    }
+    return true;
+}
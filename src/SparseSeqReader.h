@@ -0,0 +1,121 @@
+#ifndef LASER_SPARSESEQREADER_H
+#define LASER_SPARSESEQREADER_H
+
+#include <iostream>
+#include <string>
+#include <stdexcept>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "TableReader.h"
+#include "PileupReader.h"
+#include "aux.h"
+
+using namespace std;
+
+// Sparse SEQ file: the samples x loci table of a SEQ file that lists only the covered loci of every sample.
+// Text variant (*.sseq or bgzip-compressed *.sseq.gz): one row per sample with popID, indivID and then one tab-separated
+// field "LOCUS C S Q" for every covered locus, where LOCUS is the 1-based row of the locus in the site file and C, S, Q
+// are the coverage, reference reads and quality as in a SEQ file. Loci of a sample must be in increasing order.
+// Binary variant (*.bseq, written by SparseSeqWriter): header, records of all samples (BinaryRecord, 0-based loci),
+// index of the first record of every sample (uint64 x (n_samples + 1)), sample IDs ("popID\tindivID\n" per sample).
+// Pileup variant (samtools pileup files *.pileup or *.pileup.gz, a comma-separated list of one file per sample): every
+// file is read by PileupReader with the locator of the site file (see set_locator). The file name without extension is
+// both popID and indivID of the sample.
+class SparseSeqReader {
+
+public:
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t n_samples;
+        uint32_t n_loci;
+        uint32_t reserved;
+        uint64_t n_records;
+        uint64_t index_offset;
+        uint64_t ids_offset;
+    };
+
+    struct BinaryRecord {
+        uint32_t locus;
+        uint16_t coverage;
+        uint16_t reads;
+        uint8_t quality;
+        uint8_t reserved[3];
+    };
+
+    struct Record {
+        uint32_t locus; // 0-based row in the site file
+        uint32_t coverage;
+        float reads;
+        float quality;
+    };
+
+    static const char MAGIC[8];
+    static const uint32_t VERSION;
+    static const string TEXT_EXTENSION;
+    static const string BINARY_EXTENSION;
+
+private:
+    string file_name;
+    bool binary;
+    bool pileup;
+    unsigned int n_loci;
+    unsigned int sample; // 0-based index of the next sample
+    TableReader text_reader;
+    vector<char*> tokens;
+    char* mapping;
+    size_t mapping_size;
+    Header header;
+    const uint64_t* index;
+    vector<string> population_ids;
+    vector<string> individual_ids;
+    vector<string> pileup_files;
+    PileupReader pileup_reader;
+    PileupReader::Locator locator;
+    vector<PileupReader::Locus> pileup_loci;
+
+    string get_error(const char* field) const;
+
+public:
+    static bool is_sparse(const string& file_name);
+    static bool is_binary(const string& file_name);
+    // True if every file of the list is a pileup file.
+    static bool is_pileup(const string& file_name);
+    // Sparse SEQ file or list of pileup files.
+    static bool can_read(const string& file_name);
+    // Parses "C S Q" of a SEQ file field. Returns false if the values are invalid.
+    static bool parse_values(const char* field, Record& record);
+
+    SparseSeqReader();
+    virtual ~SparseSeqReader();
+
+    void set_file_name(const string& file_name);
+    const string& get_file_name();
+    // Finds loci of the positions in pileup files. Must be set before pileup files are read.
+    void set_locator(const PileupReader::Locator& locator);
+
+    // n_loci is the number of loci in the site file. Binary files store their own number of loci (see get_n_loci).
+    // Pileup files are only checked to be readable.
+    void open(unsigned int n_loci) noexcept(false);
+    void close() noexcept(false);
+
+    unsigned int get_n_loci();
+    // Number of samples in a binary file or number of pileup files; 0 for text files, which have to be read to count them.
+    unsigned int get_n_samples();
+
+    // Moves to the 0-based sample: directly in binary files and with the row index in text files (preceding samples are
+    // read if there is no index).
+    void seek_sample(unsigned int sample) noexcept(false);
+    // Reads the next sample. Returns false after the last sample. Throws runtime_error if the sample has invalid values.
+    bool read_sample(string& population_id, string& individual_id, vector<Record>& records) noexcept(false);
+};
+
+
+#endif //LASER_SPARSESEQREADER_H
@@ -0,0 +1,74 @@
+#include "SparseSeqWriter.h"
+
+SparseSeqWriter::SparseSeqWriter(): file(nullptr) {
+    memset(&header, 0, sizeof(header));
+}
+
+SparseSeqWriter::~SparseSeqWriter() {
+    if (file != nullptr) {
+        fclose(file);
+        file = nullptr;
+    }
+}
+
+void SparseSeqWriter::open(const string& file_name, unsigned int n_loci) noexcept(false) {
+    this->file_name = file_name;
+    file = fopen(file_name.c_str(), "wb");
+    if (file == nullptr) {
+        throw runtime_error("Error while creating '" + file_name + "' file.");
+    }
+    memcpy(header.magic, SparseSeqReader::MAGIC, sizeof(header.magic));
+    header.version = SparseSeqReader::VERSION;
+    header.n_samples = 0u;
+    header.n_loci = n_loci;
+    header.n_records = 0u;
+    index.assign(1u, 0u);
+    ids.clear();
+    if (fwrite(&header, sizeof(header), 1u, file) != 1u) { // rewritten by close()
+        throw runtime_error("Error while writing '" + file_name + "' file.");
+    }
+}
+
+long int SparseSeqWriter::write_sample(const char* population_id, const char* individual_id, const vector<SparseSeqReader::Record>& records) noexcept(false) {
+    SparseSeqReader::BinaryRecord binary_record;
+
+    memset(&binary_record, 0, sizeof(binary_record));
+    row.clear();
+    for (size_t r = 0u; r < records.size(); ++r) {
+        const SparseSeqReader::Record& record = records[r];
+        if ((record.locus >= header.n_loci) || ((r > 0u) && (record.locus <= records[r - 1u].locus)) || (record.coverage > UINT16_MAX) ||
+            (record.reads < 0) || (record.reads > record.coverage) || (record.reads != (float)(uint16_t)record.reads) ||
+            (record.quality < 0) || (record.quality > UINT8_MAX) || (record.quality != (float)(uint8_t)record.quality)) {
+            return (long int)r;
+        }
+        binary_record.locus = record.locus;
+        binary_record.coverage = (uint16_t)record.coverage;
+        binary_record.reads = (uint16_t)record.reads;
+        binary_record.quality = (uint8_t)record.quality;
+        row.push_back(binary_record);
+    }
+    if (!row.empty() && (fwrite(row.data(), sizeof(SparseSeqReader::BinaryRecord), row.size(), file) != row.size())) {
+        throw runtime_error("Error while writing '" + file_name + "' file.");
+    }
+    ids.append(population_id).append("\t").append(individual_id).append("\n");
+    ++header.n_samples;
+    header.n_records += row.size();
+    index.push_back(header.n_records);
+    return -1;
+}
+
+void SparseSeqWriter::close() noexcept(false) {
+    if (file == nullptr) {
+        return;
+    }
+    header.index_offset = sizeof(header) + header.n_records * sizeof(SparseSeqReader::BinaryRecord);
+    header.ids_offset = header.index_offset + index.size() * sizeof(uint64_t);
+    bool failed = (fwrite(index.data(), sizeof(uint64_t), index.size(), file) != index.size()) ||
+                  (fwrite(ids.data(), 1u, ids.size(), file) != ids.size()) || (fseek(file, 0L, SEEK_SET) != 0) ||
+                  (fwrite(&header, sizeof(header), 1u, file) != 1u);
+    failed = (fclose(file) != 0) || failed;
+    file = nullptr;
+    if (failed) {
+        throw runtime_error("Error while writing '" + file_name + "' file.");
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef LASER_SPARSESEQWRITER_H
+#define LASER_SPARSESEQWRITER_H
+
+#include <iostream>
+#include <string>
+#include <stdexcept>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include "SparseSeqReader.h"
+
+using namespace std;
+
+// Writes binary sparse SEQ files (see SparseSeqReader). Samples are written as they come; the record index, sample IDs
+// and the final header are written by close().
+class SparseSeqWriter {
+
+private:
+    string file_name;
+    FILE* file;
+    SparseSeqReader::Header header;
+    vector<uint64_t> index;
+    vector<SparseSeqReader::BinaryRecord> row;
+    string ids;
+
+public:
+    SparseSeqWriter();
+    virtual ~SparseSeqWriter();
+
+    void open(const string& file_name, unsigned int n_loci) noexcept(false);
+    // Records must have increasing loci and integer values that fit into the binary records (coverage and reads up to
+    // 65535, quality up to 255). Returns index of the first record that doesn't, or -1 if the sample was written.
+    long int write_sample(const char* population_id, const char* individual_id, const vector<SparseSeqReader::Record>& records) noexcept(false);
+    void close() noexcept(false);
+};
+
+
+#endif //LASER_SPARSESEQWRITER_H
@@ -4,27 +4,83 @@
 
 #include "TableReader.h"
 
-const unsigned int TableReader::DEFAULT_BUFFER_SIZE = 16777216u;
+const unsigned int TableReader::DEFAULT_BUFFER_SIZE = 1048576u;
+const unsigned int TableReader::DEFAULT_BLOCK_SIZE = 4194304u;
 
-TableReader::TableReader(unsigned int buffer_size) noexcept(false): buffer(nullptr), max_line_length(0u), gzfile(nullptr) {
+const string TableReader::INDEX_EXTENSION = ".ridx";
+
+// Limits of one batch of rows that are split and checked in parallel.
+static const int BATCH_ROWS = 4096;
+static const size_t BATCH_BYTES = 67108864u;
+
+static const char INDEX_MAGIC[4] = { 'R', 'I', 'D', 'X' };
+static const uint32_t INDEX_VERSION = 1u;
+
+// Header of the row index. Size and modification time of the indexed file are used to detect stale indices.
+struct IndexHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t file_size;
+    int64_t file_mtime;
+    uint64_t n_rows;
+};
+
+int TableReader::num_threads = 1;
+unsigned int TableReader::read_ahead = 0u;
+
+void TableReader::set_num_threads(int n) {
+    num_threads = (n > 0 ? n : 1);
+}
+
+int TableReader::get_num_threads() {
+    return num_threads;
+}
+
+void TableReader::set_read_ahead(unsigned int n_buffers) {
+    read_ahead = (n_buffers == 1u ? 2u : n_buffers); // one buffer is scanned while the others are filled
+}
+
+void TableReader::set_threads(int n) {
+    threads = (n > 0 ? n : 0);
+}
+
+int TableReader::get_threads() {
+    return (threads > 0 ? threads : num_threads);
+}
+
+TableReader::TableReader(unsigned int buffer_size, unsigned int block_size) noexcept(false): buffer(nullptr), buffer_size(0u), block(nullptr), block_size(0u), block_start(nullptr), block_end(nullptr), mapped(false), mapping(nullptr), mapping_size(0u), gzfile(nullptr), bgzf(nullptr), threads(0), direct(false), ring_head(0u), ring_filled(0u), ring_holding(false), producer_stop(false) {
 //    if (strcmp(zlibVersion(), ZLIB_VERSION) != 0) {
 //        throw runtime_error("Incompatible ZLIB version");
 //    }
     try {
-        buffer = new char[buffer_size];
-        max_line_length = buffer_size - 1u;
+        buffer = new char[buffer_size > 0u ? buffer_size : 1u];
+        this->buffer_size = buffer_size > 0u ? buffer_size : 1u;
+        block = new char[block_size];
+        this->block_size = block_size;
     } catch (bad_alloc& e) {
+        delete[] buffer;
+        buffer = nullptr;
         throw runtime_error("Error in memory allocation");
     }
+    block_start = block_end = block;
 }
 
 TableReader::~TableReader() {
+    stop_producer();
     delete[] buffer;
     buffer = nullptr;
+    delete[] block;
+    block = nullptr;
+    if (mapping != nullptr) {
+        munmap(mapping, mapping_size);
+        mapping = nullptr;
+    }
     if (gzfile != nullptr) {
         gzclose(gzfile);
         gzfile = nullptr;
     }
+    delete bgzf;
+    bgzf = nullptr;
 }
 
 void TableReader::set_file_name(const string& file_name) {
@@ -38,15 +94,196 @@ const string& TableReader::get_file_name() {
 }
 
 void TableReader::open() noexcept(false) {
-    if (gzfile == nullptr) {
+    if (!is_open()) {
+        if (open_mapped()) {
+            return;
+        }
+        if (BgzfReader::is_bgzf(file_name)) {
+            bgzf = new BgzfReader();
+            bgzf->open(file_name);
+            block_start = block_end = block;
+            return;
+        }
         gzfile = gzopen(file_name.c_str(), "rb");
         if (gzfile == nullptr) {
             throw runtime_error("Error while opening '" + file_name + "' file.");
         }
+        gzbuffer(gzfile, 131072u); // larger internal zlib buffer; must be set before the first read
+        block_start = block_end = block;
+    }
+}
+
+bool TableReader::open_mapped() noexcept(false) {
+    unsigned char magic[2] = {0u, 0u};
+    struct stat file_stat;
+    void* address = nullptr;
+    int fd = ::open(file_name.c_str(), O_RDONLY);
+
+    if (fd < 0) {
+        throw runtime_error("Error while opening '" + file_name + "' file.");
+    }
+    if ((fstat(fd, &file_stat) != 0) || !S_ISREG(file_stat.st_mode)) { // pipes etc. go through zlib
+        ::close(fd);
+        return false;
+    }
+    if ((pread(fd, magic, 2, 0) == 2) && (magic[0] == 0x1f) && (magic[1] == 0x8b)) { // gzip compressed
+        ::close(fd);
+        return false;
+    }
+    if (file_stat.st_size > 0) {
+        address = mmap(nullptr, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address == MAP_FAILED) {
+            ::close(fd);
+            return false;
+        }
+        mapping = (char*)address;
+        mapping_size = (size_t)file_stat.st_size;
+        madvise(mapping, mapping_size, MADV_SEQUENTIAL);
+    }
+    ::close(fd); // the mapping stays valid after the descriptor is closed
+    mapped = true;
+    block_start = mapping;
+    block_end = mapping + mapping_size;
+    return true;
+}
+
+int TableReader::read_block(vector<char>& destination) noexcept(false) {
+    int n = 0;
+    if (bgzf != nullptr) { // BGZF reader inflates into its own buffer, which is reused by the next fill
+        n = bgzf->fill(get_threads());
+        if (n > 0) {
+            if (destination.size() < (size_t)n) {
+                destination.resize((size_t)n);
+            }
+            memcpy(destination.data(), bgzf->get_data(), (size_t)n);
+        }
+        return n;
+    }
+    return gzread(gzfile, destination.data(), (unsigned int)destination.size());
+}
+
+void TableReader::produce() {
+    unsigned int slot = 0u;
+    int n = 0;
+    do {
+        {
+            unique_lock<mutex> lock(ring_mutex);
+            ring_cv.wait(lock, [this] { return producer_stop || (ring_filled < ring.size()); });
+            if (producer_stop) {
+                return;
+            }
+            slot = (ring_head + ring_filled) % ring.size(); // the consumer doesn't touch slots that are not filled yet
+        }
+        try {
+            n = read_block(ring[slot]);
+        } catch (exception& e) {
+            lock_guard<mutex> lock(ring_mutex);
+            producer_error = e.what();
+            n = -1;
+        }
+        {
+            lock_guard<mutex> lock(ring_mutex);
+            ring_sizes[slot] = n;
+            ++ring_filled;
+        }
+        ring_cv.notify_all();
+    } while (n > 0); // the last slot holds end of file (0) or error (-1)
+}
+
+void TableReader::start_producer() {
+    if (ring.size() != read_ahead) {
+        ring.assign(read_ahead, vector<char>(block_size));
+        ring_sizes.assign(read_ahead, 0);
+    }
+    ring_head = ring_filled = 0u;
+    ring_holding = false;
+    producer_stop = false;
+    producer_error.clear();
+    producer = thread(&TableReader::produce, this);
+}
+
+void TableReader::stop_producer() {
+    if (producer.joinable()) {
+        {
+            lock_guard<mutex> lock(ring_mutex);
+            producer_stop = true;
+        }
+        ring_cv.notify_all();
+        producer.join();
+        ring_head = ring_filled = 0u;
+        ring_holding = false;
+        block_start = block_end = block;
+    }
+}
+
+int TableReader::fill_block() noexcept(false) {
+    int n = 0;
+    if (mapped) { // the whole file is already in memory
+        return 0;
+    }
+    if ((read_ahead > 0u) && !direct) { // take the next slot filled by the producer thread
+        if (!producer.joinable()) {
+            start_producer();
+        }
+        unique_lock<mutex> lock(ring_mutex);
+        if (ring_holding) {
+            if (ring_sizes[ring_head] <= 0) { // producer has finished; keep reporting its last status
+                block_start = block_end = ring[ring_head].data();
+                return ring_sizes[ring_head];
+            }
+            ring_head = (ring_head + 1u) % ring.size();
+            --ring_filled;
+            ring_holding = false;
+            ring_cv.notify_all();
+        }
+        ring_cv.wait(lock, [this] { return ring_filled > 0u; });
+        ring_holding = true;
+        n = ring_sizes[ring_head];
+        if ((n < 0) && !producer_error.empty()) {
+            throw runtime_error(producer_error);
+        }
+        block_start = ring[ring_head].data();
+        block_end = block_start + (n > 0 ? n : 0);
+        return n;
+    }
+    if (bgzf != nullptr) { // blocks are inflated in parallel and scanned directly in the BGZF reader's buffer
+        int n = bgzf->fill(get_threads());
+        block_start = bgzf->get_data();
+        block_end = block_start + n;
+        return n;
     }
+    n = gzread(gzfile, block, block_size);
+    block_start = block;
+    block_end = block + (n > 0 ? n : 0);
+    return n;
 }
 
 void TableReader::close() noexcept(false) {
+    stop_producer();
+    if (mapped) {
+        mapped = false;
+        block_start = block_end = block;
+        if (mapping != nullptr) {
+            int status = munmap(mapping, mapping_size);
+            mapping = nullptr;
+            mapping_size = 0u;
+            if (status != 0) {
+                throw runtime_error("Error while closing '" + file_name + "' file.");
+            }
+        }
+    }
+    if (bgzf != nullptr) {
+        block_start = block_end = block;
+        try {
+            bgzf->close();
+        } catch (...) {
+            delete bgzf;
+            bgzf = nullptr;
+            throw;
+        }
+        delete bgzf;
+        bgzf = nullptr;
+    }
     if (gzfile != nullptr) {
         int gzerrno = 0;
         gzerrno = gzclose(gzfile);
@@ -58,39 +295,65 @@ void TableReader::close() noexcept(false) {
 }
 
 void TableReader::reset() noexcept(false) {
+    stop_producer(); // the producer is restarted from the new position by the next fill_block
+    if (mapped) { // rewind is just a pointer reset
+        block_start = mapping;
+        block_end = mapping + mapping_size;
+        return;
+    }
+    if (bgzf != nullptr) {
+        bgzf->reset();
+        block_start = block_end = block;
+        return;
+    }
     if (gzseek(gzfile, 0L, SEEK_SET) < 0) {
         throw runtime_error("Error while resetting '" + file_name + "' file.");
     }
+    block_start = block_end = block; // drop anything left from the previous pass
 }
 
 bool TableReader::eof() {
-    return gzeof(gzfile) > 0;
+    if (producer.joinable()) {
+        lock_guard<mutex> lock(ring_mutex);
+        return (block_start == block_end) && ring_holding && (ring_sizes[ring_head] == 0);
+    }
+    if (bgzf != nullptr) {
+        return (block_start == block_end) && bgzf->eof();
+    }
+    return (block_start == block_end) && (mapped || (gzeof(gzfile) > 0));
 }
 
 bool TableReader::is_open() {
-    return gzfile != nullptr;
+    return mapped || (gzfile != nullptr) || (bgzf != nullptr);
 }
 
 void TableReader::get_dim(int &nrow, int &ncol, char separator) noexcept(false) {
     vector<pair<int, int>> rows(1, pair<int, int>(1, 0)); // for each row we will store number of detected columns and number of characters.
-    int c = 0;
+    const char* line_end = nullptr;
+    int n = 0, n_separators = 0;
     nrow = 0;
     ncol = 0;
 
     reset(); // make sure we are at the beginning of the file.
-    while (!eof()) {
-        while ((c = gzgetc(gzfile)) >= 0) {
-            if ((char)c == '\n') {
+    do {
+        while (block_start < block_end) { // scan the block line by line without copying
+            line_end = (const char*)memchr(block_start, '\n', block_end - block_start);
+            if (line_end == nullptr) {
+                line_end = block_end; // row continues in the next block
+            }
+            n_separators = (int)DelimiterScanner::count(block_start, line_end, separator);
+            rows.back().first += n_separators;
+            rows.back().second += (int)(line_end - block_start) - n_separators;
+            if (line_end < block_end) {
                 rows.emplace_back(1, 0);
-            } else if ((char)c == separator) {
-                rows.back().first += 1;
+                block_start = line_end + 1;
             } else {
-                rows.back().second += 1;
+                block_start = block_end;
             }
         }
-        if ((c < 0) && (!eof())) {
-            throw runtime_error("Error while reading '" + file_name + "' file.");
-        }
+    } while ((n = fill_block()) > 0);
+    if (n < 0) {
+        throw runtime_error("Error while reading '" + file_name + "' file.");
     }
     for (auto&& row: rows) {
         if ((row.first == 1) && (row.second == 0)) { // empty row - we can ignore it
@@ -109,124 +372,278 @@ void TableReader::get_dim(int &nrow, int &ncol, char separator) noexcept(false)
     reset(); // move to the beginning of the file.
 }
 
-long int TableReader::read_row(vector<string>& tokens, char separator) noexcept(false) {
-    long int i = 0;
-    int c = 0;
-    const char* token = buffer;
+void TableReader::grow_buffer(size_t size, size_t used) noexcept(false) {
+    char* grown = nullptr;
 
-    tokens.clear();
-    while ((i < max_line_length) && ((c = gzgetc(gzfile)) >= 0)) {
-        buffer[i] = (char)c;
-
-        if (buffer[i] == separator) {
-            buffer[i] = '\0';
-            tokens.emplace_back(token);
-            token = buffer + i + 1;
-        } else if (buffer[i] == '\n') {
-            buffer[i] = '\0';
-            tokens.emplace_back(token);
-            return i;
-        } else if (buffer[i] == '\r') {
-            buffer[i] = '\0';
-            tokens.emplace_back(token);
-            if ((c = gzgetc(gzfile)) >= 0) {
-                if ((char)c != '\n') {
-                    c = gzungetc(c, gzfile);
-                }
+    size = max(size, 2u * buffer_size);
+    try {
+        grown = new char[size];
+    } catch (bad_alloc& e) {
+        throw runtime_error("Error in memory allocation while reading a row of " + to_string(used) + " or more bytes from '" + file_name + "' file.");
+    }
+    memcpy(grown, buffer, used);
+    delete[] buffer;
+    buffer = grown;
+    buffer_size = size;
+}
+
+void TableReader::skip_line_end(const char* line_end) noexcept(false) {
+    block_start = line_end + 1;
+    if (*line_end == '\r') { // treat "\r\n" as a single line terminator
+        if ((block_start == block_end) && (fill_block() < 0)) {
+            throw runtime_error("Error while reading rows from '" + file_name + "' file.");
+        }
+        if ((block_start < block_end) && (*block_start == '\n')) {
+            ++block_start;
+        }
+    }
+}
+
+long int TableReader::read_line(bool& complete) noexcept(false) {
+    size_t i = 0u;
+    int n = 0;
+    const char* line_end = nullptr;
+    size_t length = 0u;
+
+    complete = false;
+    while (true) {
+        if (block_start == block_end) {
+            if ((n = fill_block()) < 0) {
+                throw runtime_error("Error while reading rows from '" + file_name + "' file.");
+            } else if (n == 0) { // end of file
+                break;
             }
-            return i;
         }
-        i += 1;
+        line_end = DelimiterScanner::find_line_end(block_start, block_end); // '\r' of "\r\n" ends the line as well
+        length = (size_t)(line_end - block_start);
+        if (i + length >= buffer_size) { // rows are never truncated; the buffer grows instead
+            grow_buffer(i + length + 1u, i);
+        }
+        memcpy(buffer + i, block_start, length);
+        i += length;
+        block_start += length;
+        if (line_end < block_end) { // reached the end of line
+            complete = true;
+            skip_line_end(line_end);
+            break;
+        }
+    }
+    if (i > 0u) { // last row may have no line terminator
+        complete = true;
     }
+    buffer[i] = '\0';
+
+    return ((i == 0u) && !complete ? -1 : (long int)i);
+}
+
+int TableReader::read_batch(long int max_rows) noexcept(false) {
+    bool complete = false;
+    long int length = 0;
+    int n_rows = 0;
+
+    batch_data.clear();
+    batch_offsets.clear();
+    batch_lengths.clear();
+    batch_complete.clear();
+    while ((n_rows < BATCH_ROWS) && (batch_data.size() < BATCH_BYTES) && ((max_rows < 0) || (n_rows < max_rows))) {
+        if ((length = read_line(complete)) < 0) {
+            break;
+        }
+        batch_offsets.push_back(batch_data.size());
+        batch_lengths.push_back(length);
+        batch_complete.push_back(complete ? 1 : 0);
+        batch_data.insert(batch_data.end(), buffer, buffer + length + 1); // keep the terminating '\0'
+        ++n_rows;
+    }
+    if (batch_tokens.size() < (size_t)n_rows) {
+        batch_tokens.resize((size_t)n_rows);
+    }
+    return n_rows;
+}
+
+void TableReader::split_batch_row(int k, char separator) {
+    char* row = batch_data.data() + batch_offsets[k];
+    vector<char*>& tokens = batch_tokens[k];
+    char* token = nullptr;
 
-    if ((c < 0) && (gzeof(gzfile) < 1)) {
-        throw runtime_error("Error while reading rows from '" + file_name + "' file.");
+    tokens.clear();
+    token = DelimiterScanner::split(row, row + batch_lengths[k], separator, tokens);
+    if (batch_complete[k] != 0) {
+        tokens.push_back(token);
     }
+}
 
-    return (i == 0 ? -1 : i);
+long int TableReader::read_row(vector<char*>& tokens, char separator) noexcept(false) {
+    bool complete = false;
+    long int i = read_line(complete);
+    char* token = nullptr;
+
+    tokens.clear();
+    if (i < 0) {
+        return i;
+    }
+    token = DelimiterScanner::split(buffer, buffer + i, separator, tokens);
+    if (complete) {
+        tokens.push_back(token);
+    }
+    return i;
 }
 
-int TableReader::check_format(int header_rows, int index_columns, int required_data_rows, int required_data_cols,  Format format, string& message) noexcept(false) {
-    this->reset();
+long int TableReader::read_row(vector<char*>& tokens, char separator, const vector<bool>& columns) noexcept(false) {
+    const char* line_end = nullptr;
+    size_t column = 0u, used = 0u;
+    long int length = 0;
+    bool found = false;
+    int n = 0;
+
+    tokens.clear();
+    selected_offsets.clear();
+    if (!columns.empty() && columns[0]) {
+        selected_offsets.push_back(0u);
+    }
+    while (true) { // the row is split part by part, as the input blocks come
+        if (block_start == block_end) {
+            if ((n = fill_block()) < 0) {
+                throw runtime_error("Error while reading rows from '" + file_name + "' file.");
+            } else if (n == 0) { // end of file
+                break;
+            }
+        }
+        found = true;
+        line_end = DelimiterScanner::find_line_end(block_start, block_end);
+        DelimiterScanner::select(block_start, line_end, separator, columns, column, selected_data, used, selected_offsets);
+        length += line_end - block_start;
+        block_start = line_end;
+        if (line_end < block_end) {
+            skip_line_end(line_end);
+            break;
+        }
+    }
+    if (!found) {
+        return -1;
+    }
+    if ((column < columns.size()) && columns[column]) { // last field of the row
+        if (used == selected_data.size()) {
+            selected_data.resize(used + 1u);
+        }
+        selected_data[used++] = '\0';
+    }
+    for (auto&& offset: selected_offsets) {
+        tokens.push_back(selected_data.data() + offset);
+    }
+    return length;
+}
+
+long int TableReader::read_row(vector<string>& tokens, char separator) noexcept(false) {
+    long int i = read_row(fields, separator);
+
+    tokens.clear();
+    for (auto&& field: fields) {
+        tokens.emplace_back(field);
+    }
+    return i;
+}
+
+int TableReader::check_row(const vector<char*>& tokens, int row, int index_columns, int required_data_cols, Format format, string& message) {
     stringstream fmt_message;
-    vector<string> tokens;
-    int nrow = 0;
-    size_t n_values, pos_start, pos = 0;
+    size_t n_values, length = 0;
+    const char* value_start = nullptr;
+    char* end = nullptr;
     float value = 0;
 
-    while (this->read_row(tokens, '\t') >= 0) {
-        ++nrow;
-        if (nrow <= header_rows) { // Skip non-data rows
-            continue;
-        }
-        if (tokens.size() != required_data_cols + index_columns) {
-            fmt_message << "Error: incorrect number of columns in row " << nrow << " in '" << this->file_name << "'." << endl;
+    if (tokens.size() != required_data_cols + index_columns) {
+        fmt_message << "Error: incorrect number of columns in row " << row << " in '" << this->file_name << "'." << endl;
+        message = fmt_message.str();
+        return 0; // incorrect number of columns or empty row
+    }
+    for (unsigned int i = index_columns; i < tokens.size(); ++i) {
+        if (*tokens[i] == '\0') {
+            fmt_message << "Error: empty field at (row " << row << ", column " << i << ") in the file '" << this->file_name << "'." << endl;
             message = fmt_message.str();
-            return 0; // incorrect number of columns or empty row
-        }
-        for (unsigned int i = index_columns; i < tokens.size(); ++i) {
-            if (tokens[i].length() == 0) {
-                fmt_message << "Error: empty field at (row " << nrow << ", column " << i << ") in the file '" << this->file_name << "'." << endl;
-                message = fmt_message.str();
-                return 0;
-            } else {
-                switch (format) {
-                    case Format::DIPLOID_GT:
-                        if (tokens[i].compare("-9") != 0) {
-                            if ((tokens[i].compare("0") != 0) && (tokens[i].compare("1") != 0) && (tokens[i].compare("2") != 0)) {
-                                fmt_message << "Error: invalid value '" << tokens[i] << "' in (row " << nrow << ", column " << i << ") in the file '" << this->file_name << "'." << endl;
-                                message = fmt_message.str();
-                                return 0; // incorrect column value;
-                            }
-                        }
-                        break;
-                    case Format::NPLOID_GT:
-                        if (tokens[i].compare("-9") != 0) {
-                            if (tokens[i].find_first_not_of("0123456789") != string::npos) {
-                                fmt_message << "Error: invalid value '" << tokens[i] << "' in (row " << nrow << ", column " << i << ") in the file '" << this->file_name << "'." << endl;
-                                message = fmt_message.str();
-                                return 0; // incorrect column value;
-                            }
+            return 0;
+        } else {
+            switch (format) {
+                case Format::DIPLOID_GT:
+                    if (strcmp(tokens[i], "-9") != 0) {
+                        if (((tokens[i][0] != '0') && (tokens[i][0] != '1') && (tokens[i][0] != '2')) || (tokens[i][1] != '\0')) {
+                            fmt_message << "Error: invalid value '" << tokens[i] << "' in (row " << row << ", column " << i << ") in the file '" << this->file_name << "'." << endl;
+                            message = fmt_message.str();
+                            return 0; // incorrect column value;
                         }
-                        break;
-                    case Format::FLOAT:
-                        try {
-                            value = stof(tokens[i], &pos);
-                            if ((pos != tokens[i].length()) || (isinf(value))) {
-                                throw runtime_error("");
-                            }
-                        } catch (...) {
-                            fmt_message << "Error: invalid value '" << tokens[i] << "' in (row " << nrow << ", column " << i << ") in the file '" << this->file_name << "'." << endl;
+                    }
+                    break;
+                case Format::NPLOID_GT:
+                    if (strcmp(tokens[i], "-9") != 0) {
+                        if (tokens[i][strspn(tokens[i], "0123456789")] != '\0') {
+                            fmt_message << "Error: invalid value '" << tokens[i] << "' in (row " << row << ", column " << i << ") in the file '" << this->file_name << "'." << endl;
                             message = fmt_message.str();
-                            return 0;
+                            return 0; // incorrect column value;
                         }
-                        break;
-                    case Format::SEQ:
-                        n_values = pos_start = pos = 0;
-                        while (n_values <= 3) {
-                            ++n_values;
-                            pos = tokens[i].find_first_not_of("0123456789", pos_start);
-                            if (pos != string::npos) {
-                                if ((tokens[i][pos] != ' ') || (pos - pos_start <= 0)) {
-                                    fmt_message << "Error: invalid value '" << tokens[i] << "' in (row " << nrow << ", column " << i << ") in the file '" << this->file_name << "'." << endl;
-                                    message = fmt_message.str();
-                                    return 0;
-                                } else {
-                                    pos_start = pos + 1;
-                                }
+                    }
+                    break;
+                case Format::FLOAT:
+                    errno = 0;
+                    value = strtof(tokens[i], &end);
+                    if ((end == tokens[i]) || (*end != '\0') || (errno == ERANGE) || (isinf(value))) {
+                        fmt_message << "Error: invalid value '" << tokens[i] << "' in (row " << row << ", column " << i << ") in the file '" << this->file_name << "'." << endl;
+                        message = fmt_message.str();
+                        return 0;
+                    }
+                    break;
+                case Format::SEQ:
+                    n_values = 0;
+                    value_start = tokens[i];
+                    while (n_values <= 3) {
+                        ++n_values;
+                        length = strspn(value_start, "0123456789");
+                        if (value_start[length] != '\0') {
+                            if ((value_start[length] != ' ') || (length == 0)) {
+                                fmt_message << "Error: invalid value '" << tokens[i] << "' in (row " << row << ", column " << i << ") in the file '" << this->file_name << "'." << endl;
+                                message = fmt_message.str();
+                                return 0;
                             } else {
-                                break;
+                                value_start += length + 1;
                             }
+                        } else {
+                            break;
                         }
-                        if (n_values > 3) {
-                            fmt_message << "Error: invalid value '" << tokens[i] << "' in (row " << nrow << ", column " << i << ") in the file '" << this->file_name << "'." << endl;
-                            message = fmt_message.str();
-                            return 0;
-                        }
-                        break;
-                }
+                    }
+                    if (n_values > 3) {
+                        fmt_message << "Error: invalid value '" << tokens[i] << "' in (row " << row << ", column " << i << ") in the file '" << this->file_name << "'." << endl;
+                        message = fmt_message.str();
+                        return 0;
+                    }
+                    break;
+            }
+        }
+    }
+    return 1;
+}
+
+int TableReader::check_format(int header_rows, int index_columns, int required_data_rows, int required_data_cols,  Format format, string& message) noexcept(false) {
+    this->reset();
+    stringstream fmt_message;
+    vector<string> messages;
+    vector<int> valid;
+    int nrow = 0, n_rows = 0;
+
+    while ((n_rows = read_batch(-1)) > 0) { // rows of a batch are checked in parallel; the first invalid row is reported
+        messages.assign((size_t)n_rows, string());
+        valid.assign((size_t)n_rows, 1);
+        #pragma omp parallel for num_threads(get_threads()) schedule(dynamic, 16)
+        for (int k = 0; k < n_rows; ++k) {
+            split_batch_row(k, '\t');
+            if (nrow + k + 1 > header_rows) { // Skip non-data rows
+                valid[k] = check_row(batch_tokens[k], nrow + k + 1, index_columns, required_data_cols, format, messages[k]);
             }
         }
+        for (int k = 0; k < n_rows; ++k) {
+            if (valid[k] == 0) {
+                message = messages[k];
+                return 0;
+            }
+        }
+        nrow += n_rows;
     }
 
     if (nrow != (required_data_rows + header_rows)) {
@@ -238,4 +655,212 @@ int TableReader::check_format(int header_rows, int index_columns, int required_d
     this->reset();
     message = "";
     return 1;
-}
\ No newline at end of file
+}
+
+int TableReader::scan(int& nrow, int& ncol, char separator, int header_rows, int index_columns, Format format, bool check, string& message,
+                      const function<void(int, const vector<char*>&)>& row_callback) noexcept(false) {
+    vector<string> messages;
+    vector<int> valid_rows;
+    long int length = 0;
+    int row = 0, n_columns = 0, valid = 1, n_rows = 0;
+    bool check_batch = false;
+
+    nrow = 0;
+    ncol = 0;
+    message = "";
+    reset(); // make sure we are at the beginning of the file.
+    while ((n_rows = read_batch(-1)) > 0) {
+        // Rows are split and checked in parallel. Each row is checked against its own number of columns, because
+        // the number of columns in the file is known only after the first row.
+        check_batch = check && (valid == 1);
+        messages.assign((size_t)n_rows, string());
+        valid_rows.assign((size_t)n_rows, 1);
+        #pragma omp parallel for num_threads(get_threads()) schedule(dynamic, 16)
+        for (int k = 0; k < n_rows; ++k) {
+            split_batch_row(k, separator);
+            if (check_batch && (row + k + 1 > header_rows)) {
+                valid_rows[k] = check_row(batch_tokens[k], row + k + 1, index_columns, (int)batch_tokens[k].size() - index_columns, format, messages[k]);
+            }
+        }
+        for (int k = 0; k < n_rows; ++k) { // the rest goes in the order of rows
+            const vector<char*>& tokens = batch_tokens[k];
+            length = batch_lengths[k];
+            ++row;
+            n_columns = (int)tokens.size();
+            if ((n_columns > 1) || (length > 0)) { // same rules as in get_dim; empty rows are ignored
+                if (n_columns > length - n_columns + 1) { // some columns are empty
+                    throw runtime_error("Empty columns in '" + file_name + "' file.");
+                }
+                if (nrow == 0) {
+                    ncol = n_columns;
+                } else if (ncol != n_columns) { // number of columns doesn't match between rows;
+                    throw runtime_error("Number of columns is different across rows in '" + file_name + "' file.");
+                }
+                ++nrow;
+            }
+            if (row <= header_rows) { // Skip non-data rows
+                continue;
+            }
+            if (check && (valid == 1)) { // stop validating after the first error, but keep counting rows
+                if (valid_rows[k] == 0) {
+                    valid = 0;
+                    message = messages[k];
+                } else if (n_columns != ncol) { // empty row
+                    valid = check_row(tokens, row, index_columns, ncol - index_columns, format, message);
+                }
+            }
+            if (row_callback) {
+                row_callback(row - header_rows, tokens);
+            }
+        }
+    }
+    reset(); // move to the beginning of the file.
+    return valid;
+}
+
+int TableReader::read_rows(char separator, long int max_rows, const function<bool(long int, const vector<char*>&, string&)>& row_callback,
+                           string& message, const function<void(long int, int)>& batch_callback) noexcept(false) {
+    vector<string> messages;
+    vector<int> processed;
+    long int row = 0;
+    int n_rows = 0;
+
+    message = "";
+    while (((max_rows < 0) || (row < max_rows)) && ((n_rows = read_batch(max_rows < 0 ? -1 : max_rows - row)) > 0)) {
+        if (batch_callback) {
+            batch_callback(row + 1, n_rows);
+        }
+        messages.assign((size_t)n_rows, string());
+        processed.assign((size_t)n_rows, 1);
+        #pragma omp parallel for num_threads(get_threads()) schedule(dynamic, 1)
+        for (int k = 0; k < n_rows; ++k) {
+            split_batch_row(k, separator);
+            try {
+                processed[k] = row_callback(row + k + 1, batch_tokens[k], messages[k]) ? 1 : 0;
+            } catch (exception& e) { // exceptions must not leave the parallel region
+                messages[k] = e.what();
+                processed[k] = 0;
+            }
+        }
+        for (int k = 0; k < n_rows; ++k) {
+            if (processed[k] == 0) {
+                message = messages[k];
+                return 0;
+            }
+        }
+        row += n_rows;
+    }
+    return 1;
+}
+
+uint64_t TableReader::get_offset(const char* position) {
+    if (mapped) {
+        return (uint64_t)(position - mapping);
+    }
+    return bgzf->get_virtual_offset((unsigned int)(position - bgzf->get_data()));
+}
+
+string TableReader::build_index() noexcept(false) {
+    string index_name = file_name + INDEX_EXTENSION;
+    vector<uint64_t> offsets;
+    const char* line_end = nullptr;
+    bool line_start = true;
+    int n = 0;
+    struct stat file_stat;
+    IndexHeader header;
+    FILE* index = nullptr;
+
+    if (!mapped && (bgzf == nullptr)) {
+        throw runtime_error("Row index can be built only for uncompressed or BGZF-compressed (bgzip) files, but '" + file_name + "' is neither.");
+    }
+    reset();
+    direct = true;
+    do {
+        while (block_start < block_end) { // row starts after every '\n' which is followed by some data
+            if (line_start) {
+                offsets.push_back(get_offset(block_start));
+                line_start = false;
+            }
+            line_end = (const char*)memchr(block_start, '\n', block_end - block_start);
+            if (line_end == nullptr) {
+                block_start = block_end;
+            } else {
+                block_start = line_end + 1;
+                line_start = true;
+            }
+        }
+    } while ((n = fill_block()) > 0);
+    if (n < 0) {
+        throw runtime_error("Error while reading '" + file_name + "' file.");
+    }
+    direct = false;
+    reset();
+
+    if (stat(file_name.c_str(), &file_stat) != 0) {
+        throw runtime_error("Error while reading '" + file_name + "' file.");
+    }
+    memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    header.version = INDEX_VERSION;
+    header.file_size = (uint64_t)file_stat.st_size;
+    header.file_mtime = (int64_t)file_stat.st_mtime;
+    header.n_rows = offsets.size();
+    index = fopen(index_name.c_str(), "wb");
+    if (index == nullptr) {
+        throw runtime_error("Error while creating '" + index_name + "' file.");
+    }
+    if ((fwrite(&header, sizeof(header), 1u, index) != 1u) ||
+        (!offsets.empty() && (fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), index) != offsets.size()))) {
+        fclose(index);
+        throw runtime_error("Error while writing '" + index_name + "' file.");
+    }
+    if (fclose(index) != 0) {
+        throw runtime_error("Error while writing '" + index_name + "' file.");
+    }
+    return index_name;
+}
+
+bool TableReader::seek_row(long int row) noexcept(false) {
+    string index_name = file_name + INDEX_EXTENSION;
+    struct stat file_stat;
+    IndexHeader header;
+    uint64_t offset = 0u;
+    FILE* index = nullptr;
+    bool found = false;
+    int n = 0;
+
+    if ((!mapped && (bgzf == nullptr)) || (row < 0) || (stat(file_name.c_str(), &file_stat) != 0)) {
+        return false;
+    }
+    index = fopen(index_name.c_str(), "rb");
+    if (index == nullptr) {
+        return false;
+    }
+    found = (fread(&header, sizeof(header), 1u, index) == 1u) && (memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) == 0) &&
+            (header.version == INDEX_VERSION) && (header.file_size == (uint64_t)file_stat.st_size) &&
+            (header.file_mtime == (int64_t)file_stat.st_mtime) && ((uint64_t)row < header.n_rows) &&
+            (fseek(index, (long int)(sizeof(header) + row * sizeof(uint64_t)), SEEK_SET) == 0) &&
+            (fread(&offset, sizeof(uint64_t), 1u, index) == 1u);
+    fclose(index);
+    if (!found) {
+        return false;
+    }
+    if (mapped) {
+        if (offset >= mapping_size) {
+            return false;
+        }
+        block_start = mapping + offset;
+        block_end = mapping + mapping_size;
+    } else {
+        stop_producer(); // the producer is restarted from the new position by the next fill_block
+        if ((n = bgzf->seek(offset, get_threads())) < 0) {
+            throw runtime_error("Error while reading rows from '" + file_name + "' file.");
+        }
+        block_start = bgzf->get_data();
+        block_end = block_start + n;
+        if ((offset & 0xFFFFu) > (uint64_t)n) {
+            throw runtime_error("Row index '" + index_name + "' doesn't match '" + file_name + "' file.");
+        }
+        block_start += offset & 0xFFFFu;
+    }
+    return true;
+}
@@ -11,26 +11,126 @@
 #include <stdexcept>
 #include <vector>
 #include <tuple>
+#include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <zlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "BgzfReader.h"
+#include "DelimiterScanner.h"
 
 using namespace std;
 
 class TableReader {
 
+public:
+    enum Format { DIPLOID_GT, NPLOID_GT, FLOAT, SEQ };
+
 private:
-    char* buffer;
-    unsigned int max_line_length;
+    char* buffer; // current row; grows to fit the widest row read by read_line
+    size_t buffer_size;
+
+    char* block; // decompressed input is read into this block and scanned in place
+    unsigned int block_size;
+    const char* block_start;
+    const char* block_end;
+
+    bool mapped; // uncompressed files are memory-mapped and scanned without gzread
+    char* mapping;
+    size_t mapping_size;
+
+    vector<char*> fields; // scratch storage for the vector<string> overload of read_row
+
+    // Selected fields of the current row (projection overload of read_row), copied straight from the input blocks.
+    // The vector only grows; its used part is tracked by read_row.
+    vector<char> selected_data;
+    vector<size_t> selected_offsets;
+
+    // Rows read ahead in one batch, so that they can be split and processed on several threads.
+    vector<char> batch_data;        // '\0'-terminated rows
+    vector<size_t> batch_offsets;   // start of every row in batch_data
+    vector<long int> batch_lengths; // row lengths as returned by read_line
+    vector<char> batch_complete;    // whether the last field of the row is complete
+    vector<vector<char*>> batch_tokens;
 
     string file_name;
     gzFile gzfile;
+    BgzfReader* bgzf; // set instead of gzfile when the input is BGZF-compressed
+
+    static int num_threads;
+    static unsigned int read_ahead;
+    int threads; // threads of this reader; 0 uses num_threads
+
+    // Read-ahead: a producer thread decompresses the input into a ring of buffers while the caller parses rows.
+    // The slot at ring_head is the one being scanned; ring_filled counts slots (including it) that are ready.
+    bool direct; // read on the caller's thread even if read-ahead is on (BGZF virtual offsets need the reader's buffer)
+    thread producer;
+    mutex ring_mutex;
+    condition_variable ring_cv;
+    vector<vector<char>> ring;
+    vector<int> ring_sizes;
+    unsigned int ring_head;
+    unsigned int ring_filled;
+    bool ring_holding;
+    bool producer_stop;
+    string producer_error;
+
+    bool open_mapped() noexcept(false);
+    uint64_t get_offset(const char* position);
+    int read_block(vector<char>& destination) noexcept(false);
+    void produce();
+    void start_producer();
+    void stop_producer();
+    int fill_block() noexcept(false);
+    void grow_buffer(size_t size, size_t used) noexcept(false);
+    void skip_line_end(const char* line_end) noexcept(false);
+    long int read_line(bool& complete) noexcept(false);
+    int read_batch(long int max_rows) noexcept(false);
+    void split_batch_row(int k, char separator);
+    int check_row(const vector<char*>& tokens, int row, int index_columns, int required_data_cols, Format format, string& message);
 
 public:
-    enum Format { DIPLOID_GT, NPLOID_GT, FLOAT, SEQ };
 
-    static const unsigned int DEFAULT_BUFFER_SIZE;
+    static const unsigned int DEFAULT_BUFFER_SIZE; // initial size of the row buffer; longer rows make it grow
+    static const unsigned int DEFAULT_BLOCK_SIZE;
 
-    TableReader(unsigned int buffer_size = DEFAULT_BUFFER_SIZE) noexcept(false);
+    static const string INDEX_EXTENSION;
+
+    static void set_num_threads(int n); // number of threads used to inflate BGZF blocks and to split and check rows
+    static int get_num_threads();
+    static void set_read_ahead(unsigned int n_buffers); // compressed input is decompressed ahead into n_buffers buffers; 0 turns it off
+    // Number of threads of this reader only (e.g. when several readers run at once); 0 goes back to set_num_threads.
+    void set_threads(int n);
+    int get_threads();
+
+    // Parses a genotype field: "-9" (missing) or a small non-negative integer (0, 1, 2 for diploid data, allele counts
+    // for other ploidy) without float conversion. Returns false if the field is anything else.
+    static bool parse_genotype(const char* field, int& value) {
+        unsigned int digit = (unsigned char)field[0] - (unsigned char)'0';
+        if (digit > 9u) {
+            value = -9;
+            return (field[0] == '-') && (field[1] == '9') && (field[2] == '\0');
+        }
+        value = (int)digit;
+        while ((digit = (unsigned char)*++field - (unsigned char)'0') <= 9u) {
+            if (value > 99999) {
+                return false;
+            }
+            value = value * 10 + (int)digit;
+        }
+        return *field == '\0';
+    }
+
+    TableReader(unsigned int buffer_size = DEFAULT_BUFFER_SIZE, unsigned int block_size = DEFAULT_BLOCK_SIZE) noexcept(false);
     virtual ~TableReader();
 
     void set_file_name(const string& file_name);
@@ -44,7 +144,32 @@ public:
 
     void get_dim(int &nrow, int &ncol, char separator) noexcept(false);
     long int read_row(vector<string>& tokens, char separator) noexcept(false);
+    // Zero-copy version: tokens point to '\0'-terminated fields inside the internal line buffer and stay valid until the next read.
+    long int read_row(vector<char*>& tokens, char separator) noexcept(false);
+    // Projection: only fields whose 0-based column is set in columns are returned, in the order of columns. The row is
+    // tokenized directly in the input blocks and only the selected fields are copied, so rows of any width need only as
+    // much memory as their selected fields.
+    long int read_row(vector<char*>& tokens, char separator, const vector<bool>& columns) noexcept(false);
     int check_format(int header_rows, int index_columns, int required_data_rows, int required_data_cols,  Format format, string& message) noexcept(false);
+    // Single pass that does the work of get_dim and (if check is true) of check_format at once. Each row after the header
+    // rows is also passed to row_callback together with its 1-based index. Returns 1 if all data rows have valid format.
+    int scan(int& nrow, int& ncol, char separator, int header_rows, int index_columns, Format format, bool check, string& message,
+             const function<void(int, const vector<char*>&)>& row_callback = nullptr) noexcept(false);
+    // Reads up to max_rows rows (all remaining rows if max_rows < 0) in batches and passes every row to row_callback
+    // on several threads in parallel, together with its 1-based number counted from the current position. The callback
+    // must write only to storage that belongs to its row. If it returns false for some rows (or throws), reading stops
+    // and the message set by the first such row is returned in message. Returns 1 if all rows were processed.
+    // If there is a batch_callback, it gets the number of the first row and the number of rows of every batch before they
+    // are passed to row_callback (e.g. to grow the storage of the rows).
+    int read_rows(char separator, long int max_rows, const function<bool(long int, const vector<char*>&, string&)>& row_callback,
+                  string& message, const function<void(long int, int)>& batch_callback = nullptr) noexcept(false);
+
+    // Row index sidecar (file name + INDEX_EXTENSION) stores offset of every row. It can be built for uncompressed
+    // (byte offsets) and BGZF-compressed (virtual offsets) files only.
+    string build_index() noexcept(false);
+    // Moves to the beginning of the 0-based row using the row index. Returns false (and doesn't move) if there is
+    // no up-to-date index, so that the caller can skip rows sequentially.
+    bool seek_row(long int row) noexcept(false);
 };
 
 
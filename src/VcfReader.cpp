@@ -0,0 +1,116 @@
+#include "VcfReader.h"
+
+const unsigned int VcfReader::FIXED_COLUMNS = 9u;
+
+static bool ends_with(const string& file_name, const string& extension) {
+    return (file_name.length() > extension.length()) && (file_name.compare(file_name.length() - extension.length(), extension.length(), extension) == 0);
+}
+
+bool VcfReader::is_vcf(const string& file_name) {
+    return ends_with(file_name, ".vcf") || ends_with(file_name, ".vcf.gz") || ends_with(file_name, ".vcf.bgz");
+}
+
+int VcfReader::find_gt(const char* format) {
+    int index = 0;
+
+    while ((format[0] != 'G') || (format[1] != 'T') || ((format[2] != '\0') && (format[2] != ':'))) {
+        if ((format = strchr(format, ':')) == nullptr) {
+            return -1;
+        }
+        ++format;
+        ++index;
+    }
+    return index;
+}
+
+unsigned int VcfReader::parse_genotype(const char* field, int gt_index) {
+    for (; gt_index > 0; --gt_index) {
+        if ((field = strchr(field, ':')) == nullptr) {
+            return PackedGenotypeReader::MISSING_CODE;
+        }
+        ++field;
+    }
+    if (((field[0] != '0') && (field[0] != '1')) || ((field[1] != '/') && (field[1] != '|')) ||
+        ((field[2] != '0') && (field[2] != '1')) || ((field[3] != '\0') && (field[3] != ':'))) {
+        return PackedGenotypeReader::MISSING_CODE;
+    }
+    return (field[0] == '0' ? 1u : 0u) + (field[2] == '0' ? 1u : 0u);
+}
+
+VcfReader::VcfReader() {
+
+}
+
+VcfReader::~VcfReader() {
+
+}
+
+void VcfReader::set_file_name(const string& file_name) {
+    this->file_name = file_name;
+}
+
+const string& VcfReader::get_file_name() {
+    return file_name;
+}
+
+void VcfReader::open() noexcept(false) {
+    reader.set_file_name(file_name);
+    reader.open();
+    sample_ids.clear();
+    while (reader.read_row(tokens, '\t') >= 0) {
+        if (!tokens.empty() && (strncmp(tokens[0], "##", 2u) == 0)) { // meta-information
+            continue;
+        }
+        if (tokens.empty() || (strcmp(tokens[0], "#CHROM") != 0)) {
+            break;
+        }
+        if (tokens.size() > FIXED_COLUMNS) {
+            sample_ids.assign(tokens.begin() + FIXED_COLUMNS, tokens.end());
+        }
+        return;
+    }
+    reader.close();
+    throw runtime_error("'" + file_name + "' is not a valid VCF file: there is no header line '#CHROM ...'.");
+}
+
+void VcfReader::close() noexcept(false) {
+    if (reader.is_open()) {
+        reader.close();
+    }
+}
+
+const vector<string>& VcfReader::get_sample_ids() {
+    return sample_ids;
+}
+
+unsigned int VcfReader::read_genotypes(vector<char>& codes) noexcept(false) {
+    size_t first = codes.size();
+    size_t n_samples = sample_ids.size();
+    size_t row_size = PackedGenotypeReader::get_row_size((unsigned int)n_samples);
+    long int n_loci = 0;
+    string error;
+
+    int result = reader.read_rows('\t', -1, [&](long int row, const vector<char*>& tokens, string& message) -> bool {
+        unsigned char* locus = (unsigned char*)codes.data() + first + (size_t)(row - 1) * row_size;
+        int gt_index = -1;
+        if ((n_samples > 0u) && (tokens.size() != FIXED_COLUMNS + n_samples)) {
+            message = "Error: incorrect number of columns in record " + to_string(row) + " in '" + file_name + "'.";
+            return false;
+        }
+        if ((n_samples > 0u) && ((gt_index = find_gt(tokens[FIXED_COLUMNS - 1u])) < 0)) {
+            message = "Error: no GT field in record " + to_string(row) + " in '" + file_name + "'.";
+            return false;
+        }
+        for (size_t s = 0u; s < n_samples; ++s) {
+            locus[s >> 2u] |= (unsigned char)(parse_genotype(tokens[FIXED_COLUMNS + s], gt_index) << ((s & 3u) << 1u));
+        }
+        return true;
+    }, error, [&](long int first_row, int n_rows) { // rows of the batch are zero-filled before the codes are set
+        n_loci = first_row - 1 + n_rows;
+        codes.resize(first + (size_t)n_loci * row_size, 0);
+    });
+    if (result == 0) {
+        throw runtime_error(error);
+    }
+    return (unsigned int)n_loci;
+}
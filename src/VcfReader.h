@@ -0,0 +1,54 @@
+#ifndef LASER_VCFREADER_H
+#define LASER_VCFREADER_H
+
+#include <iostream>
+#include <string>
+#include <stdexcept>
+#include <vector>
+#include <cstring>
+#include "TableReader.h"
+#include "PackedGenotypeReader.h"
+
+using namespace std;
+
+// Reads genotypes from a VCF file (uncompressed, gzip or bgzip-compressed *.vcf, *.vcf.gz, *.vcf.bgz). Sites are the
+// CHROM, POS, ID, REF and ALT columns, which SiteTable reads straight from the VCF. The GT field of every sample is coded
+// as in GENO files, i.e. as the number of copies of the reference allele. Genotypes that don't have two alleles 0 or 1
+// (missing, haploid or with other alternative alleles) are missing. Sample IDs serve as both popID and indivID.
+class VcfReader {
+
+public:
+    static const unsigned int FIXED_COLUMNS; // CHROM, POS, ID, REF, ALT, QUAL, FILTER, INFO and FORMAT
+
+private:
+    string file_name;
+    TableReader reader;
+    vector<char*> tokens;
+    vector<string> sample_ids;
+
+public:
+    static bool is_vcf(const string& file_name);
+    // 0-based index of GT in the FORMAT field, or -1 if there is no GT.
+    static int find_gt(const char* format);
+    // 2-bit code of the genotype (see PackedGenotypeReader) in the sample field.
+    static unsigned int parse_genotype(const char* field, int gt_index);
+
+    VcfReader();
+    virtual ~VcfReader();
+
+    void set_file_name(const string& file_name);
+    const string& get_file_name();
+
+    // Reads meta-information lines and the header line with sample IDs. Throws runtime_error if there is no header line.
+    void open() noexcept(false);
+    void close() noexcept(false);
+
+    const vector<string>& get_sample_ids();
+    // Reads all records and appends their genotypes to codes as rows of a locus-major packed genotype file (one row of
+    // PackedGenotypeReader::get_row_size(n_samples) bytes per locus). Records are decoded on TableReader threads.
+    // Returns the number of loci. Throws runtime_error if a record has wrong number of columns or no GT field.
+    unsigned int read_genotypes(vector<char>& codes) noexcept(false);
+};
+
+
+#endif //LASER_VCFREADER_H
@@ -4,12 +4,24 @@
 
 #include "aux.h"
 
-//## some_file.geno[.gz] to some_file.site[.gz]
+//## some_file.geno[.gz] (or some_file.pgeno) to some_file.site[.gz]
 string build_sites_filename(const string& filename) {
+    if (is_file_list(filename)) {
+        string sites_filenames;
+        for (auto&& name: split_file_list(filename)) {
+            sites_filenames.append(sites_filenames.empty() ? "" : ",").append(build_sites_filename(name));
+        }
+        return sites_filenames;
+    }
     regex genogz_regex("\\.geno\\.gz$");
     regex geno_regex("\\.geno$");
     regex seqgz_regex("\\.seq\\.gz$");
     regex seq_regex("\\.seq$");
+    regex pgeno_regex("\\.pgeno$");
+    regex sseqgz_regex("\\.sseq\\.gz$");
+    regex sseq_regex("\\.sseq$");
+    regex bseq_regex("\\.bseq$");
+    regex vcf_regex("\\.vcf(\\.gz|\\.bgz)?$");
     if (regex_search(filename, genogz_regex)) {
         return regex_replace(filename, genogz_regex, ".site.gz");
     } else if (regex_search(filename, geno_regex)) {
@@ -18,8 +30,48 @@ string build_sites_filename(const string& filename) {
         return regex_replace(filename, seqgz_regex, ".site.gz");
     } else if (regex_search(filename, seq_regex)) {
         return regex_replace(filename, seq_regex, ".site");
+    } else if (regex_search(filename, pgeno_regex)) {
+        return regex_replace(filename, pgeno_regex, ".site");
+    } else if (regex_search(filename, sseqgz_regex)) {
+        return regex_replace(filename, sseqgz_regex, ".site.gz");
+    } else if (regex_search(filename, sseq_regex)) {
+        return regex_replace(filename, sseq_regex, ".site");
+    } else if (regex_search(filename, bseq_regex)) {
+        return regex_replace(filename, bseq_regex, ".site");
+    } else if (regex_search(filename, vcf_regex)) { // sites are the first columns of the VCF itself
+        return filename;
     } else {
         return filename + ".site";
     }
 }
 
+vector<string> split_file_list(const string& filenames) {
+    vector<string> names;
+    size_t start = 0u, end = 0u;
+    do {
+        end = filenames.find(',', start);
+        names.push_back(filenames.substr(start, end == string::npos ? string::npos : end - start));
+        start = end + 1u;
+    } while (end != string::npos);
+    return names;
+}
+
+bool is_file_list(const string& filenames) {
+    return filenames.find(',') != string::npos;
+}
+
+string expand_file_list(const string& filenames) {
+    string expanded;
+    glob_t matches;
+    for (auto&& name: split_file_list(filenames)) {
+        if ((name.find_first_of("*?[") != string::npos) && (glob(name.c_str(), 0, nullptr, &matches) == 0)) {
+            for (size_t i = 0u; i < matches.gl_pathc; ++i) {
+                expanded.append(expanded.empty() ? "" : ",").append(matches.gl_pathv[i]);
+            }
+            globfree(&matches);
+        } else { // files that don't exist are reported when they are opened
+            expanded.append(expanded.empty() ? "" : ",").append(name);
+        }
+    }
+    return expanded;
+}
@@ -11,10 +11,19 @@
 #include <tuple>
 #include <regex>
 #include <zlib.h>
+#include <glob.h>
 
 using namespace std;
 
-//## some_file.geno[.gz] to some_file.site[.gz]
+//## some_file.geno[.gz] (or some_file.pgeno, some_file.sseq[.gz], some_file.bseq) to some_file.site[.gz]
+//## Lists of files (e.g. chr1.geno,chr2.geno) are mapped file by file (to chr1.site,chr2.site)
+//## VCF files (some_file.vcf[.gz|.bgz]) are their own site files
 string build_sites_filename(const string& filename);
 
+//## Lists of files are comma-separated (e.g. one file per chromosome: chr1.geno,chr2.geno,...)
+vector<string> split_file_list(const string& filenames);
+bool is_file_list(const string& filenames);
+//## Replaces every pattern (e.g. chr*.geno.gz) in the list by the matching files in alphabetical order
+string expand_file_list(const string& filenames);
+
 #endif //LASER_AUX_H
@@ -19,11 +19,23 @@
 #include "Version.h"
 #include "aux.h"
 #include "TableReader.h"
+#include "MultiTableReader.h"
+#include "OutputWriter.h"
+#include "SiteTable.h"
+#include "PackedGenotypeReader.h"
+#include "ReferenceSnapshotReader.h"
+#include "ReferenceSnapshotWriter.h"
+#include "SeqCacheReader.h"
+#include "SeqCacheWriter.h"
+#include "SparseSeqReader.h"
+#include "VcfReader.h"
 #include <iostream>
 #include <iomanip>
 #include <fstream>
 #include <string>
 #include <map>
+#include <memory>
+#include <future>
 #include <openblas/cblas.h>
 #define  __GSL_CBLAS_H__
 #include <gsl/gsl_rng.h>
@@ -68,6 +80,8 @@ const string ARG_PROCRUSTES_SCALE = "-rho";
 const string ARG_REF_SIZE = "-N";
 const string ARG_KNN_ZSCORE= "-knn";
 const string ARG_NUM_THREADS = "-nt";
+const string ARG_COMPRESS_OUTPUT = "-gz";
+const string ARG_REF_SNAPSHOT = "-rs";
 
 const string default_str = "---this-is-a-default-string---";
 const int default_int = -999999998;
@@ -121,6 +135,8 @@ int PROCRUSTES_SCALE = default_int;  // 0: Fit the scaling parameter to maximize
 int RANDOM_SEED = default_int;        // Random seed used in the program
 int KNN_ZSCORE = default_int;       // Number of nearest neigbors used to calculate the Z score for each study individual.
 int NUM_THREADS = default_int;        // Number of CPU cores for multi-threading parallel analysis 
+int COMPRESS_OUTPUT = default_int;    // 0: plain text output files; 1: BGZF-compressed output files (".gz" is added to names)
+string REF_SNAPSHOT = default_str;   // File name of the reference panel snapshot, which is reused if it matches the input files
 									 
 // The following parameters will be determined from the input data files					 
 int REF_INDS = default_int;         // Number of reference individuals
@@ -141,6 +157,7 @@ int SEQ_NON_DATA_COLS = 2;     // Number of non-data columns in the SEQ_FILE;
 bool AUTO_MODE = false; // If the program will determine DIM_HIGH automatically;
 int MAX_ITER = 10000;    // Maximum iterations for the projection Procrustes analysis
 double TW = default_double;    // Threshold to determine significant Tracy-Widom statistic
+int PCA_BLOCK_LOCI = 4096;     // Number of loci normalized at a time when the GRM is calculated
 
 string GENO_SITE_FILE = default_str;      // Sitefile of the reference data
 string SEQ_SITE_FILE = default_str;      // Sitefile of the sequence data
@@ -153,9 +170,10 @@ int read_paramfile(string filename);
 int create_paramfile(string filename);
 int check_parameters();
 void print_configuration();
+string output_file_name(const string& suffix);
 
 int pca_geno(Mat<char> &G, int nPCs, mat &PC, rowvec &PCvar);
-int pca(fmat G, int nPCs, mat &PC, rowvec &PCvar, mat &M);
+int pca(int N, int L, const function<void(int, int, fmat&)> &get_block, int nPCs, mat &PC, rowvec &PCvar, mat &M);
 int pca_svd(fmat G, int nPCs, mat &PC, rowvec &PCvar, fmat &Gm, fmat &Gsd, fmat &W);
 int normalize(fmat &G, fmat &Gm, fmat &Gsd);
 int procrustes(mat &X, mat &Y, mat &Xnew, double &t, double &rho, mat &A, rowvec &b, int ps);
@@ -163,7 +181,32 @@ double pprocrustes(mat &X, mat &Y, mat &Xnew, double &t, double &rho, mat &A, ro
 int simuseq(Mat<char> &G, urowvec &C, uvec &Loc, double e, fmat &S, gsl_rng *rng);
 int simuseq2(Mat<char> &G, urowvec &C, uvec &Loc, frowvec &Q, fmat &S, gsl_rng *rng);
 
-int check_coverage(int output, int first_ind, int last_ind, uvec cmnS, urowvec &ExLoci, int &Ls, int &Lg);
+// One study sample of the SEQ_FILE: the covered loci to analyze and the results of every repeated run.
+struct SeqSample {
+	int index = 0;        // 1-based index of the sample in the SEQ_FILE
+	string popID;
+	string indivID;
+	int Lcov = 0;         // number of loci with nonzero coverage
+	double meanC = 0;     // mean coverage
+	uvec Loc;             // analyzed loci (at most MAX_LOCI) with their coverage, sequence reads and base quality
+	urowvec Cc;
+	frowvec Sc;
+	frowvec Qc;
+	vector<int> K;        // DIM_HIGH, t, Z and coordinates of every repeated run
+	vector<double> t;
+	vector<double> Z;
+	vector<rowvec> rotPC;
+	string log;           // warnings, output together with the results
+};
+void analyze_sample(SeqSample &sample, Mat<char> &RefG, mat &refPC, gsl_rng *rng);
+void write_sample(const SeqSample &sample, OutputWriter &fout, OutputWriter &fout2, OutputWriter &fout3);
+
+void add_coverage(int ind, const vector<char*> &tokens, size_t first_column, vec &C_loc, vec &Ncov, string &message);
+void add_coverage(int ind, const uint16_t *coverage, vec &C_loc, vec &Ncov);
+void add_coverage(int ind, const vector<SparseSeqReader::Record> &records, vec &C_loc, vec &Ncov);
+int check_coverage(int output, int first_ind, int last_ind, uvec cmnS, urowvec &ExLoci, const vec &C_loc_all, const vec &Ncov_all, const string &message, const SiteTable &seq_sites, int &Ls, int &Lg);
+void open_sparse_seq(SparseSeqReader &reader, const SiteTable &seq_sites);
+void read_site_ids(const string &site_files, const function<bool(int, const char*)> &visit);
 
 ofstream foutLog;
 //=========================================================================================================
@@ -176,11 +219,11 @@ int main(int argc, char* argv[]){
 	string str;
 	ifstream fin;
 	string outfile;
-	ofstream fout;
+	OutputWriter fout;
 	string outfile2;
-	ofstream fout2;
+	OutputWriter fout2;
 	string outfile3;
-	ofstream fout3;
+	OutputWriter fout3;
 
 	wall_clock timer;
 	double runningtime;
@@ -258,6 +301,8 @@ int main(int argc, char* argv[]){
 	if(argi[ARG_RANDOM_SEED]!=default_int){RANDOM_SEED = argi[ARG_RANDOM_SEED];}
 	if(argi[ARG_KNN_ZSCORE]!=default_int){KNN_ZSCORE = argi[ARG_KNN_ZSCORE];}
 	if(argi[ARG_NUM_THREADS]!=default_int){NUM_THREADS = argi[ARG_NUM_THREADS];}
+	if(argi[ARG_COMPRESS_OUTPUT]!=default_int){COMPRESS_OUTPUT = argi[ARG_COMPRESS_OUTPUT];}
+	if(args[ARG_REF_SNAPSHOT]!=default_str){REF_SNAPSHOT = args[ARG_REF_SNAPSHOT];}
 	//##################     Read in and check parameter values #######################
 	if(PARAM_FILE.compare(default_str)==0){ PARAM_FILE = "laser.conf"; }
 	int flag = read_paramfile(PARAM_FILE);
@@ -293,6 +338,11 @@ int main(int argc, char* argv[]){
 	if(RANDOM_SEED==default_int){ RANDOM_SEED = 0; }
 	if(KNN_ZSCORE==default_int){ KNN_ZSCORE = 10; }
 	if(NUM_THREADS==default_int){ NUM_THREADS = 8; }
+	if(COMPRESS_OUTPUT==default_int){ COMPRESS_OUTPUT = 0; }
+	if(GENO_FILE.compare(default_str)!=0){ GENO_FILE = expand_file_list(GENO_FILE); }  // list or pattern of files, e.g. one per chromosome
+	if(SEQ_FILE.compare(default_str)!=0){ SEQ_FILE = expand_file_list(SEQ_FILE); }
+	TableReader::set_num_threads(NUM_THREADS);  // used to decompress BGZF input files
+	TableReader::set_read_ahead(NUM_THREADS > 1 ? 3 : 0);  // decompress input files on a separate thread while rows are parsed
 	//###############################################################################
 	if(OUT_PREFIX.compare(default_str)==0){ OUT_PREFIX = "laser"; }
 	foutLog.close();
@@ -306,17 +356,17 @@ int main(int argc, char* argv[]){
 		return 1;
 	}
 	//############## Get values for REF_INDS, LOCI, SEQ_INDS, NUM_PCS ################
-	int nrow = 0;
-	int ncol = 0;
+	int seq_nrow = 0, seq_ncol = 0;
+	int geno_nrow = 0, geno_ncol = 0;
+	int coord_nrow = 0, coord_ncol = 0;
 	flag = 1;
-	map<string,int> idxS;
-	map<string,int> idxG;
-	map<string,string> alleleS;
-	map<string,string> alleleG;	
-	vector<string> cmnsnp;
+	SiteTable seq_sites;
+	SiteTable geno_sites;  // kept until the loci in the EXCLUDE_LIST are marked
+	vector<pair<size_t,size_t>> cmnsnp;  // shared loci: sites in GENO_FILE and SEQ_FILE
+	vector<string> ref_sites;  // keys of the shared loci, kept only to be written to REF_SNAPSHOT
 	uvec cmnS;
 	uvec cmnG;
-	map<string,int> exSNP;	
+	unordered_set<string> exSNP;
 
 	int Lex = 0;
 	int LOCI_trim = 0;
@@ -328,14 +378,244 @@ int main(int argc, char* argv[]){
 	// long seed = time(NULL)*getpid();
 	gsl_rng_set(rng, RANDOM_SEED);
 	
+	// Dimensions, data format and coverage per locus are collected in a single pass over each input file.
+	bool check_seq_format = (CHECK_FORMAT == 1) || (CHECK_FORMAT == 3) || (CHECK_FORMAT == 10) || (CHECK_FORMAT == 30);
+	bool check_geno_format = (CHECK_FORMAT == 1) || (CHECK_FORMAT == 2) || (CHECK_FORMAT == 10) || (CHECK_FORMAT == 20);
+	bool check_coord_format = (CHECK_FORMAT == 1) || (CHECK_FORMAT == 4) || (CHECK_FORMAT == 10) || (CHECK_FORMAT == 40);
+	bool scan_coverage = ((CHECK_COVERAGE != 0) || (MAX_COVERAGE > 0) || (MIN_COVERAGE > 0)) && (PCA_MODE == 0) && ((CHECK_FORMAT == 0) || (CHECK_FORMAT >= 5));
+	int seq_format = 1;
+	int geno_format = 1;
+	int coord_format = 1;
+	string seq_format_message("");
+	string geno_format_message("");
+	string coord_format_message("");
+	vec C_loc;    // total coverage per locus in the SEQ_FILE
+	vec Ncov;     // number of samples with non-zero coverage per locus in the SEQ_FILE
+	string coverage_message("");
+
+	if (EXCLUDE_LIST.compare(default_str) != 0) {
+		fin.open(EXCLUDE_LIST.c_str());
+		if (fin.fail()) {
+			cerr << "Error: cannot open the file '" << EXCLUDE_LIST << "'." << endl;    
+			foutLog << "Error: cannot open the file '" << EXCLUDE_LIST << "'." << endl;   
+			foutLog.close();
+			gsl_rng_free(rng);	
+			return 1;
+		} else {
+			while (!fin.eof()) {
+				fin >> str;
+				if ((str.length() > 0) && (str != " ")) {
+					exSNP.insert(str);
+				}				
+			}
+			fin.close();
+		}
+	}
+
+	// Lists of files (e.g. one per chromosome) are read side by side as one table, which works for text files only.
+	// Lists of VCF files of GENO_FILE and pileup files of SEQ_FILE (one per sample) are read one after another.
+	string listed_files = (is_file_list(SEQ_FILE) ? SEQ_FILE : "") + "," + (is_file_list(GENO_FILE) ? GENO_FILE : "");
+	for (auto&& name: split_file_list(listed_files)) {
+		if (SparseSeqReader::is_sparse(name) || PackedGenotypeReader::is_packed(name) || (VcfReader::is_vcf(name) && !PackedGenotypeReader::can_read(GENO_FILE)) ||
+		    (PileupReader::is_pileup(name) && !SparseSeqReader::is_pileup(SEQ_FILE))) {
+			cerr << "Error: '" << name << "' can't be a part of a list of files. Only text GENO_FILE and SEQ_FILE, VCF files of GENO_FILE or pileup files of SEQ_FILE can be listed." << endl;
+			foutLog << "Error: '" << name << "' can't be a part of a list of files. Only text GENO_FILE and SEQ_FILE, VCF files of GENO_FILE or pileup files of SEQ_FILE can be listed." << endl;
+			foutLog.close();
+			return 1;
+		}
+	}
+
+	// SEQ_FILE, GENO_FILE and COORD_FILE (with their site files) are independent of each other until the shared loci are
+	// found, so each one is scanned by a separate task. The results are reported in the usual order once all tasks finish.
+	bool seq_cached = false;
+	bool seq_sites_loaded = false;
+	bool geno_sites_loaded = false;
+	string seq_sites_message("");
+	string geno_sites_message("");
+	future<void> seq_task;
+	future<void> geno_task;
+	future<void> coord_task;
+
+	ReferenceSnapshotReader snapshot;
+	if ((REF_SNAPSHOT.compare(default_str) != 0) && (GENO_FILE.compare(default_str) != 0) && (PCA_MODE == 0)) {
+		snapshot.open(REF_SNAPSHOT, GENO_FILE, build_sites_filename(GENO_FILE), (COORD_FILE.compare(default_str) != 0) ? COORD_FILE : "");
+		// files that match the snapshot are not checked again if their format was checked when it was written
+		uint32_t checked = (check_geno_format ? ReferenceSnapshotReader::CHECKED_GENO : 0u) |
+		                   ((check_coord_format && (COORD_FILE.compare(default_str) != 0)) ? ReferenceSnapshotReader::CHECKED_COORD : 0u);
+		if (snapshot.is_open() && !snapshot.is_checked(checked)) {
+			snapshot.close();
+		}
+	}
+
+	if (SEQ_FILE.compare(default_str) != 0) {
+        if (SparseSeqReader::is_pileup(SEQ_FILE)) { // pileup files are read at the loci of the GENO_FILE
+            if (GENO_FILE.compare(default_str) == 0) {
+                cerr << "Error: GENO_FILE (-g) is not specified, so loci of the pileup files in the SEQ_FILE are unknown." << endl;
+                foutLog << "Error: GENO_FILE (-g) is not specified, so loci of the pileup files in the SEQ_FILE are unknown." << endl;
+                foutLog.close();
+                return 1;
+            }
+            SEQ_SITE_FILE = build_sites_filename(GENO_FILE);
+        } else {
+            SEQ_SITE_FILE = build_sites_filename(SEQ_FILE);
+        }
+        seq_task = async(launch::async, [&]() {
+            seq_sites_loaded = seq_sites.load(SEQ_SITE_FILE, nullptr, seq_sites_message);
+            if (!seq_sites_loaded) {
+                return;
+            }
+            LOCI_S = seq_sites.size();
+            if (scan_coverage) {
+                C_loc = zeros<vec>(LOCI_S);
+                Ncov = zeros<vec>(LOCI_S);
+            }
+            SeqCacheReader seq_cache;
+            if (SparseSeqReader::can_read(SEQ_FILE)) { // sparse and pileup files list only the covered loci, so they need no binary cache
+                SparseSeqReader sparse_reader;
+                string population_id, individual_id;
+                vector<SparseSeqReader::Record> records;
+                int ind = 0;
+                try {
+                    open_sparse_seq(sparse_reader, seq_sites);
+                    if ((SparseSeqReader::is_binary(SEQ_FILE) || SparseSeqReader::is_pileup(SEQ_FILE)) && !scan_coverage) { // values were checked when the file was written, or are computed from pileups
+                        ind = sparse_reader.get_n_samples();
+                    } else { // samples of a text file are counted and checked in one pass
+                        while (sparse_reader.read_sample(population_id, individual_id, records)) {
+                            ++ind;
+                            if (scan_coverage) {
+                                add_coverage(ind, records, C_loc, Ncov);
+                            }
+                        }
+                    }
+                } catch (runtime_error& e) {
+                    seq_format = 0;
+                    seq_format_message = e.what();
+                }
+                seq_nrow = SEQ_NON_DATA_ROWS + ind;
+                seq_ncol = SEQ_NON_DATA_COLS + sparse_reader.get_n_loci();
+                sparse_reader.close();
+            } else if (seq_cache.open(SEQ_FILE) && (seq_cache.get_n_loci() == LOCI_S)) { // binary cache of the unchanged SEQ_FILE was built and checked by a previous run
+                seq_nrow = SEQ_NON_DATA_ROWS + seq_cache.get_n_samples();
+                seq_ncol = SEQ_NON_DATA_COLS + seq_cache.get_n_loci();
+                for (int ind = 1; scan_coverage && (ind <= (int)seq_cache.get_n_samples()); ++ind) {
+                    add_coverage(ind, seq_cache.get_coverage(ind - 1), C_loc, Ncov);
+                }
+                seq_cache.close();
+                seq_cached = true;
+            } else { // the binary cache is written while the SEQ_FILE is read, so that the next runs don't need to parse it
+                MultiTableReader reader(SEQ_NON_DATA_COLS);
+                SeqCacheWriter cache_writer;
+                function<void(size_t, int, const vector<char*>&, size_t)> row_callback = nullptr;
+                reader.set_file_name(SEQ_FILE);
+                // files of a list are scanned concurrently and cover different loci, so each one has its own first error
+                vector<string> file_messages(reader.get_n_files());
+                vector<int> file_errors(reader.get_n_files(), 0); // individual with the first error in every file
+                if (cache_writer.open(SEQ_FILE, LOCI_S) || scan_coverage) { // there is no cache for a list of files
+                    row_callback = [&](size_t file, int ind, const vector<char*>& row, size_t first_column) {
+                        if (scan_coverage && file_messages[file].empty()) {
+                            add_coverage(ind, row, first_column, C_loc, Ncov, file_messages[file]);
+                            file_errors[file] = file_messages[file].empty() ? 0 : ind;
+                        }
+                        cache_writer.write_row(row, SEQ_NON_DATA_COLS);
+                    };
+                }
+                reader.open();
+                seq_format = reader.scan(seq_nrow, seq_ncol, '\t', SEQ_NON_DATA_ROWS, SEQ_NON_DATA_COLS, TableReader::Format::SEQ, check_seq_format, seq_format_message, row_callback);
+                reader.close();
+                int coverage_error = 0;
+                for (size_t f = 0u; f < file_messages.size(); ++f) { // the error of the first individual is reported, as with one file
+                    if (!file_messages[f].empty() && (coverage_message.empty() || (file_errors[f] < coverage_error))) {
+                        coverage_message = file_messages[f];
+                        coverage_error = file_errors[f];
+                    }
+                }
+                if ((seq_format == 1) && (coverage_message.length() == 0)) {
+                    cache_writer.close();
+                }
+            }
+        });
+	}
+
+	if (GENO_FILE.compare(default_str) != 0) {
+        GENO_SITE_FILE = build_sites_filename(GENO_FILE);
+        geno_task = async(launch::async, [&]() {
+            bool vcf = false;
+            if (snapshot.is_open()) { // dimensions were counted and format was checked when the snapshot was written
+                geno_nrow = GENO_NON_DATA_ROWS + snapshot.get_geno_samples();
+                geno_ncol = GENO_NON_DATA_COLS + snapshot.get_geno_loci();
+            } else if (PackedGenotypeReader::is_packed(GENO_FILE)) { // dimensions are in the header, genotypes were checked when packing
+                PackedGenotypeReader packed_reader;
+                packed_reader.set_file_name(GENO_FILE);
+                packed_reader.open();
+                geno_nrow = GENO_NON_DATA_ROWS + packed_reader.get_n_samples();
+                geno_ncol = GENO_NON_DATA_COLS + packed_reader.get_n_loci();
+                packed_reader.close();
+            } else if (PackedGenotypeReader::can_read(GENO_FILE)) { // samples are in the VCF header, loci are counted with the sites
+                VcfReader vcf_reader;
+                vcf_reader.set_file_name(split_file_list(GENO_FILE).front());
+                vcf_reader.open();
+                geno_nrow = GENO_NON_DATA_ROWS + (int)vcf_reader.get_sample_ids().size();
+                vcf_reader.close();
+                vcf = true;
+            } else {
+                MultiTableReader reader(GENO_NON_DATA_COLS);
+                reader.set_file_name(GENO_FILE);
+                reader.open();
+                geno_format = reader.scan(geno_nrow, geno_ncol, '\t', GENO_NON_DATA_ROWS, GENO_NON_DATA_COLS, TableReader::Format::DIPLOID_GT, check_geno_format, geno_format_message);
+                reader.close();
+            }
+            // sites in the EXCLUDE_LIST are flagged while the file is read
+            geno_sites_loaded = geno_sites.load(GENO_SITE_FILE, &exSNP, geno_sites_message);
+            if (vcf) {
+                geno_ncol = GENO_NON_DATA_COLS + (int)geno_sites.size();
+            }
+        });
+	}
+
+	if ((COORD_FILE.compare(default_str) != 0) && (GENO_FILE.compare(default_str) != 0)) {
+        coord_task = async(launch::async, [&]() {
+            if (snapshot.is_open()) { // dimensions were counted and format was checked when the snapshot was written
+                coord_nrow = COORD_NON_DATA_ROWS + snapshot.get_geno_samples();
+                coord_ncol = COORD_NON_DATA_COLS + snapshot.get_coord_pcs();
+            } else {
+                TableReader coord_reader;
+                coord_reader.set_file_name(COORD_FILE);
+                coord_reader.open();
+                coord_format = coord_reader.scan(coord_nrow, coord_ncol, '\t', COORD_NON_DATA_ROWS, COORD_NON_DATA_COLS, TableReader::Format::FLOAT, check_coord_format, coord_format_message);
+                coord_reader.close();
+            }
+        });
+	}
+
+	// get() rethrows errors of the readers in this thread
+	if (seq_task.valid()) {
+		seq_task.get();
+	}
+	if (geno_task.valid()) {
+		geno_task.get();
+	}
+	if (coord_task.valid()) {
+		coord_task.get();
+	}
+
 	if ((SEQ_FILE.compare(default_str) != 0) && (flag == 1)) {
-	    TableReader reader;
-        reader.set_file_name(SEQ_FILE);
-        reader.open();
-        reader.get_dim(nrow, ncol, '\t');
-        reader.close();
-		SEQ_INDS = nrow - SEQ_NON_DATA_ROWS;
-		int tmpLOCI = ncol - SEQ_NON_DATA_COLS;
+        if (!seq_sites_loaded) {
+            cerr << seq_sites_message << endl;
+            foutLog << seq_sites_message << endl;
+            foutLog.close();
+            return 1;
+        }
+        if (seq_cached) {
+            cout << "Using binary cache '" << SEQ_FILE << SeqCacheReader::EXTENSION << "' of the SEQ_FILE." << endl;
+            foutLog << "Using binary cache '" << SEQ_FILE << SeqCacheReader::EXTENSION << "' of the SEQ_FILE." << endl;
+        }
+        if (SparseSeqReader::can_read(SEQ_FILE) && (seq_format == 0)) { // sparse files are always checked while counting samples
+            cerr << seq_format_message << endl;
+            foutLog << seq_format_message << endl;
+            flag = 0;
+        }
+		SEQ_INDS = seq_nrow - SEQ_NON_DATA_ROWS;
+		int tmpLOCI = seq_ncol - SEQ_NON_DATA_COLS;
 		cout << SEQ_INDS << " individuals in the SEQ_FILE." << endl;
 		foutLog << SEQ_INDS << " individuals in the SEQ_FILE." << endl;
 		if (SEQ_INDS < 0) {
@@ -348,26 +628,6 @@ int main(int argc, char* argv[]){
 			foutLog << "Error: Invalid number of columns in the SEQ_FILE '" << SEQ_FILE << "'." << endl;
 			flag = 0;
 		}
-        SEQ_SITE_FILE = build_sites_filename(SEQ_FILE);
-        vector<string> tokens;
-        reader.set_file_name(SEQ_SITE_FILE);
-        reader.open();
-        LOCI_S = 0;
-        reader.read_row(tokens, '\t'); //skip header TODO: check if header = CHR\tPOS\tID\tREF\tALT
-        while (reader.read_row(tokens, '\t') >= 0) {
-            if (tokens.size() != 5) {
-                cerr << "Error: incorrect number of columns in '" << SEQ_SITE_FILE << "'." << endl;
-                foutLog << "Error: incorrect number of columns in '" << SEQ_SITE_FILE << "'." << endl;
-                foutLog.close();
-                return 1;
-            }
-            string variant_name = tokens.at(0) + ":" + tokens.at(1);
-            string variant_alleles = tokens.at(3) + "," + tokens.at(4);
-            idxS[variant_name] = LOCI_S;
-            alleleS[variant_name] = variant_alleles;
-            ++LOCI_S;
-        }
-        reader.close();
 		cout << LOCI_S << " loci in the SEQ_FILE." << endl;
 		foutLog << LOCI_S << " loci in the SEQ_FILE." << endl;
 		if ((tmpLOCI < 0) || (tmpLOCI != LOCI_S)) {
@@ -377,14 +637,14 @@ int main(int argc, char* argv[]){
 		}
 	}
 
+	if (snapshot.is_open() && (flag == 1)) {
+		cout << "Reference panel snapshot '" << REF_SNAPSHOT << "' matches the GENO_FILE." << endl;
+		foutLog << "Reference panel snapshot '" << REF_SNAPSHOT << "' matches the GENO_FILE." << endl;
+	}
+
 	if ((GENO_FILE.compare(default_str) != 0) && (flag == 1)) {
-        TableReader reader;
-        reader.set_file_name(GENO_FILE);
-        reader.open();
-        reader.get_dim(nrow, ncol, '\t');
-        reader.close();
-        REF_INDS = nrow - GENO_NON_DATA_ROWS;
-		int tmpLOCI = ncol - GENO_NON_DATA_COLS;
+        REF_INDS = geno_nrow - GENO_NON_DATA_ROWS;
+		int tmpLOCI = geno_ncol - GENO_NON_DATA_COLS;
 		cout << REF_INDS << " individuals in the GENO_FILE." << endl; 
 		foutLog << REF_INDS << " individuals in the GENO_FILE." << endl; 		 		
 		if (REF_INDS < 0) {
@@ -398,42 +658,29 @@ int main(int argc, char* argv[]){
 			flag = 0;
 		}
 
-        GENO_SITE_FILE = build_sites_filename(GENO_FILE);
-        vector<string> tokens;
-        reader.set_file_name(GENO_SITE_FILE);
-        reader.open();
-        LOCI_G = 0;
-        LOCI = 0;
-        reader.read_row(tokens, '\t'); //skip header TODO: check if header = CHR\tPOS\tID\tREF\tALT
-        while (reader.read_row(tokens, '\t') >= 0) {
-            if (tokens.size() != 5) {
-                cerr << "Error: incorrect number of columns in '" << GENO_SITE_FILE << "'." << endl;
-                foutLog << "Error: incorrect number of columns in '" << GENO_SITE_FILE << "'." << endl;
-                foutLog.close();
-                return 1;
-            }
-            string variant_name = tokens.at(0) + ":" + tokens.at(1);
-            string variant_alleles = tokens.at(3) + "," + tokens.at(4);
-            idxG[variant_name] = LOCI_G;
-            alleleG[variant_name] = variant_alleles;
-            ++LOCI_G;
-            if((SEQ_FILE.compare(default_str) != 0) && (PCA_MODE == 0)) {
-                if (idxS.count(variant_name) > 0) {
-                    if (alleleS[variant_name].compare(variant_alleles) != 0 ) {
-                        cerr << "Warning: Two datasets have different alleles at locus [" << variant_name << "]: " << "[" << variant_alleles<< "] vs [" << alleleS[variant_name] << "]." << endl;
-                        foutLog << "Warning: Two datasets have different alleles at locus [" << variant_name << "]: " << "[" << variant_alleles << "] vs [" << alleleS[variant_name] << "]." << endl;
-                        ++unmatchSite;
-                    } else {
-                        cmnsnp.push_back(variant_name);
-                        ++LOCI;
-                    }
+        if (!geno_sites_loaded) {
+            cerr << geno_sites_message << endl;
+            foutLog << geno_sites_message << endl;
+            foutLog.close();
+            return 1;
+        }
+        LOCI_G = geno_sites.size();
+        if ((SEQ_FILE.compare(default_str) != 0) && (PCA_MODE == 0)) {
+            geno_sites.intersect(seq_sites, [&](size_t g, size_t s, bool same_alleles) {
+                if (!same_alleles) {
+                    cerr << "Warning: Two datasets have different alleles at locus [" << geno_sites.get_name(g) << "]: " << "[" << geno_sites.get_alleles(g) << "] vs [" << seq_sites.get_alleles(s) << "]." << endl;
+                    foutLog << "Warning: Two datasets have different alleles at locus [" << geno_sites.get_name(g) << "]: " << "[" << geno_sites.get_alleles(g) << "] vs [" << seq_sites.get_alleles(s) << "]." << endl;
+                    ++unmatchSite;
+                } else {
+                    cmnsnp.emplace_back(geno_sites.get_last(g), s);
                 }
-            } else {
-                cmnsnp.push_back(variant_name);
-				++LOCI;
+            });
+        } else {
+            for (size_t g = 0u; g < geno_sites.size(); ++g) {
+                cmnsnp.emplace_back(geno_sites.get_last(g), 0u);
             }
         }
-        reader.close();
+        LOCI = cmnsnp.size();
 
 //		GENO_SITE_FILE = GENO_FILE;
 //		GENO_SITE_FILE.replace(GENO_SITE_FILE.length()-5, 5, ".site");
@@ -500,21 +747,26 @@ int main(int argc, char* argv[]){
 				cmnS.set_size(LOCI);
 				cmnG.set_size(LOCI);
 				for(i=0; i<LOCI; i++){
-					cmnG(i)=idxG[cmnsnp[i]];
-					cmnS(i)=idxS[cmnsnp[i]];
+					cmnG(i)=cmnsnp[i].first;
+					cmnS(i)=cmnsnp[i].second;
 				}
 			}else{
 				cmnG.set_size(LOCI);
 				for(i=0; i<LOCI; i++){
-					cmnG(i)=idxG[cmnsnp[i]];
+					cmnG(i)=cmnsnp[i].first;
 				}				
 			}
+			if (REF_SNAPSHOT.compare(default_str) != 0) {
+				ref_sites.reserve(LOCI);
+				for(i=0; i<LOCI; i++){
+					ref_sites.push_back(geno_sites.get_name(cmnG(i)));
+				}
+			}
 		}
 		cmnsnp.clear();
-		idxG.clear();
-		idxS.clear();
-		alleleG.clear();
-		alleleS.clear();
+		if (!SparseSeqReader::is_pileup(SEQ_FILE)) { // positions in pileup files are looked up while they are read
+			seq_sites.clear();
+		}
 	} else {
 		cerr << "Error: GENO_FILE (-g) is not specified." << endl;
 		foutLog << "Error: GENO_FILE (-g) is not specified." << endl;
@@ -524,13 +776,8 @@ int main(int argc, char* argv[]){
 	}
 	
 	if ((COORD_FILE.compare(default_str) != 0) && (GENO_FILE.compare(default_str) != 0) && (flag == 1)) {
-        TableReader coord_reader;
-        coord_reader.set_file_name(COORD_FILE);
-        coord_reader.open();
-        coord_reader.get_dim(nrow, ncol, '\t');
-        coord_reader.close();
-		int tmpINDS = nrow - COORD_NON_DATA_ROWS;
-		NUM_PCS = ncol - COORD_NON_DATA_COLS;
+		int tmpINDS = coord_nrow - COORD_NON_DATA_ROWS;
+		NUM_PCS = coord_ncol - COORD_NON_DATA_COLS;
 		cout << tmpINDS << " individuals in the COORD_FILE." << endl;
 		cout << NUM_PCS << " PCs in the COORD_FILE." << endl;
 		foutLog << tmpINDS << " individuals in the COORD_FILE." << endl;
@@ -623,60 +870,45 @@ int main(int argc, char* argv[]){
 		cout << "Checking data format ..." << endl;
 		foutLog << endl << asctime (timeinfo);
 		foutLog << "Checking data format ..." << endl;
-		if ((CHECK_FORMAT == 1) || (CHECK_FORMAT == 2) || (CHECK_FORMAT == 10) || (CHECK_FORMAT == 20)) {
+		if (check_geno_format) {
 			if (GENO_FILE.compare(default_str) != 0) {
-			    TableReader geno_reader;
-			    string message("");
-			    geno_reader.set_file_name(GENO_FILE);
-			    geno_reader.open();
-				flag1 = geno_reader.check_format(GENO_NON_DATA_ROWS, GENO_NON_DATA_COLS, REF_INDS, LOCI_G, TableReader::Format::DIPLOID_GT, message);
-				geno_reader.close();
+				flag1 = geno_format;
 				if (flag1 == 1) {
 					cout << "GENO_FILE: OK." << endl;
 					foutLog << "GENO_FILE: OK." << endl;				
-				} else if (message.length() > 0) {
-                    cout << message << endl;
-                    foutLog << message << endl;
+				} else if (geno_format_message.length() > 0) {
+                    cout << geno_format_message << endl;
+                    foutLog << geno_format_message << endl;
 				}
 			} else {
 					cout << "GENO_FILE: not specified." << endl;
 					foutLog << "GENO_FILE: not specified." << endl;
 			}
 		}
-		if ((CHECK_FORMAT == 1) || (CHECK_FORMAT == 3) || (CHECK_FORMAT == 10) || (CHECK_FORMAT == 30)) {
+		if (check_seq_format) {
 			if (SEQ_FILE.compare(default_str) != 0) {
-			    TableReader seq_reader;
-			    string message("");
-			    seq_reader.set_file_name(SEQ_FILE);
-			    seq_reader.open();
-                flag2 = seq_reader.check_format(SEQ_NON_DATA_ROWS, SEQ_NON_DATA_COLS, SEQ_INDS, LOCI_S, TableReader::Format::SEQ, message);
-				seq_reader.close();
+				flag2 = seq_format;
 				if (flag2 == 1) {
 					cout << "SEQ_FILE: OK." << endl;
 					foutLog << "SEQ_FILE: OK." << endl;
 				} else {
-                    cout << message << endl;
-                    foutLog << message << endl;
+                    cout << seq_format_message << endl;
+                    foutLog << seq_format_message << endl;
 				}
 			} else {
 					cout << "SEQ_FILE: not specified." << endl;
 					foutLog << "SEQ_FILE: not specified." << endl;
 			}
 		}
-		if ((CHECK_FORMAT == 1) || (CHECK_FORMAT == 4) || (CHECK_FORMAT == 10) || (CHECK_FORMAT == 40)) {
+		if (check_coord_format) {
 			if (COORD_FILE.compare(default_str) != 0) {
-			    TableReader coord_reader;
-			    string message("");
-			    coord_reader.set_file_name(COORD_FILE);
-			    coord_reader.open();
-                flag3 = coord_reader.check_format(COORD_NON_DATA_ROWS, COORD_NON_DATA_COLS, REF_INDS, NUM_PCS, TableReader::Format::FLOAT, message);
-				coord_reader.close();
+				flag3 = coord_format;
 				if (flag3 == 1) {
 					cout << "COORD_FILE: OK." << endl;
 					foutLog << "COORD_FILE: OK." << endl;
 				} else {
-                    cout << message << endl;
-                    foutLog << message << endl;
+                    cout << coord_format_message << endl;
+                    foutLog << coord_format_message << endl;
 				}
 			} else {
 			    cout << "COORD_FILE: not specified." << endl;
@@ -732,54 +964,17 @@ int main(int argc, char* argv[]){
 	// ###################### Exclude SNPs in the excluding list #################
 	urowvec ExLoci = zeros<urowvec>(LOCI);	
 
-	if (EXCLUDE_LIST.compare(default_str) != 0) {
-		fin.open(EXCLUDE_LIST.c_str());
-		if (fin.fail()) {
-			cerr << "Error: cannot open the file '" << EXCLUDE_LIST << "'." << endl;    
-			foutLog << "Error: cannot open the file '" << EXCLUDE_LIST << "'." << endl;   
-			foutLog.close();
-			gsl_rng_free(rng);	
-			return 1;
-		} else {
-			map<string, int> exSNP;
-			while (!fin.eof()) {
-				fin >> str;
-				if ((str.length() > 0) && (str != " ")) {
-					exSNP[str] = 1;
-				}				
-			}
-			fin.close();
-					
-			fin.open(GENO_SITE_FILE.c_str());
-			if (fin.fail()) {
-				cerr << "Error: cannot open the file '" << GENO_SITE_FILE << "'." << endl;    
-				foutLog << "Error: cannot open the file '" << GENO_SITE_FILE << "'." << endl;   
-				foutLog.close();
-				gsl_rng_free(rng);	
-				return 1;
-			} else if (exSNP.size() > 0) {
-				getline(fin, str);
-				string snpID;
-				k = 0;
-				for (j = 0; j < LOCI_G; ++j) {
-					fin >> str >> str >> snpID;
-					getline(fin, str);
-					if (j == cmnG(k)) {
-						if ((exSNP.count(snpID) > 0) && (ExLoci(k) == 0)){
-							ExLoci(k) = 1;
-							++LOCI_ex;
-						}
-						++k;
-					}
-					if (k == LOCI) {
-					    break;
-					}
-				}
+	if (exSNP.size() > 0) { // sites in the EXCLUDE_LIST were flagged when GENO_SITE_FILE was read
+		for (k = 0; k < LOCI; ++k) {
+			if (geno_sites.is_excluded(cmnG(k)) && (ExLoci(k) == 0)) {
+				ExLoci(k) = 1;
+				++LOCI_ex;
 			}
-			fin.close();
-			Lex += LOCI_ex;
 		}
+		Lex += LOCI_ex;
 	}
+	geno_sites.clear();
+	exSNP.clear();
 	if (TRIM_PROP > 0) {
 		for (int j = 0; j < LOCI; ++j) {
 			if ((gsl_rng_uniform(rng) < TRIM_PROP) && (ExLoci(j) == 0)) {
@@ -802,7 +997,7 @@ int main(int argc, char* argv[]){
   		foutLog << endl << asctime (timeinfo);
 		foutLog << "Checking coverage in the sequence data ..." << endl;
 
-		int flag = check_coverage(CHECK_COVERAGE, FIRST_IND, LAST_IND, cmnS, ExLoci, Ls, Lg);
+		int flag = check_coverage(CHECK_COVERAGE, FIRST_IND, LAST_IND, cmnS, ExLoci, C_loc, Ncov, coverage_message, seq_sites, Ls, Lg);
 		if (flag == 0) {
 			foutLog.close();
 			gsl_rng_free(rng);	
@@ -872,18 +1067,46 @@ int main(int argc, char* argv[]){
 	// == Variables to be saved for reused ==
 	string *RefInfo1 = new string [REF_SIZE];
 	string *RefInfo2 = new string [REF_SIZE];
-	Mat<char> RefG(REF_SIZE, LOCI_in);
+	Mat<char> RefG;
 	mat refPC = zeros<mat>(REF_SIZE,DIM);
+	rowvec PCvar;
+	// === The reference panel is taken from REF_SNAPSHOT if it was prepared for the same loci, individuals and DIM ===
+	vector<uint32_t> ref_samples(Refset.begin(), Refset.end());
+	vector<uint32_t> ref_loci;
+	vector<string> ref_keys;
+	for (j = 0; j < LOCI; ++j) {
+		if (ExLoci(j) == 0) {
+			ref_loci.push_back(cmnG(j));
+			if (j < (int)ref_sites.size()) {
+				ref_keys.push_back(ref_sites[j]);
+			}
+		}
+	}
+	ref_sites.clear();
+	bool from_snapshot = snapshot.matches(ref_samples, ref_loci, DIM, { ReferenceSnapshotReader::REF_PC });
+	bool write_snapshot = (REF_SNAPSHOT.compare(default_str) != 0) && (PCA_MODE == 0) && !from_snapshot;
 	//========================= Read reference data ==========================
 
-    TableReader geno_reader;
-    vector<string> tokens;
+    MultiTableReader geno_reader(GENO_NON_DATA_COLS);
+    vector<char*> tokens;
     int row = 0;
     i = 0;
     int ii = 0;
-
-    geno_reader.set_file_name(GENO_FILE.c_str());
-    geno_reader.open();
+    string geno_message;
+
+    PackedGenotypeReader packed_reader;
+    bool packed = PackedGenotypeReader::can_read(GENO_FILE); // VCF files are decoded into the same 2-bit codes
+    bool stream_ref = false; // loci of a locus-major file are read block by block while the GRM is calculated
+    if (from_snapshot) {
+        packed = false;
+    } else if (packed) {
+        packed_reader.set_file_name(GENO_FILE);
+        packed_reader.open();
+        stream_ref = packed_reader.is_locus_major() && (PCA_MODE == 1);
+    } else {
+        geno_reader.set_file_name(GENO_FILE.c_str());
+        geno_reader.open();
+    }
 
 //	fin.open(GENO_FILE.c_str());
 //	if(fin.fail()){
@@ -900,34 +1123,87 @@ int main(int argc, char* argv[]){
   	foutLog << endl << asctime (timeinfo);
 	foutLog << "Reading reference genotypes ..." << endl;
 
-    while (geno_reader.read_row(tokens, '\t') >= 0) {
-        ++row;
-        if (row <= GENO_NON_DATA_ROWS) { // skip header lines;
-            continue;
+    if (!stream_ref) {
+        RefG.set_size(REF_SIZE, LOCI_in);
+    }
+    if (from_snapshot) { // genotypes are decoded from the 2-bit codes in the snapshot
+        for (ii = 0; ii < REF_SIZE; ++ii) {
+            const unsigned char* genotypes = snapshot.get_genotypes(ii);
+            RefInfo1[ii] = snapshot.get_population_id(ii);
+            RefInfo2[ii] = snapshot.get_individual_id(ii);
+            for (k = 0; k < LOCI_in; ++k) {
+                RefG(ii, k) = PackedGenotypeReader::get_value(genotypes, k);
+            }
+        }
+    } else if (packed && packed_reader.is_locus_major()) { // genotypes are decoded directly from the 2-bit codes of every locus
+        for (ii = 0; ii < REF_SIZE; ++ii) {
+            RefInfo1[ii] = packed_reader.get_population_id(Refset[ii]);
+            RefInfo2[ii] = packed_reader.get_individual_id(Refset[ii]);
         }
-        if (i == Refset[ii]) {
-            RefInfo1[ii] = tokens.at(0);
-            RefInfo2[ii] = tokens.at(1);
-            frowvec tmpG = zeros<frowvec>(LOCI_G);
-            for(j = 0; j < LOCI_G; ++j){
-                tmpG(j) = stof(tokens.at(GENO_NON_DATA_COLS + j));    // Read genotype data
+        for (k = 0; (k < LOCI_in) && !stream_ref; ++k) {
+            const unsigned char* genotypes = packed_reader.get_locus(ref_loci[k]);
+            for (ii = 0; ii < REF_SIZE; ++ii) {
+                RefG(ii, k) = PackedGenotypeReader::get_value(genotypes, Refset[ii]);
             }
+        }
+    } else if (packed) { // genotypes are decoded directly from the 2-bit codes
+        for (ii = 0; ii < REF_SIZE; ++ii) {
+            const unsigned char* genotypes = packed_reader.get_row(Refset[ii]);
+            RefInfo1[ii] = packed_reader.get_population_id(Refset[ii]);
+            RefInfo2[ii] = packed_reader.get_individual_id(Refset[ii]);
             k = 0;
             for (j = 0; j < LOCI; ++j) {
                 if (ExLoci(j) == 0) {
-                    RefG(ii, k) = tmpG(cmnG(j));
+                    RefG(ii, k) = PackedGenotypeReader::get_value(genotypes, cmnG(j));
                     ++k;
                 }
             }
-            ++ii;
         }
-        if (ii == REF_SIZE) {
-            break;
+    }
+    if (geno_reader.is_open()) { // rows are parsed on NUM_THREADS threads, each one straight into its row of RefG
+        vector<int> ref_index(Refset[REF_SIZE - 1] + 1, -1); // position of each sample in Refset
+        vector<unsigned int> columns;                         // columns of the loci left after exclusions
+        for (ii = 0; ii < REF_SIZE; ++ii) {
+            ref_index[Refset[ii]] = ii;
         }
-        ++i;
+        for (j = 0; j < LOCI; ++j) {
+            if (ExLoci(j) == 0) {
+                columns.push_back(GENO_NON_DATA_COLS + cmnG(j));
+            }
+        }
+        geno_reader.read_rows('\t', GENO_NON_DATA_ROWS + Refset[REF_SIZE - 1] + 1, [&](long int row, const vector<char*>& tokens, string& message) -> bool {
+            if ((row <= GENO_NON_DATA_ROWS) || (ref_index[row - GENO_NON_DATA_ROWS - 1] < 0)) { // skip header lines and samples outside of the reference
+                return true;
+            }
+            int ref = ref_index[row - GENO_NON_DATA_ROWS - 1];
+            int genotype = 0;
+            RefInfo1[ref] = tokens.at(0);
+            RefInfo2[ref] = tokens.at(1);
+            for (unsigned int c = 0; c < columns.size(); ++c) {
+                if (!TableReader::parse_genotype(tokens.at(columns[c]), genotype)) {    // Read genotype data
+                    message = "Error: invalid value '" + string(tokens[columns[c]]) + "' in (row " + to_string(row) + ", column " +
+                            to_string(columns[c]) + ") in the file '" + GENO_FILE + "'.";
+                    return false;
+                }
+                RefG(ref, c) = (char)genotype;
+            }
+            return true;
+        }, geno_message);
     }
 
     geno_reader.close();
+    if (!stream_ref) {
+        packed_reader.close();
+    }
+    if (!geno_message.empty()) {
+        cerr << geno_message << endl;
+        foutLog << geno_message << endl;
+        delete [] RefInfo1;
+        delete [] RefInfo2;
+        foutLog.close();
+        gsl_rng_free(rng);
+        return 1;
+    }
 
 //	for(i=0; i<GENO_NON_DATA_ROWS; i++){
 //		getline(fin, str);          // Read non-data rows
@@ -975,7 +1251,9 @@ int main(int argc, char* argv[]){
 	//========================= Get reference coordinates  ==========================
 	time ( &rawtime );
 	timeinfo = localtime ( &rawtime );
-	if(COORD_FILE.compare(default_str)!=0 && PCA_MODE==0){
+	if(from_snapshot && COORD_FILE.compare(default_str)!=0){
+		refPC = mat(snapshot.get_ref_pc(), REF_SIZE, DIM);   // coordinates were read from the COORD_FILE when the snapshot was written
+	}else if(COORD_FILE.compare(default_str)!=0 && PCA_MODE==0){
 		fin.open(COORD_FILE.c_str());
 		if(fin.fail()){
 			cerr << "Error: cannot find the COORD_FILE '" << COORD_FILE << "'." << endl;
@@ -1037,16 +1315,32 @@ int main(int argc, char* argv[]){
 		cout << "Performing PCA on reference genotypes ..." << endl;
 		foutLog << endl << asctime (timeinfo);
 		foutLog << "Performing PCA on reference genotypes ..." << endl;	
-		rowvec PCvar = zeros<rowvec>(DIM);
+		PCvar = zeros<rowvec>(DIM);
 		fmat Gm;
 		fmat Gsd;
 		fmat W;
+		// loci a..b of the reference panel for the blockwise PCA
+		function<void(int, int, fmat&)> get_ref_block = [&](int a, int b, fmat &Gb) {
+			Gb = conv_to<fmat>::from(RefG.cols(a, b));
+		};
+		if(stream_ref){
+			get_ref_block = [&](int a, int b, fmat &Gb) {
+				Gb.set_size(REF_SIZE, b-a+1);
+				#pragma omp parallel for num_threads(NUM_THREADS)
+				for(int l=a; l<=b; l++){
+					const unsigned char* genotypes = packed_reader.get_locus(ref_loci[l]);
+					for(int r=0; r<REF_SIZE; r++){
+						Gb(r, l-a) = PackedGenotypeReader::get_value(genotypes, Refset[r]);
+					}
+				}
+			};
+		}
 		if(PCA_MODE==1){
 			mat GRM(REF_SIZE, REF_SIZE);
-			pca(conv_to<fmat>::from(RefG), DIM, refPC, PCvar, GRM);   // Perform PCA based on EVD
+			pca(REF_SIZE, LOCI_in, get_ref_block, DIM, refPC, PCvar, GRM);   // Perform PCA based on EVD
+			packed_reader.close();
 			GRM = GRM/LOCI_in;
-			outfile = OUT_PREFIX;
-			outfile.append(".RefPC.grm");
+			outfile = output_file_name(".RefPC.grm");
 			fout.open(outfile.c_str());
 			if(fout.fail()){
 				cerr << "Error: cannot create a file named " << outfile << "." << endl;
@@ -1066,8 +1360,7 @@ int main(int argc, char* argv[]){
 			foutLog << "Genetic relationship matrix is output to '" << outfile << "'." << endl;				
 			
 			//======== Calculating Z scores for reference individuals =========
-			outfile = OUT_PREFIX;
-			outfile.append(".RefPC.zscore");
+			outfile = output_file_name(".RefPC.zscore");
 			fout.open(outfile.c_str());
 			if(fout.fail()){
 				cerr << "Error: cannot create a file named " << outfile << "." << endl;
@@ -1105,13 +1398,15 @@ int main(int argc, char* argv[]){
 			pca_geno(RefG, DIM, refPC, PCvar);   // Perform PCA	(slow but memory efficient)
 		}else if(PCA_MODE==3){
 			pca_svd(conv_to<fmat>::from(RefG), DIM, refPC, PCvar, Gm, Gsd, W); // Perform PCA based on SVD
+		}else if(from_snapshot){
+			refPC = mat(snapshot.get_ref_pc(), REF_SIZE, DIM);
+			PCvar = rowvec(snapshot.get_pc_var(), DIM);
 		}else{
 			mat GRM(REF_SIZE, REF_SIZE);
-			pca(conv_to<fmat>::from(RefG), DIM, refPC, PCvar, GRM);   // Perform PCA based on EVD
+			pca(REF_SIZE, LOCI_in, get_ref_block, DIM, refPC, PCvar, GRM);   // Perform PCA based on EVD
 		}
 		//==================== Output reference PCs ==========================
-		outfile = OUT_PREFIX;
-		outfile.append(".RefPC.coord");
+		outfile = output_file_name(".RefPC.coord");
 		fout.open(outfile.c_str());
 		if(fout.fail()){
 			cerr << "Error: cannot create a file named " << outfile << "." << endl;
@@ -1134,8 +1429,7 @@ int main(int argc, char* argv[]){
 		cout << "Reference PCA coordinates are output to '" << outfile << "'." << endl;
 		foutLog << "Reference PCA coordinates are output to '" << outfile << "'." << endl;
 		//==================================================================
-		outfile = OUT_PREFIX;
-		outfile.append(".RefPC.var");
+		outfile = output_file_name(".RefPC.var");
 		fout.open(outfile.c_str());
 		if(fout.fail()){
 			cerr << "Error: cannot create a file named " << outfile << "." << endl;
@@ -1149,23 +1443,11 @@ int main(int argc, char* argv[]){
 			fout << j+1 << "\t" << PCvar(j) << endl;
 		}	
 		fout.close();
-		PCvar.clear();
 		cout << "Variances explained by PCs are output to '" << outfile << "'." << endl;
 		foutLog << "Variances explained by PCs are output to '" << outfile << "'." << endl;
 		//===================================================================
 		if(PCA_MODE==3){
-			fin.open(GENO_SITE_FILE.c_str());
-			if(fin.fail()){
-				cerr << "Error: cannot find the SITE_FILE '" << GENO_SITE_FILE << "'." << endl;
-				foutLog << "Error: cannot find the SITE_FILE '" << GENO_SITE_FILE << "'." << endl;
-				foutLog.close();
-				gsl_rng_free(rng);	
-				return 1;
-			}
-			getline(fin, str);
-			
-			outfile = OUT_PREFIX;
-			outfile.append(".RefPC.load");
+			outfile = output_file_name(".RefPC.load");
 			fout.open(outfile.c_str());
 			if(fout.fail()){
 				cerr << "Error: cannot create a file named " << outfile << "." << endl;
@@ -1178,20 +1460,18 @@ int main(int argc, char* argv[]){
 			for(k=0; k<DIM-1; k++){ fout << "PC" << k+1 << "\t"; }
 			fout << "PC" << DIM << endl;
 			i=0;
-			for(j=0; j<LOCI; j++){
-				fin >> str >> str >> str;
-				if(ExLoci(j)==0){
-					fout << str << "\t" << Gm(i) << "\t" << Gsd(i) << "\t";
+			read_site_ids(GENO_SITE_FILE, [&](int site, const char* id) -> bool {
+				if(ExLoci(site)==0){
+					fout << id << "\t" << Gm(i) << "\t" << Gsd(i) << "\t";
 					for(k=0; k<DIM-1; k++){ fout << W(i,k) << "\t"; }; 
 					fout << W(i,DIM-1) << endl;
 					i++;
 				}
-				getline(fin, str);
-			}		
+				return site + 1 < LOCI;
+			});
 			fout.close();
 			cout << "Reference PCA loadings are output to '" << outfile << "'." << endl;
 			foutLog << "Reference PCA loadings are output to '" << outfile << "'." << endl;
-			fin.close();
 		}	
 		//===================================================================
 		if(PCA_MODE > 0){                                 // If performing PCA only
@@ -1211,21 +1491,82 @@ int main(int argc, char* argv[]){
 			return 0;	
 		}
 	}
+	snapshot.close();
+	if (write_snapshot) {
+		ReferenceSnapshotWriter snapshot_writer;
+		snapshot_writer.set_checked((check_geno_format ? ReferenceSnapshotReader::CHECKED_GENO : 0u) |
+		                            (check_coord_format ? ReferenceSnapshotReader::CHECKED_COORD : 0u));
+		snapshot_writer.set_samples(ref_samples, RefInfo1, RefInfo2);
+		snapshot_writer.set_loci(ref_loci, ref_keys);
+		snapshot_writer.set_ref_pc(refPC.memptr(), DIM, (COORD_FILE.compare(default_str) != 0) ? nullptr : PCvar.memptr());
+		if (snapshot_writer.set_genotypes(RefG.memptr()) &&
+		    snapshot_writer.set_sources(GENO_FILE, GENO_SITE_FILE, (COORD_FILE.compare(default_str) != 0) ? COORD_FILE : "", REF_INDS, LOCI_G, NUM_PCS) &&
+		    snapshot_writer.write(REF_SNAPSHOT)) {
+			cout << "Reference panel snapshot is output to '" << REF_SNAPSHOT << "'." << endl;
+			foutLog << "Reference panel snapshot is output to '" << REF_SNAPSHOT << "'." << endl;
+		} else {
+			cerr << "Warning: cannot create the reference panel snapshot '" << REF_SNAPSHOT << "'." << endl;
+			foutLog << "Warning: cannot create the reference panel snapshot '" << REF_SNAPSHOT << "'." << endl;
+		}
+	}
+	PCvar.clear();
 	delete [] RefInfo1;
 	delete [] RefInfo2;
 					
 	//========================= Read sequence data ==========================
 
-	TableReader seq_reader;
+	MultiTableReader seq_reader(SEQ_NON_DATA_COLS);
     char* end = nullptr;
     const char* token = nullptr;
 
-    seq_reader.set_file_name(SEQ_FILE);
-	seq_reader.open();
+    SparseSeqReader sparse_reader;
+    string sparse_population_id;
+    string sparse_individual_id;
+    vector<SparseSeqReader::Record> sparse_records;
+    bool sparse = SparseSeqReader::can_read(SEQ_FILE);
+    SeqCacheReader seq_cache;
+    bool cached = !sparse && seq_cache.open(SEQ_FILE) && (seq_cache.get_n_loci() == LOCI_S);
+    if (sparse) {
+        open_sparse_seq(sparse_reader, seq_sites);
+    } else if (!cached) {
+        seq_reader.set_file_name(SEQ_FILE);
+        seq_reader.open();
+    }
+
+    // Only loci left after the allele check, EXCLUDE_LIST and TRIM_PROP are decoded. The tokenizer returns the ID columns
+    // and the selected loci only; seq_fields[k] is the field of the k-th analyzed locus and seq_loci[k] is its SEQ locus.
+    vector<bool> seq_selected(SEQ_NON_DATA_COLS + LOCI_S, false);
+    vector<unsigned int> seq_loci;
+    vector<unsigned int> seq_fields;
+    vector<unsigned int> seq_rank(LOCI_S, 0u);
+    fill(seq_selected.begin(), seq_selected.begin() + SEQ_NON_DATA_COLS, true);
+    for (j = 0; j < LOCI; ++j) {
+        if (ExLoci(j) == 0) {
+            seq_loci.push_back(cmnS(j));
+            seq_selected[SEQ_NON_DATA_COLS + cmnS(j)] = true;
+        }
+    }
+    for (j = 0, k = SEQ_NON_DATA_COLS; j < LOCI_S; ++j) {
+        if (seq_selected[SEQ_NON_DATA_COLS + j]) {
+            seq_rank[j] = k++;
+        }
+    }
+    for (j = 0; j < LOCI_in; ++j) {
+        seq_fields.push_back(seq_rank[seq_loci[j]]);
+    }
+    // Per-sample records of the covered loci only: analyzed locus k, its coverage, sequence read and base quality.
+    // Low-coverage samples have few of them, so the rest of the pipeline doesn't depend on LOCI_in.
+    vector<int> seq_analyzed(sparse ? LOCI_S : 0, -1); // analyzed locus k of every SEQ locus in a sparse SEQ_FILE
+    for (j = 0; sparse && (j < LOCI_in); ++j) {
+        seq_analyzed[seq_loci[j]] = j;
+    }
+    vector<unsigned int> cov_loci;
+    vector<unsigned int> cov_C;
+    vector<float> cov_S;
+    vector<float> cov_Q;
 
 	//==== Open output file ====
-	outfile = OUT_PREFIX;
-	outfile.append(".SeqPC.coord");
+	outfile = output_file_name(".SeqPC.coord");
 	fout.open(outfile.c_str());
 	if(fout.fail()){
 		cerr << "Error: cannot create a file named " << outfile << "." << endl;
@@ -1239,8 +1580,7 @@ int main(int argc, char* argv[]){
 	fout << "PC" << DIM << endl;
 
 	if(REPS>1){
-		outfile2 = outfile;
-		outfile2.append(".sd");
+		outfile2 = output_file_name(".SeqPC.coord.sd");
 		fout2.open(outfile2.c_str());
 		if(fout2.fail()){
 			cerr << "Error: cannot create a file named " << outfile2 << "." << endl;
@@ -1256,8 +1596,7 @@ int main(int argc, char* argv[]){
 		}
 		fout2 << "PC" << DIM << ".sd" << endl;
 		if(OUTPUT_REPS==1){
-			outfile3 = outfile;
-			outfile3.append(".reps");
+			outfile3 = output_file_name(".SeqPC.coord.reps");
 			fout3.open(outfile3.c_str());
 			if(fout3.fail()){
 				cerr << "Error: cannot create a file named " << outfile3 << "." << endl;
@@ -1286,291 +1625,205 @@ int main(int argc, char* argv[]){
 	if (DIM_HIGH == 0) {
 		AUTO_MODE = true;
 	}
+
+    // Samples are independent, so they are analyzed in batches: samples of a batch are read in input order, analyzed
+    // concurrently on NUM_THREADS threads, each with its own workspace and one-threaded BLAS, and output in input order.
+    // With more than one thread, every sample simulates reads with its own generator seeded by RANDOM_SEED and the index
+    // of the sample, so results don't depend on the number of threads. One thread uses one generator for all samples, as
+    // in the previous versions.
+    int sample_threads = max(NUM_THREADS, 1);
+    vector<SeqSample> batch(16 * sample_threads);
+    int n_batch = 0;
+    vector<unique_ptr<gsl_rng, void (*)(gsl_rng*)>> sample_rngs; // freed on every return
+    if (sample_threads > 1) {
+        openblas_set_num_threads(1);
+        for (j = 0; j < sample_threads; ++j) {
+            sample_rngs.emplace_back(gsl_rng_alloc(gsl_rng_taus), gsl_rng_free);
+        }
+    }
+    auto analyze_batch = [&]() {
+        #pragma omp parallel for num_threads(sample_threads) schedule(dynamic, 1)
+        for (int s = 0; s < n_batch; ++s) {
+            gsl_rng* sample_rng = rng;
+            if (sample_threads > 1) {
+                sample_rng = sample_rngs[omp_get_thread_num()].get();
+                gsl_rng_set(sample_rng, (unsigned long)RANDOM_SEED * 1000003ul + (unsigned long)batch[s].index);
+            }
+            analyze_sample(batch[s], RefG, refPC, sample_rng);
+        }
+        for (int s = 0; s < n_batch; ++s) {
+            write_sample(batch[s], fout, fout2, fout3);
+        }
+        n_batch = 0;
+    };
+
     i = row = 0;
-    while (seq_reader.read_row(tokens, '\t') >= 0) {
-        ++row;
-        if (row <= SEQ_NON_DATA_ROWS) { // Skip non-data rows
-            continue;
+    if (cached) { // rows of the binary cache have fixed size, so there is nothing to skip
+        i = FIRST_IND - 1;
+    } else if (sparse) {
+        sparse_reader.seek_sample(FIRST_IND - 1);
+        i = FIRST_IND - 1;
+    } else if ((FIRST_IND > 1) && seq_reader.seek_row(SEQ_NON_DATA_ROWS + FIRST_IND - 1)) { // jump to FIRST_IND using the row index
+        row = SEQ_NON_DATA_ROWS + FIRST_IND - 1;
+        i = FIRST_IND - 1;
+    }
+    while (cached ? (i < (int)seq_cache.get_n_samples()) :
+           (sparse ? sparse_reader.read_sample(sparse_population_id, sparse_individual_id, sparse_records) : (seq_reader.read_row(tokens, '\t', seq_selected) >= 0))) {
+        if (cached || sparse) {
+            ++i;
+            if (i > LAST_IND) {
+                break;
+            }
+        } else {
+            ++row;
+            if (row <= SEQ_NON_DATA_ROWS) { // Skip non-data rows
+                continue;
+            }
+            ++i;
+            if (i < FIRST_IND) {
+                continue;
+            }
+            if (i > LAST_IND) {
+                break;
+            }
         }
-        ++i;
-        if (i < FIRST_IND) {
-            continue;
+        string SeqInfo1 = cached ? seq_cache.get_population_id(i - 1) : (sparse ? sparse_population_id : string(tokens[0]));
+        string SeqInfo2 = cached ? seq_cache.get_individual_id(i - 1) : (sparse ? sparse_individual_id : string(tokens[1]));
+        double meanC = 0;
+        cov_loci.clear();
+        cov_C.clear();
+        cov_S.clear();
+        cov_Q.clear();
+        if (cached) { // values in the cache were checked when it was built
+            const uint16_t* coverage = seq_cache.get_coverage(i - 1);
+            const uint16_t* reads = seq_cache.get_reads(i - 1);
+            const uint8_t* quality = seq_cache.get_quality(i - 1);
+            for (k = 0; k < LOCI_in; ++k) {
+                if (coverage[seq_loci[k]] > 0) {
+                    cov_loci.push_back(k);
+                    cov_C.push_back(coverage[seq_loci[k]]);
+                    cov_S.push_back(reads[seq_loci[k]]);
+                    cov_Q.push_back(quality[seq_loci[k]]);
+                    meanC += coverage[seq_loci[k]];
+                }
+            }
         }
-        if (i > LAST_IND) {
-            break;
+        if (sparse) { // values were checked when the samples were counted
+            size_t n = 0u;
+            for (auto&& record : sparse_records) {
+                if ((record.coverage > 0u) && (seq_analyzed[record.locus] >= 0)) {
+                    record.locus = seq_analyzed[record.locus];
+                    sparse_records[n++] = record;
+                }
+            }
+            sparse_records.resize(n);
+            // records follow the SEQ_FILE loci, which may be ordered differently from the analyzed loci
+            auto by_locus = [](const SparseSeqReader::Record& a, const SparseSeqReader::Record& b) { return a.locus < b.locus; };
+            if (!is_sorted(sparse_records.begin(), sparse_records.end(), by_locus)) {
+                sort(sparse_records.begin(), sparse_records.end(), by_locus);
+            }
+            for (auto&& record : sparse_records) {
+                cov_loci.push_back(record.locus);
+                cov_C.push_back(record.coverage);
+                cov_S.push_back(record.reads);
+                cov_Q.push_back(record.quality);
+                meanC += record.coverage;
+            }
         }
-        string SeqInfo1 = tokens[0];
-        string SeqInfo2 = tokens[1];
-        urowvec tmpC(LOCI_S);    // Coverage of one sample
-        frowvec tmpS(LOCI_S);    // Sequence read of one sample
-        frowvec tmpQ(LOCI_S);    // Base quality of one sample
-        for(j = 0; j < LOCI_S; ++j) {
+        for(k = 0; !cached && !sparse && (k < LOCI_in); ++k) {
+            token = tokens[seq_fields[k]];
+            if ((token[0] == '0') && (token[1] == ' ') && (token[2] == '0') && (token[3] == ' ') && (token[4] == '0') && (token[5] == '\0')) {
+                continue; // uncovered locus, the most frequent field in low-coverage data
+            }
             end = nullptr;
-            token = tokens.at(SEQ_NON_DATA_COLS + j).c_str();
-            tmpC(j) = strtoul(token, &end, 10);
+            unsigned long c = strtoul(token, &end, 10);
             if ((*end != ' ') || (errno == ERANGE)) {
-                cerr << "Error: invalid value at locus "<< j + 1 << " of individual " << i << " in the SEQ_FILE." << endl;
-                foutLog << "Error: invalid value at locus "<< j + 1 << " of individual " << i << " in the SEQ_FILE." << endl;
+                analyze_batch();  // samples before this one are output as usual
+                cerr << "Error: invalid value at locus "<< seq_loci[k] + 1 << " of individual " << i << " in the SEQ_FILE." << endl;
+                foutLog << "Error: invalid value at locus "<< seq_loci[k] + 1 << " of individual " << i << " in the SEQ_FILE." << endl;
                 foutLog.close();
+                fout.close();
+                fout2.close();
+                fout3.close();
                 gsl_rng_free(rng);
                 return 1;
             }
             token = end;
-            tmpS(j) = strtof(token, &end);
-            if ((*end != ' ') || (errno == ERANGE) || (tmpS(j) < 0) || (tmpS(j) > tmpC(j))) {
-                cerr << "Error: invalid value at locus "<< j + 1 << " of individual " << i << " in the SEQ_FILE." << endl;
-                foutLog << "Error: invalid value at locus "<< j + 1 << " of individual " << i << " in the SEQ_FILE." << endl;
+            float s = strtof(token, &end);
+            if ((*end != ' ') || (errno == ERANGE) || (s < 0) || (s > c)) {
+                analyze_batch();  // samples before this one are output as usual
+                cerr << "Error: invalid value at locus "<< seq_loci[k] + 1 << " of individual " << i << " in the SEQ_FILE." << endl;
+                foutLog << "Error: invalid value at locus "<< seq_loci[k] + 1 << " of individual " << i << " in the SEQ_FILE." << endl;
                 foutLog.close();
+                fout.close();
+                fout2.close();
+                fout3.close();
                 gsl_rng_free(rng);
                 return 1;
             }
             token = end;
-            tmpQ(j) = strtof(token, &end);
-            if ((*end != '\0') || (errno == ERANGE) || (tmpQ(j) < 0)) {
-                cerr << "Error: invalid value at locus "<< j + 1 << " of individual " << i << " in the SEQ_FILE." << endl;
-                foutLog << "Error: invalid value at locus "<< j + 1 << " of individual " << i << " in the SEQ_FILE." << endl;
+            float q = strtof(token, &end);
+            if ((*end != '\0') || (errno == ERANGE) || (q < 0)) {
+                analyze_batch();  // samples before this one are output as usual
+                cerr << "Error: invalid value at locus "<< seq_loci[k] + 1 << " of individual " << i << " in the SEQ_FILE." << endl;
+                foutLog << "Error: invalid value at locus "<< seq_loci[k] + 1 << " of individual " << i << " in the SEQ_FILE." << endl;
                 foutLog.close();
+                fout.close();
+                fout2.close();
+                fout3.close();
                 gsl_rng_free(rng);
                 return 1;
             }
-        }
-
-        urowvec C(LOCI_in);    // Coverage of one sample
-        frowvec S(LOCI_in);    // Sequence read of one sample
-        frowvec Q(LOCI_in);    // Base quality of one sample
-        uvec LOC(LOCI_in);    // Indices of covered loci
-        double meanC = 0;
-        int Lcov = 0;     // Number of loci with nonzero coverage
-        k = 0;
-        for(j=0; j<LOCI; j++){
-            if(ExLoci(j)==0){
-                C(k) = tmpC(cmnS(j));
-                C(k) = tmpC(cmnS(j));
-                S(k) = tmpS(cmnS(j));
-                Q(k) = tmpQ(cmnS(j));
-                if(C(k)>0){
-                    LOC(Lcov) = k;
-                    Lcov++;
-                    meanC += C(k);
-                }
-                k++;
+            if (c > 0) {
+                cov_loci.push_back(k);
+                cov_C.push_back(c);
+                cov_S.push_back(s);
+                cov_Q.push_back(q);
+                meanC += c;
             }
         }
-        tmpC.clear();
-        tmpS.clear();
-        tmpQ.clear();
-        LOC.resize(Lcov);
+        int Lcov = cov_loci.size();     // Number of loci with nonzero coverage
         meanC = meanC/LOCI_in;
 
-        uvec Loc;
+        SeqSample &sample = batch[n_batch++];
+        uvec idx;
         int Linc;    // Number of loci to include in the computation of PCA
+        sample.log.clear();
         if(Lcov>MAX_LOCI){  // Randomly excluding loci if Lcov >  MAX_LOCI
             Linc = MAX_LOCI;
             vec v = randu<vec>(Lcov);
-            uvec idx = sort_index(v);
+            idx = sort_index(v);
             idx.resize(MAX_LOCI);
             idx = sort(idx, "ascend");
-            Loc = LOC(idx);
-            cout << "Randomly select " << Linc << " out of " << Lcov << " covered loci for " << SeqInfo1 << ":" << SeqInfo2 << "." << endl;
-            foutLog << "Randomly select " << Linc << " out of " << Lcov << " covered loci for " << SeqInfo1 << ":" << SeqInfo2 << "." << endl;
+            sample.log.append("Randomly select " + to_string(Linc) + " out of " + to_string(Lcov) + " covered loci for " + SeqInfo1 + ":" + SeqInfo2 + ".\n");
         }else{
             Linc = Lcov;
-            Loc = LOC;
         }
-        LOC.clear();
-        urowvec Cc(Linc);
-        frowvec Sc(Linc);
-        frowvec Qc(Linc);
+        sample.index = i;
+        sample.popID = SeqInfo1;
+        sample.indivID = SeqInfo2;
+        sample.Lcov = Lcov;
+        sample.meanC = meanC;
+        sample.Loc.set_size(Linc);
+        sample.Cc.set_size(Linc);
+        sample.Sc.set_size(Linc);
+        sample.Qc.set_size(Linc);
         for(j=0; j<Linc; j++){
-            Cc(j) = C(Loc(j));
-            Sc(j) = S(Loc(j));
-            Qc(j) = Q(Loc(j));
-        }
-        C.clear();
-        S.clear();
-        Q.clear();
-
-        if(Linc >= MIN_LOCI){
-            double t_m1 = 0;
-            double t_m2 = 0;
-            double Z_m1 = 0;
-            double Z_m2 = 0;
-            double dim_high = 0;
-            rowvec rotPC_m1 = zeros<rowvec>(DIM);
-            rowvec rotPC_m2 = zeros<rowvec>(DIM);
-            for(int rep=0; rep<REPS; rep++){
-                //=================== Simulate sequence reads ======================
-                fmat SS(REF_SIZE, Linc);
-                if(SEQ_ERR != -1){
-                    simuseq(RefG, Cc, Loc, SEQ_ERR, SS, rng);
-                }else{
-                    simuseq2(RefG, Cc, Loc, Qc, SS, rng);
-                }
-                SS.insert_rows(REF_SIZE, Sc);
-                //=================== Perform PCA =================================
-                fmat SSm;
-                fmat SSsd;
-                normalize(SS, SSm, SSsd);
-                mat M = conv_to<mat>::from(SS*SS.t());
-                vec eigval;
-                mat eigvec;
-                eig_sym(eigval, eigvec, M, "dc");	// use "divide & conquer" algorithm
-                //M.clear();
-                SS.clear();
-                if(AUTO_MODE){
-                    // ####    Calculate Tracy-Widom Statistics and determine DIM_HIGH  ####
-                    // Calculation of TW statistic follows Patterson et al 2006 PLoS Genetics
-                    DIM_HIGH = 0;
-                    double eigsum = 0;
-                    double eig2sum = 0;
-                    double eigsum2 = 0;
-                    for(j=0; j<REF_SIZE; j++){     // The length of eigval is REF_SIZE+1;
-                        eigsum += eigval(j+1);
-                        eig2sum += pow(eigval(j+1), 2);
-                    }
-                    for(j=0; j<REF_SIZE; j++){
-                        int m = REF_SIZE-j;
-                        if(j>0){
-                            eigsum -= eigval(m+1);
-                            eig2sum -= pow(eigval(m+1),2);
-                        }
-                        eigsum2 = eigsum*eigsum;
-                        double n = (m+1)*eigsum2/((m-1)*eig2sum-eigsum2);
-                        double nsqrt = sqrt(n-1);
-                        double msqrt = sqrt(m);
-                        double mu = pow(nsqrt+msqrt, 2)/n;
-                        double sigma = (nsqrt+msqrt)/n*pow(1/nsqrt+1/msqrt, 1.0/3);
-                        double x = (m*eigval(m)/eigsum-mu)/sigma;  // Tracy-Widom statistic
-                        if(x>TW){           // TW is the threshold for the Tracy-Widom statisic
-                            DIM_HIGH++;
-                        }else{
-                            break;
-                        }
-                    }
-                    if(DIM_HIGH<DIM){
-                        DIM_HIGH = DIM;
-                        cout << "Warning: DIM is greater than the number of significant PCs for study sample " << i << "." << endl;
-                        foutLog << "Warning: DIM is greater than the number of significant PCs for study sample " << i << "." << endl;
-                    }
-                }
-                mat simuPC(REF_SIZE, DIM_HIGH);
-                rowvec PC_one = zeros<rowvec>(DIM_HIGH);
-                for(j=0; j<DIM_HIGH; j++){
-                    for(k=0; k<REF_SIZE; k++){
-                        simuPC(k,j) = eigvec(k, REF_SIZE-j)*sqrt(eigval(REF_SIZE-j));
-                    }
-                    PC_one(j) = eigvec(REF_SIZE, REF_SIZE-j)*sqrt(eigval(REF_SIZE-j));
-                }
-
-                //=================  Procrustes Analysis =======================
-                mat simuPC_rot(REF_SIZE, DIM_HIGH);
-                double t;
-                double rho;
-                mat A(DIM_HIGH, DIM_HIGH);
-                rowvec b(DIM_HIGH);
-                double epsilon = pprocrustes(simuPC, refPC, simuPC_rot, t, rho, A, b, MAX_ITER, THRESHOLD, PROCRUSTES_SCALE);
-                if(epsilon>THRESHOLD){
-                    cout << "Warning: Projection Procrustes analysis doesn't converge in " << MAX_ITER << " iterations for " << SeqInfo2 <<", epsilon=" << epsilon << "." << endl;
-                    foutLog << "Warning: Projection Procrustes analysis doesn't converge in " << MAX_ITER << " iterations for " << SeqInfo2 <<", epsilon=" << epsilon << "." << endl;
-                }
-                simuPC.clear();
-                simuPC_rot.clear();
-                rowvec rotPC_one = rho*PC_one*A+b;
-                if(DIM_HIGH > DIM){
-                    rotPC_one.shed_cols(DIM, DIM_HIGH-1);
-                }
-
-                //== Calculating Z score to indicate if an individual's ancestry is represented in the reference ==
-                vec d1 = zeros<vec>(REF_SIZE);
-                for(j=0; j<REF_SIZE; j++){
-                    rowvec v = rotPC_one-refPC.row(j);
-                    for(k=0; k<DIM; k++) d1(j) += v(k)*v(k);
-                }
-                uvec idx = sort_index(d1);
-                vec Mk = zeros<vec>(KNN_ZSCORE);
-                for(j=0; j<KNN_ZSCORE; j++) Mk(j) = M(idx(j),idx(j));
-                double Z = (M(REF_SIZE,REF_SIZE)-mean(Mk))/stddev(Mk);
-
-                //================= Output Procrustes Results for one repated run ===================
-                if(REPS == 1){
-                    fout << SeqInfo1 << "\t" << SeqInfo2 << "\t" << Lcov << "\t" << meanC << "\t" << DIM_HIGH << "\t" << t << "\t" << Z << "\t";
-                    for(j=0; j<DIM-1; j++){ fout << rotPC_one(j) << "\t"; }
-                    fout << rotPC_one(DIM-1) << endl;
-                }else if(REPS > 1){
-                    if(OUTPUT_REPS == 1){
-                        fout3 << SeqInfo1 << "\t" << SeqInfo2 << "\t" << Lcov << "\t" << meanC << "\t" << DIM_HIGH << "\t" << t << "\t" << Z << "\t";
-                        for(j=0; j<DIM-1; j++){ fout3 << rotPC_one(j) << "\t"; }
-                        fout3 << rotPC_one(DIM-1) << endl;
-                    }
-                    t_m1 += t;
-                    t_m2 += pow(t,2);
-                    Z_m1 += Z;
-                    Z_m2 += pow(Z,2);
-                    rotPC_m1 = rotPC_m1 + rotPC_one;
-                    rotPC_m2 = rotPC_m2 + rotPC_one%rotPC_one;
-                    dim_high = dim_high + DIM_HIGH;
-                }
-            }
-            Cc.clear();
-            Sc.clear();
-            Qc.clear();
-            Loc.clear();
-            //================= Output Procrustes Results ===================
-            if(REPS>1){
-                // calculate mean and sd
-                double t_mean = t_m1/REPS;
-                double t_sd = sqrt((t_m2-REPS*pow(t_mean,2))/(REPS-1));
-                double Z_mean = Z_m1/REPS;
-                double Z_sd = sqrt((Z_m2-REPS*pow(Z_mean,2))/(REPS-1));
-                dim_high = dim_high/REPS;
-                rowvec rotPC_mean = rotPC_m1/REPS;
-                rowvec rotPC_sd = sqrt((rotPC_m2-REPS*rotPC_mean%rotPC_mean)/(REPS-1));
-                // output mean values of results
-                fout << SeqInfo1 << "\t" << SeqInfo2 << "\t" << Lcov << "\t" << meanC << "\t" << dim_high << "\t" << t_mean << "\t" << Z_mean << "\t";
-                for(j=0; j<DIM-1; j++){
-                    fout << rotPC_mean(j) << "\t";
-                }
-                fout << rotPC_mean(DIM-1) << endl;
-                // output sd values of results
-                fout2 << SeqInfo1 << "\t" << SeqInfo2 << "\t" << t_sd << "\t" << Z_sd << "\t";
-                for(j=0; j<DIM-1; j++){
-                    fout2 << rotPC_sd(j) << "\t";
-                }
-                fout2 << rotPC_sd(DIM-1) << endl;
-                // declare vectors
-                rotPC_mean.clear();
-                rotPC_sd.clear();
-            }
-            rotPC_m1.clear();
-            rotPC_m2.clear();
-        }else{
-            //Too few number of loci covered. Skip computation and output "NA".
-            cout << "Warning: skipping sample "<< SeqInfo2 << " (# covered loci < MIN_LOCI)." << endl;
-            foutLog << "Warning: skipping sample "<< SeqInfo2 << " (# covered loci < MIN_LOCI)." << endl;
-            fout << SeqInfo1 << "\t" << SeqInfo2 << "\t" << Lcov << "\t" << meanC << "\t" << "NA" << "\t" << "NA" << "\t" << "NA" << "\t";
-            for(j=0; j<DIM-1; j++){
-                fout << "NA" << "\t";
-            }
-            fout << "NA" << endl;
-            if(REPS>1){
-                fout2 << SeqInfo1 << "\t" << SeqInfo2 << "\t" << "NA" << "\t";
-                for(j=0; j<DIM-1; j++){ fout2 << "NA" << "\t"; }
-                fout2 << "NA" << endl;
-                if(OUTPUT_REPS==1){
-                    for(int rep=0; rep<REPS; rep++){
-                        fout3 << SeqInfo1 << "\t" << SeqInfo2 << "\t" << Lcov << "\t" << meanC << "\t" << "NA" << "\t" << "NA" << "\t" << "NA" << "\t";
-                        for(j=0; j<DIM-1; j++){ fout3 << "NA" << "\t"; }
-                        fout3 << "NA" << endl;
-                    }
-                }
-            }
+            unsigned int r = (Lcov > MAX_LOCI) ? idx(j) : j;
+            sample.Loc(j) = cov_loci[r];
+            sample.Cc(j) = cov_C[r];
+            sample.Sc(j) = cov_S[r];
+            sample.Qc(j) = cov_Q[r];
         }
-        if(i%50==0){
-            cout << "Progress: finish analysis of individual " << i << "." << endl;
-            foutLog << "Progress: finish analysis of individual " << i << "." << endl;
+        if (n_batch == (int)batch.size()) {
+            analyze_batch();
         }
 	}
+	analyze_batch();
+	sample_rngs.clear();
     seq_reader.close();
+    seq_cache.close();
+    sparse_reader.close();
 	fout.close();
 	if (REPS > 1) {
 		fout2.close();
@@ -1635,6 +1888,8 @@ bool parse_cmd_line(int argc, char* argv[], map<string,string> &args, map<string
 	argi[ARG_PROCRUSTES_SCALE] = default_int;
 	argi[ARG_RANDOM_SEED] = default_int;
 	argi[ARG_NUM_THREADS] = default_int;
+	argi[ARG_COMPRESS_OUTPUT] = default_int;
+	args[ARG_REF_SNAPSHOT] = default_str;
 	argi[ARG_KNN_ZSCORE] = default_int;
 	
 	for(int i = 1; i < argc-1; i++){
@@ -1802,50 +2057,25 @@ int normalize(fmat &G, fmat &Gm, fmat &Gsd){
 	return 1;
 }
 //#########################     PCA      ##########################
-int pca(fmat G, int nPCs, mat &PC, rowvec &PCvar, mat &M){
+// The GRM is accumulated over blocks of PCA_BLOCK_LOCI loci, so besides the N x N matrix only one block is in memory.
+// get_block(a, b, Gb) sets Gb to the genotypes of loci a..b (N x (b-a+1), -9 if missing). Every locus is normalized on its
+// own, so the result is the same as for the whole genotype matrix.
+int pca(int N, int L, const function<void(int, int, fmat&)> &get_block, int nPCs, mat &PC, rowvec &PCvar, mat &M){
 	int i=0;
 	int j=0;
-	int N = G.n_rows;
-	int L = G.n_cols;
-	// Use eigen decomposition to get PCA results
-	fmat Gm(L,1);
-	fmat Gsd(L,1);
-	//time_t rawtime;
-  	//struct tm * timeinfo;
-	//time ( &rawtime );
- 	//timeinfo = localtime ( &rawtime );
-	//cout << "start normalization at: " << asctime (timeinfo);
-	normalize(G, Gm, Gsd);
-	//time ( &rawtime );
- 	//timeinfo = localtime ( &rawtime );
-	//cout << "end normalization at: " << asctime (timeinfo);
-	//======================
-	M = conv_to<mat>::from(G*G.t());
-	Gm.clear();
-	Gsd.clear();
-	//time ( &rawtime );
- 	//timeinfo = localtime ( &rawtime );
-	//cout << "get GRM at: " << asctime (timeinfo);
-	
-	//======== testing multi-threading =========
-	/*int Lb = 10000; // Every 10000 SNPs as a block
-	int Nb = int((L-0.5)/Lb)+1; // Number of blocks
 	fmat Mb = zeros<fmat>(N,N);
-	#pragma omp parallel for reduction(+:Mb)
-	for(i=0; i<Nb; i++){
-		cout << i << endl;
-		int a = i*Lb;
-		int b = a+Lb-1;
-		if(b>L-1) b = L-1;
-		fmat Gb = G.cols(a,b);  
-		fmat Gm;
-		fmat Gsd;
+	fmat Gb;
+	fmat Gm;
+	fmat Gsd;
+	for(int a=0; a<L; a+=PCA_BLOCK_LOCI){
+		int b = min(a+PCA_BLOCK_LOCI, L)-1;
+		get_block(a, b, Gb);
 		normalize(Gb, Gm, Gsd);
 		Mb += Gb*Gb.t();
 	}
 	M = conv_to<mat>::from(Mb);
-	Mb.clear();*/
-	//==========================================
+	Mb.clear();
+	Gb.clear();
 	vec eigval;
 	mat eigvec;
 	bool bflag = eig_sym(eigval, eigvec, M, "dc");	// use "divide & conquer" algorithm	
@@ -1911,6 +2141,202 @@ int pca_svd(fmat G, int nPCs, mat &PC, rowvec &PCvar, fmat &Gm, fmat &Gsd, fmat
 	}
 	return 1;	
 }
+//################### Analysis of one study sample ##########################
+void analyze_sample(SeqSample &sample, Mat<char> &RefG, mat &refPC, gsl_rng *rng){
+	// This function simulates the sequence reads of the sample for the reference individuals REPS times and places
+	// the sample in the reference PCA space by the Procrustes analysis. It only changes the sample, so samples can be
+	// analyzed concurrently with different generators.
+	int j = 0;
+	int k = 0;
+	int Linc = sample.Loc.n_elem;
+	sample.K.clear();
+	sample.t.clear();
+	sample.Z.clear();
+	sample.rotPC.clear();
+	if(Linc < MIN_LOCI){
+		return;
+	}
+	for(int rep=0; rep<REPS; rep++){
+		//=================== Simulate sequence reads ======================
+		fmat SS(REF_SIZE, Linc);
+		if(SEQ_ERR != -1){
+			simuseq(RefG, sample.Cc, sample.Loc, SEQ_ERR, SS, rng);
+		}else{
+			simuseq2(RefG, sample.Cc, sample.Loc, sample.Qc, SS, rng);
+		}
+		SS.insert_rows(REF_SIZE, sample.Sc);
+		//=================== Perform PCA =================================
+		fmat SSm;
+		fmat SSsd;
+		normalize(SS, SSm, SSsd);
+		mat M = conv_to<mat>::from(SS*SS.t());
+		vec eigval;
+		mat eigvec;
+		eig_sym(eigval, eigvec, M, "dc");	// use "divide & conquer" algorithm
+		SS.clear();
+		int dim_high = DIM_HIGH;
+		if(AUTO_MODE){
+			// ####    Calculate Tracy-Widom Statistics and determine DIM_HIGH  ####
+			// Calculation of TW statistic follows Patterson et al 2006 PLoS Genetics
+			dim_high = 0;
+			double eigsum = 0;
+			double eig2sum = 0;
+			double eigsum2 = 0;
+			for(j=0; j<REF_SIZE; j++){     // The length of eigval is REF_SIZE+1;
+				eigsum += eigval(j+1);
+				eig2sum += pow(eigval(j+1), 2);
+			}
+			for(j=0; j<REF_SIZE; j++){
+				int m = REF_SIZE-j;
+				if(j>0){
+					eigsum -= eigval(m+1);
+					eig2sum -= pow(eigval(m+1),2);
+				}
+				eigsum2 = eigsum*eigsum;
+				double n = (m+1)*eigsum2/((m-1)*eig2sum-eigsum2);
+				double nsqrt = sqrt(n-1);
+				double msqrt = sqrt(m);
+				double mu = pow(nsqrt+msqrt, 2)/n;
+				double sigma = (nsqrt+msqrt)/n*pow(1/nsqrt+1/msqrt, 1.0/3);
+				double x = (m*eigval(m)/eigsum-mu)/sigma;  // Tracy-Widom statistic
+				if(x>TW){           // TW is the threshold for the Tracy-Widom statisic
+					dim_high++;
+				}else{
+					break;
+				}
+			}
+			if(dim_high<DIM){
+				dim_high = DIM;
+				sample.log.append("Warning: DIM is greater than the number of significant PCs for study sample " + to_string(sample.index) + ".\n");
+			}
+		}
+		mat simuPC(REF_SIZE, dim_high);
+		rowvec PC_one = zeros<rowvec>(dim_high);
+		for(j=0; j<dim_high; j++){
+			for(k=0; k<REF_SIZE; k++){
+				simuPC(k,j) = eigvec(k, REF_SIZE-j)*sqrt(eigval(REF_SIZE-j));
+			}
+			PC_one(j) = eigvec(REF_SIZE, REF_SIZE-j)*sqrt(eigval(REF_SIZE-j));
+		}
+
+		//=================  Procrustes Analysis =======================
+		mat simuPC_rot(REF_SIZE, dim_high);
+		double t;
+		double rho;
+		mat A(dim_high, dim_high);
+		rowvec b(dim_high);
+		double epsilon = pprocrustes(simuPC, refPC, simuPC_rot, t, rho, A, b, MAX_ITER, THRESHOLD, PROCRUSTES_SCALE);
+		if(epsilon>THRESHOLD){
+			ostringstream warning;
+			warning << "Warning: Projection Procrustes analysis doesn't converge in " << MAX_ITER << " iterations for " << sample.indivID <<", epsilon=" << epsilon << "." << endl;
+			sample.log.append(warning.str());
+		}
+		simuPC.clear();
+		simuPC_rot.clear();
+		rowvec rotPC_one = rho*PC_one*A+b;
+		if(dim_high > DIM){
+			rotPC_one.shed_cols(DIM, dim_high-1);
+		}
+
+		//== Calculating Z score to indicate if an individual's ancestry is represented in the reference ==
+		vec d1 = zeros<vec>(REF_SIZE);
+		for(j=0; j<REF_SIZE; j++){
+			rowvec v = rotPC_one-refPC.row(j);
+			for(k=0; k<DIM; k++) d1(j) += v(k)*v(k);
+		}
+		uvec idx = sort_index(d1);
+		vec Mk = zeros<vec>(KNN_ZSCORE);
+		for(j=0; j<KNN_ZSCORE; j++) Mk(j) = M(idx(j),idx(j));
+		double Z = (M(REF_SIZE,REF_SIZE)-mean(Mk))/stddev(Mk);
+
+		sample.K.push_back(dim_high);
+		sample.t.push_back(t);
+		sample.Z.push_back(Z);
+		sample.rotPC.push_back(rotPC_one);
+	}
+}
+//################### Output of one study sample ##########################
+void write_sample(const SeqSample &sample, OutputWriter &fout, OutputWriter &fout2, OutputWriter &fout3){
+	int j = 0;
+	cout << sample.log;
+	foutLog << sample.log;
+	if(!sample.K.empty()){
+		//================= Output Procrustes Results for one repated run ===================
+		if(REPS == 1){
+			fout << sample.popID << "\t" << sample.indivID << "\t" << sample.Lcov << "\t" << sample.meanC << "\t" << sample.K[0] << "\t" << sample.t[0] << "\t" << sample.Z[0] << "\t";
+			for(j=0; j<DIM-1; j++){ fout << sample.rotPC[0](j) << "\t"; }
+			fout << sample.rotPC[0](DIM-1) << endl;
+		}else if(REPS > 1){
+			double t_m1 = 0;
+			double t_m2 = 0;
+			double Z_m1 = 0;
+			double Z_m2 = 0;
+			double dim_high = 0;
+			rowvec rotPC_m1 = zeros<rowvec>(DIM);
+			rowvec rotPC_m2 = zeros<rowvec>(DIM);
+			for(int rep=0; rep<REPS; rep++){
+				if(OUTPUT_REPS == 1){
+					fout3 << sample.popID << "\t" << sample.indivID << "\t" << sample.Lcov << "\t" << sample.meanC << "\t" << sample.K[rep] << "\t" << sample.t[rep] << "\t" << sample.Z[rep] << "\t";
+					for(j=0; j<DIM-1; j++){ fout3 << sample.rotPC[rep](j) << "\t"; }
+					fout3 << sample.rotPC[rep](DIM-1) << endl;
+				}
+				t_m1 += sample.t[rep];
+				t_m2 += pow(sample.t[rep],2);
+				Z_m1 += sample.Z[rep];
+				Z_m2 += pow(sample.Z[rep],2);
+				rotPC_m1 = rotPC_m1 + sample.rotPC[rep];
+				rotPC_m2 = rotPC_m2 + sample.rotPC[rep]%sample.rotPC[rep];
+				dim_high = dim_high + sample.K[rep];
+			}
+			//================= Output Procrustes Results ===================
+			// calculate mean and sd
+			double t_mean = t_m1/REPS;
+			double t_sd = sqrt((t_m2-REPS*pow(t_mean,2))/(REPS-1));
+			double Z_mean = Z_m1/REPS;
+			double Z_sd = sqrt((Z_m2-REPS*pow(Z_mean,2))/(REPS-1));
+			dim_high = dim_high/REPS;
+			rowvec rotPC_mean = rotPC_m1/REPS;
+			rowvec rotPC_sd = sqrt((rotPC_m2-REPS*rotPC_mean%rotPC_mean)/(REPS-1));
+			// output mean values of results
+			fout << sample.popID << "\t" << sample.indivID << "\t" << sample.Lcov << "\t" << sample.meanC << "\t" << dim_high << "\t" << t_mean << "\t" << Z_mean << "\t";
+			for(j=0; j<DIM-1; j++){
+				fout << rotPC_mean(j) << "\t";
+			}
+			fout << rotPC_mean(DIM-1) << endl;
+			// output sd values of results
+			fout2 << sample.popID << "\t" << sample.indivID << "\t" << t_sd << "\t" << Z_sd << "\t";
+			for(j=0; j<DIM-1; j++){
+				fout2 << rotPC_sd(j) << "\t";
+			}
+			fout2 << rotPC_sd(DIM-1) << endl;
+		}
+	}else{
+		//Too few number of loci covered. Skip computation and output "NA".
+		cout << "Warning: skipping sample "<< sample.indivID << " (# covered loci < MIN_LOCI)." << endl;
+		foutLog << "Warning: skipping sample "<< sample.indivID << " (# covered loci < MIN_LOCI)." << endl;
+		fout << sample.popID << "\t" << sample.indivID << "\t" << sample.Lcov << "\t" << sample.meanC << "\t" << "NA" << "\t" << "NA" << "\t" << "NA" << "\t";
+		for(j=0; j<DIM-1; j++){
+			fout << "NA" << "\t";
+		}
+		fout << "NA" << endl;
+		if(REPS>1){
+			fout2 << sample.popID << "\t" << sample.indivID << "\t" << "NA" << "\t";
+			for(j=0; j<DIM-1; j++){ fout2 << "NA" << "\t"; }
+			fout2 << "NA" << endl;
+			if(OUTPUT_REPS==1){
+				for(int rep=0; rep<REPS; rep++){
+					fout3 << sample.popID << "\t" << sample.indivID << "\t" << sample.Lcov << "\t" << sample.meanC << "\t" << "NA" << "\t" << "NA" << "\t" << "NA" << "\t";
+					for(j=0; j<DIM-1; j++){ fout3 << "NA" << "\t"; }
+					fout3 << "NA" << endl;
+				}
+			}
+		}
+	}
+	if(sample.index%50==0){
+		cout << "Progress: finish analysis of individual " << sample.index << "." << endl;
+		foutLog << "Progress: finish analysis of individual " << sample.index << "." << endl;
+	}
+}
 //################### Simulate sequence reads from genotypes ##########################
 int simuseq(Mat<char> &G, urowvec &C, uvec &Loc, double e, fmat &S, gsl_rng *rng){
 	// This function simulates sequence reads S from genotypes G
@@ -1971,28 +2397,88 @@ int simuseq2(Mat<char> &G, urowvec &C, uvec &Loc, frowvec &Q, fmat &S, gsl_rng *
 }
 
 //################### Check the average coverage per sample and per locus ####################
-int check_coverage(int output, int first_ind, int last_ind, uvec cmnS, urowvec &ExLoci, int &Ls, int &Lg) {
+// Adds coverage of one individual to the per-locus totals; called for every row while reading dimensions of the SEQ_FILE.
+// If the SEQ_FILE is a list, tokens are the row of one file, whose first data column is first_column of the combined row.
+void add_coverage(int ind, const vector<char*> &tokens, size_t first_column, vec &C_loc, vec &Ncov, string &message) {
+	char* end = nullptr;
+	const char* token = nullptr;
+	double C;       // Coverage
+	double S;       // Sequence read
+	double Q;       // Base quality
+	bool valid = true;
+	int first = (int)first_column - SEQ_NON_DATA_COLS;
+	int n_loci = (int)tokens.size() - SEQ_NON_DATA_COLS;
+
+	if ((message.length() > 0) || (ind < ((FIRST_IND == default_int) ? 1 : FIRST_IND)) || ((LAST_IND != default_int) && (ind > LAST_IND))) {
+		return;
+	}
+	if ((n_loci < 0) || (first + n_loci > LOCI_S)) { // reported when checking dimensions of the SEQ_FILE
+		return;
+	}
+	for (int j = first; j < first + n_loci; ++j) {
+		errno = 0;
+		token = tokens[SEQ_NON_DATA_COLS + j - first];
+		C = strtod(token, &end);
+		valid = (*end == ' ') && (errno != ERANGE);
+		if (valid) {
+			token = end;
+			S = strtod(token, &end);
+			valid = (*end == ' ') && (errno != ERANGE) && (S >= 0) && (S <= C);
+		}
+		if (valid) {
+			token = end;
+			Q = strtod(token, &end);
+			valid = (*end == '\0') && (errno != ERANGE) && (Q >= 0);
+		}
+		if (!valid) {
+			message = "Error: invalid value at locus " + to_string(j + 1) + " of individual " + to_string(ind) + " in the SEQ_FILE.";
+			return;
+		}
+		if (C > 0) {
+			Ncov(j)++;
+			C_loc(j) += C;
+		}
+	}
+}
+
+// Same as above for a row of the binary cache of the SEQ_FILE.
+void add_coverage(int ind, const uint16_t *coverage, vec &C_loc, vec &Ncov) {
+	if ((ind < ((FIRST_IND == default_int) ? 1 : FIRST_IND)) || ((LAST_IND != default_int) && (ind > LAST_IND))) {
+		return;
+	}
+	for (int j = 0; j < LOCI_S; ++j) {
+		if (coverage[j] > 0) {
+			Ncov(j)++;
+			C_loc(j) += coverage[j];
+		}
+	}
+}
+
+// Same as above for the covered loci of one individual in a sparse SEQ_FILE.
+void add_coverage(int ind, const vector<SparseSeqReader::Record> &records, vec &C_loc, vec &Ncov) {
+	if ((ind < ((FIRST_IND == default_int) ? 1 : FIRST_IND)) || ((LAST_IND != default_int) && (ind > LAST_IND))) {
+		return;
+	}
+	for (auto&& record : records) {
+		if (record.coverage > 0) {
+			Ncov(record.locus)++;
+			C_loc(record.locus) += record.coverage;
+		}
+	}
+}
+
+int check_coverage(int output, int first_ind, int last_ind, uvec cmnS, urowvec &ExLoci, const vec &C_loc_all, const vec &Ncov_all, const string &message, const SiteTable &seq_sites, int &Ls, int &Lg) {
 	int row = 0, i = 0, j = 0, k = 0;
 	string str;
-	ofstream fout;
+	OutputWriter fout;
 
-	TableReader reader;
-	vector<string> tokens;
-    char* end = nullptr;
-    const char* token = nullptr;
+	MultiTableReader reader(SEQ_NON_DATA_COLS);
+	vector<char*> tokens;
 
-    reader.set_file_name(SEQ_FILE);
-    reader.open();
-
-	string outfile = OUT_PREFIX;
-	outfile.append(".ind.cov");	
-	if (output > 0) {
-		fout.open(outfile.c_str());
-		if (fout.fail()) {
-			cerr << "Error: cannot create a file named " << outfile << "." << endl;
-			return 0;
-		}
-		fout << "popID" << "\t" << "indivID" << "\t" << "L1" << "\t"  << "Ci" << endl;
+	if (message.length() > 0) {
+		cerr << message << endl;
+		foutLog << message << endl;
+		return 0;
 	}
 
 	int L = LOCI - sum(ExLoci);
@@ -2013,74 +2499,99 @@ int check_coverage(int output, int first_ind, int last_ind, uvec cmnS, urowvec &
 			++k;
 		}
 	}
+	for (j = 0; j < L; ++j) { // totals were accumulated over all loci while reading the SEQ_FILE
+		C_loc(j) = C_loc_all(idx(j));
+		Ncov(j) = Ncov_all(idx(j));
+	}
 
-    i = row = 0;
-    while (reader.read_row(tokens, '\t') >= 0) {
-        ++row;
-        if (row <= SEQ_NON_DATA_ROWS) { // Skip non-data rows
-            continue;
-        }
-        ++i;
-        if (i < FIRST_IND) {
-            continue;
-        }
-        if (i > LAST_IND) {
-            break;
-        }
-		vec C(LOCI_S);  // Coverage of one sample
-		double S;       // Sequence read
-		double Q;       // Base quality
-		int Lcov = 0;      // number of markers with non-zero coverage
-		double C_ind = 0;  // average coverage per sample
-		string SeqInfo1 = tokens[0];
-        string SeqInfo2 = tokens[1];
-        for(j = 0; j < LOCI_S; ++j) {
-            end = nullptr;
-            token = tokens.at(SEQ_NON_DATA_COLS + j).c_str();
-            C(j) = strtod(token, &end);
-            if ((*end != ' ') || (errno == ERANGE)) {
-                cerr << "Error: invalid value at locus "<< j + 1 << " of individual " << i << " in the SEQ_FILE." << endl;
-                foutLog << "Error: invalid value at locus "<< j + 1 << " of individual " << i << " in the SEQ_FILE." << endl;
-                return 1;
-            }
-            token = end;
-            S = strtod(token, &end);
-            if ((*end != ' ') || (errno == ERANGE) || (S < 0) || (S > C(j))) {
-                cerr << "Error: invalid value at locus "<< j + 1 << " of individual " << i << " in the SEQ_FILE." << endl;
-                foutLog << "Error: invalid value at locus "<< j + 1 << " of individual " << i << " in the SEQ_FILE." << endl;
-                return 1;
-            }
-            token = end;
-            Q = strtod(token, &end);
-            if ((*end != '\0') || (errno == ERANGE) || (Q < 0)) {
-                cerr << "Error: invalid value at locus "<< j + 1 << " of individual " << i << " in the SEQ_FILE." << endl;
-                foutLog << "Error: invalid value at locus "<< j + 1 << " of individual " << i << " in the SEQ_FILE." << endl;
-                return 1;
-            }
-        }
-        for (j = 0; j < L; ++j) {
-            if (C(idx(j)) > 0 ){
-                ++Lcov;
-                C_ind += C(idx(j));
-                Ncov(j)++;
-                C_loc(j) += C(idx(j));
+	// Coverage per individual depends on the loci left after exclusions, so it needs one more pass over the SEQ_FILE.
+	string outfile = output_file_name(".ind.cov");
+	if (output > 0) {
+		fout.open(outfile.c_str());
+		if (fout.fail()) {
+			cerr << "Error: cannot create a file named " << outfile << "." << endl;
+			return 0;
+		}
+		fout << "popID" << "\t" << "indivID" << "\t" << "L1" << "\t"  << "Ci" << endl;
+
+		SparseSeqReader sparse_reader;
+		string population_id, individual_id;
+		vector<SparseSeqReader::Record> records;
+		bool sparse = SparseSeqReader::can_read(SEQ_FILE);
+		SeqCacheReader cache;
+		bool cached = !sparse && cache.open(SEQ_FILE) && (cache.get_n_loci() == LOCI_S);
+		vector<bool> selected(SEQ_NON_DATA_COLS + LOCI_S, false); // ID columns and loci in idx, which is sorted
+		fill(selected.begin(), selected.begin() + SEQ_NON_DATA_COLS, true);
+		for (j = 0; j < L; ++j) {
+			selected[SEQ_NON_DATA_COLS + idx(j)] = true;
+		}
+		if (sparse) {
+			open_sparse_seq(sparse_reader, seq_sites);
+		} else if (!cached) {
+			reader.set_file_name(SEQ_FILE);
+			reader.open();
+		}
+		i = row = 0;
+		if (cached) {
+			i = FIRST_IND - 1;
+		} else if (sparse) {
+			sparse_reader.seek_sample(FIRST_IND - 1);
+			i = FIRST_IND - 1;
+		} else if ((FIRST_IND > 1) && reader.seek_row(SEQ_NON_DATA_ROWS + FIRST_IND - 1)) { // jump to FIRST_IND using the row index
+			row = SEQ_NON_DATA_ROWS + FIRST_IND - 1;
+			i = FIRST_IND - 1;
+		}
+		while (cached ? (i < (int)cache.get_n_samples()) :
+		       (sparse ? sparse_reader.read_sample(population_id, individual_id, records) : (reader.read_row(tokens, '\t', selected) >= 0))) {
+			if (!cached && !sparse) {
+				++row;
+				if (row <= SEQ_NON_DATA_ROWS) { // Skip non-data rows
+					continue;
+				}
+			}
+			++i;
+			if (i < FIRST_IND) {
+				continue;
+			}
+			if (i > LAST_IND) {
+				break;
+			}
+			const uint16_t* coverage = cached ? cache.get_coverage(i - 1) : nullptr;
+			double C;          // Coverage at one locus
+			int Lcov = 0;      // number of markers with non-zero coverage
+			double C_ind = 0;  // average coverage per sample
+			for (j = 0; !sparse && (j < L); ++j) {
+				C = cached ? coverage[idx(j)] : strtod(tokens.at(SEQ_NON_DATA_COLS + j), nullptr);
+				if (C > 0) {
+					++Lcov;
+					C_ind += C;
+				}
+			}
+			for (auto&& record : records) {
+				if ((record.coverage > 0) && selected[SEQ_NON_DATA_COLS + record.locus]) {
+					++Lcov;
+					C_ind += record.coverage;
+				}
+			}
+			C_ind = C_ind / L;
+			if (sparse) {
+				fout << population_id << "\t" << individual_id << "\t" << Lcov << "\t" << C_ind << endl;
+			} else if (cached) {
+				fout << cache.get_population_id(i - 1) << "\t" << cache.get_individual_id(i - 1) << "\t" << Lcov << "\t" << C_ind << endl;
+			} else {
+				fout << tokens[0] << "\t" << tokens[1] << "\t" << Lcov << "\t" << C_ind << endl;
 			}
-        }
-        C_ind = C_ind / L;
-        if (output > 0) {
-            fout << SeqInfo1 << "\t" << SeqInfo2 << "\t" << Lcov << "\t" << C_ind << endl;
 		}
-	}
-    reader.close();
-	if (output > 0) {
+		reader.close();
+		cache.close();
+		sparse_reader.close();
 		fout.close();
 		cout << "Results of the mean coverage per individual are output to '" << outfile << "'." << endl;
 		foutLog << "Results of the mean coverage per individual are output to '" << outfile << "'." << endl;
 	}
 	C_loc = C_loc / (last_ind - first_ind + 1);
 
-	outfile = OUT_PREFIX;
-	outfile.append(".loc.cov");
+	outfile = output_file_name(".loc.cov");
 	if (output > 0) {
 		fout.open(outfile.c_str());
 		if (fout.fail()) {
@@ -2090,15 +2601,11 @@ int check_coverage(int output, int first_ind, int last_ind, uvec cmnS, urowvec &
 		fout << "ID" << "\t" << "N1" << "\t"  << "Cl" << endl;
 	}
 
-	reader.set_file_name(SEQ_SITE_FILE);
-	reader.open();
-	reader.read_row(tokens, '\t'); //skip header TODO: check if header = CHR\tPOS\tID\tREF\tALT
 	k = 0;
-	for (j = 0; j < LOCI_S; ++j) {
-        reader.read_row(tokens, '\t');
-		if (j == idx(k)) {
+	read_site_ids(SEQ_SITE_FILE, [&](int site, const char* id) -> bool {
+		if ((k < L) && (site == (int)idx(k))) {
 			if (output > 0) {
-				fout << tokens.at(2) << "\t" << Ncov(k) << "\t" << C_loc(k) << endl;
+				fout << id << "\t" << Ncov(k) << "\t" << C_loc(k) << endl;
 			}
 			if ((MAX_COVERAGE > 0) && (C_loc(k) > MAX_COVERAGE)) {
 				ExLoci(idx2(k)) = 1;
@@ -2109,9 +2616,8 @@ int check_coverage(int output, int first_ind, int last_ind, uvec cmnS, urowvec &
 			}
 			++k;
 		}
-		if (k == L) break;
-	}
-	reader.close();
+		return (k < L) && (site + 1 < LOCI_S);
+	});
 	if (output > 0) {
 		fout.close();
 		cout << "Results of the mean coverage per locus are output to '" << outfile << "'." << endl;
@@ -2123,6 +2629,42 @@ int check_coverage(int output, int first_ind, int last_ind, uvec cmnS, urowvec &
 	return 1;
 }
 
+// Opens the sparse SEQ_FILE. Positions in pileup files are looked up in the SEQ_FILE sites, which have to be kept while
+// the reader is used.
+void open_sparse_seq(SparseSeqReader &reader, const SiteTable &seq_sites) {
+	reader.set_file_name(SEQ_FILE);
+	reader.set_locator([&seq_sites](const string &chromosome, uint32_t position) { return seq_sites.find(chromosome, position); });
+	reader.open(LOCI_S);
+}
+
+// Passes the ID of every site in the site file (or in every site file of a list, one after another) to visit together
+// with the 0-based index of the site. Stops after the last site or when visit returns false.
+void read_site_ids(const string &site_files, const function<bool(int, const char*)> &visit) {
+	TableReader reader;
+	vector<char*> tokens;
+	vector<bool> vcf_columns(3u, true); // ID is the third column of VCF records
+	int site = 0;
+
+	for (auto&& site_file: split_file_list(site_files)) {
+		bool vcf = VcfReader::is_vcf(site_file);
+		reader.set_file_name(site_file);
+		reader.open();
+		if (!vcf) {
+			reader.read_row(tokens, '\t'); //skip header TODO: check if header = CHR\tPOS\tID\tREF\tALT
+		}
+		while ((vcf ? reader.read_row(tokens, '\t', vcf_columns) : reader.read_row(tokens, '\t')) >= 0) {
+			if (vcf && (tokens[0][0] == '#')) { // meta-information and header lines
+				continue;
+			}
+			if (!visit(site++, tokens.at(2))) {
+				reader.close();
+				return;
+			}
+		}
+		reader.close();
+	}
+}
+
 //################# Function to create an empty paramfile  ##################
 int create_paramfile(string filename){
 	ofstream fout;
@@ -2183,6 +2725,10 @@ int create_paramfile(string filename){
 	fout << endl << "KNN_ZSCORE         # Number of nearest neigbors used to calculate the Z score for each study individual (must be an integer >2; default 10)" <<endl;
 	fout << endl << "RANDOM_SEED        # Seed for the random number generator in the program (must be a non-negative integer; default 0)" <<endl; 
 	fout << endl << "NUM_THREADS        # Number of CPU cores for multi-threading parallel analysis (must be a positive integer; default 8)" <<endl; 
+	fout << endl << "COMPRESS_OUTPUT    # Compress output files with BGZF and add '.gz' to their names (must be 0 or 1; default 0)" <<endl;
+	fout << endl << "REF_SNAPSHOT       # File name of the reference panel snapshot (include path if in a different directory)" <<endl;
+	fout <<         "                   # The snapshot is used if it matches GENO_FILE, COORD_FILE, DIM and the selected loci and reference individuals;" <<endl;
+	fout <<         "                   # otherwise it is (re)written from the loaded reference panel" <<endl;
 
 
  	fout << "\n\n" << "###----Command line arguments----###" <<endl <<endl;
@@ -2214,6 +2760,8 @@ int create_paramfile(string filename){
 	fout << "# -knn   KNN_ZSCORE" << endl;
 	fout << "# -seed  RANDOM_SEED" << endl;
 	fout << "# -nt    NUM_THREADS" << endl;
+	fout << "# -gz    COMPRESS_OUTPUT" << endl;
+	fout << "# -rs    REF_SNAPSHOT" << endl;
 
 	fout << "\n" << "###----end of file----###";
 	fout.close();
@@ -2660,6 +3208,33 @@ int read_paramfile(string filename){
 			}else{
 				getline(fin, str);
 			}			
+		}else if(str.compare("REF_SNAPSHOT")==0){
+			fin>>str;
+			if(str[0]!='#'){
+				if(REF_SNAPSHOT == default_str){
+					REF_SNAPSHOT = str;
+				}
+			}else{
+				getline(fin, str);
+			}			
+		}else if(str.compare("COMPRESS_OUTPUT")==0){
+			fin>>str;
+			if(str[0]!='#'){
+				if(is_int(str) && (atoi(str.c_str())==0 || atoi(str.c_str())==1)){
+					if(COMPRESS_OUTPUT == default_int){
+						COMPRESS_OUTPUT = atoi(str.c_str());
+					}
+				}else{
+					if(COMPRESS_OUTPUT != default_int){
+						cerr<< "Warning: COMPRESS_OUTPUT in the parameter file is not 0 or 1." <<endl;
+						foutLog<< "Warning: COMPRESS_OUTPUT in the parameter file is not 0 or 1." <<endl;
+					}else{
+						COMPRESS_OUTPUT = default_int-1;
+					}
+				}
+			}else{
+				getline(fin, str);
+			}
 		}else if(str.compare("NUM_THREADS")==0){
 			fin>>str;
 			if(str[0]!='#'){
@@ -2732,6 +3307,12 @@ void print_configuration(){
 		cout << "KNN_ZSCORE (-knn)" << "\t" << KNN_ZSCORE << endl;
 		cout << "RANDOM_SEED (-seed)" << "\t" << RANDOM_SEED << endl;
 		cout << "NUM_THREADS (-nt)" << "\t" << NUM_THREADS << endl;
+		if(COMPRESS_OUTPUT>0){
+			cout << "COMPRESS_OUTPUT (-gz)" << "\t" << COMPRESS_OUTPUT << endl;
+		}
+		if(REF_SNAPSHOT.compare(default_str)!=0){
+			cout << "REF_SNAPSHOT (-rs)" << "\t" << REF_SNAPSHOT << endl;
+		}
 	}else{
 		cout << "GENO_FILE (-g)" << "\t" << GENO_FILE <<endl;
 		cout << "DIM (-k)" << "\t" << DIM << endl;
@@ -2749,6 +3330,12 @@ void print_configuration(){
 		}
 		cout << "RANDOM_SEED (-seed)" << "\t" << RANDOM_SEED << endl;
 		cout << "NUM_THREADS (-nt)" << "\t" << NUM_THREADS << endl;
+		if(COMPRESS_OUTPUT>0){
+			cout << "COMPRESS_OUTPUT (-gz)" << "\t" << COMPRESS_OUTPUT << endl;
+		}
+		if(REF_SNAPSHOT.compare(default_str)!=0){
+			cout << "REF_SNAPSHOT (-rs)" << "\t" << REF_SNAPSHOT << endl;
+		}
 	}
 	cout << "-------------------------------------------------" << endl; 
 
@@ -2799,6 +3386,12 @@ void print_configuration(){
 		foutLog << "KNN_ZSCORE (-knn)" << "\t" << KNN_ZSCORE << endl;
 		foutLog << "RANDOM_SEED (-seed)" << "\t" << RANDOM_SEED << endl;
 		foutLog << "NUM_THREADS (-nt)" << "\t" << NUM_THREADS << endl;
+		if(COMPRESS_OUTPUT>0){
+			foutLog << "COMPRESS_OUTPUT (-gz)" << "\t" << COMPRESS_OUTPUT << endl;
+		}
+		if(REF_SNAPSHOT.compare(default_str)!=0){
+			foutLog << "REF_SNAPSHOT (-rs)" << "\t" << REF_SNAPSHOT << endl;
+		}
 	}else{
 		foutLog << "GENO_FILE (-g)" << "\t" << GENO_FILE <<endl;
 		foutLog << "DIM (-k)" << "\t" << DIM << endl;
@@ -2816,6 +3409,12 @@ void print_configuration(){
 		}
 		foutLog << "RANDOM_SEED (-seed)" << "\t" << RANDOM_SEED << endl;
 		foutLog << "NUM_THREADS (-nt)" << "\t" << NUM_THREADS << endl;		
+		if(COMPRESS_OUTPUT>0){
+			foutLog << "COMPRESS_OUTPUT (-gz)" << "\t" << COMPRESS_OUTPUT << endl;
+		}
+		if(REF_SNAPSHOT.compare(default_str)!=0){
+			foutLog << "REF_SNAPSHOT (-rs)" << "\t" << REF_SNAPSHOT << endl;
+		}
 	}
 	foutLog << "-------------------------------------------------" << endl; 
 }
@@ -3034,6 +3633,11 @@ int check_parameters(){
 		cerr << "Error: invalid value for NUM_THREADS (-nt)." << endl;
 		foutLog << "Error: invalid value for NUM_THREADS (-nt)." << endl;
 		flag = 0;
+	}
+	if(COMPRESS_OUTPUT!=0 && COMPRESS_OUTPUT!=1){
+		cerr << "Error: invalid value for COMPRESS_OUTPUT (-gz)." << endl;
+		foutLog << "Error: invalid value for COMPRESS_OUTPUT (-gz)." << endl;
+		flag = 0;
 	}	
 	//============================================================================
 	return flag;
@@ -3104,3 +3708,11 @@ int pca_geno(Mat<char> &G, int nPCs, mat &PC, rowvec &PCvar){
 	}
 	return 1;
 }
+//############## Name of an output file: OUT_PREFIX + suffix (+ ".gz" if the output is compressed) ##############
+string output_file_name(const string& suffix){
+	string filename = OUT_PREFIX + suffix;
+	if(COMPRESS_OUTPUT==1){
+		filename.append(OutputWriter::EXTENSION);
+	}
+	return filename;
+}
@@ -0,0 +1,351 @@
+#include "TableReader.h"
+#include "PackedGenotypeWriter.h"
+#include "SparseSeqWriter.h"
+#include "SiteTable.h"
+#include "OutputWriter.h"
+#include "aux.h"
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <fstream>
+#include <algorithm>
+
+using namespace std;
+
+// Companion utilities for preparing LASER and TRACE input files.
+
+void print_usage() {
+    cerr << "Usage:" << endl;
+    cerr << "  lasertools index [-nt NUM_THREADS] FILE [FILE ...]" << endl;
+    cerr << "      Builds row index FILE" << TableReader::INDEX_EXTENSION << " for an uncompressed or bgzip-compressed SEQ, STUDY or GENO file." << endl;
+    cerr << "      LASER and TRACE use it to jump directly to FIRST_IND." << endl;
+    cerr << "  lasertools pack [-loci] GENO_FILE OUTPUT" << PackedGenotypeReader::EXTENSION << endl;
+    cerr << "      Converts GENO or STUDY file with genotypes 0, 1, 2 and -9 to the packed 2-bit format, which LASER and TRACE" << endl;
+    cerr << "      accept in place of the text file. Sites file of the input is copied to OUTPUT.site if the latter doesn't exist." << endl;
+    cerr << "      With -loci the output stores all samples of one locus together (locus-major layout), which lets LASER compute" << endl;
+    cerr << "      the reference PCA (-pca 1) from blocks of loci without loading the whole reference panel." << endl;
+    cerr << "  lasertools sparse [-sites SITE_FILE] SEQ_FILE OUTPUT" << SparseSeqReader::TEXT_EXTENSION << "[.gz]|OUTPUT" << SparseSeqReader::BINARY_EXTENSION << endl;
+    cerr << "      Converts SEQ file to the sparse format, which lists only the covered loci of every sample. LASER accepts it in" << endl;
+    cerr << "      place of the SEQ file. The binary variant requires integer values up to 65535 (coverage, reads) and 255 (quality)." << endl;
+    cerr << "      Sites file of the input is copied to the sites file of the OUTPUT if the latter doesn't exist." << endl;
+    cerr << "      SEQ_FILE can also be a list or a pattern of samtools pileup files (" << PileupReader::EXTENSION << "[.gz]), which are read at the loci" << endl;
+    cerr << "      of SITE_FILE as LASER reads them; SITE_FILE is then copied instead." << endl;
+}
+
+// Copies the input sites file to the sites file of the output, unless the latter already exists.
+int copy_sites(const string& input_sites_file, const string& output_file) noexcept(false) {
+    TableReader reader;
+    string output_sites_file = build_sites_filename(output_file);
+    ifstream output_sites(output_sites_file.c_str());
+    ifstream input_sites(input_sites_file.c_str());
+    if (!output_sites.good() && !input_sites.good()) {
+        cerr << "Warning: cannot find '" << input_sites_file << "'; '" << output_sites_file << "' must be provided before using '" << output_file << "'." << endl;
+    } else if (!output_sites.good()) {
+        vector<string> fields;
+        reader.set_file_name(input_sites_file);
+        reader.open();
+        OutputWriter fout;
+        fout.open(output_sites_file);
+        while (reader.read_row(fields, '\t') >= 0) {
+            for (unsigned int i = 0u; i < fields.size(); ++i) {
+                fout << (i > 0u ? "\t" : "") << fields[i];
+            }
+            fout << "\n";
+        }
+        reader.close();
+        fout.close();
+        if (fout.fail()) {
+            cerr << "Error: cannot write '" << output_sites_file << "'." << endl;
+            return 1;
+        }
+        cout << "Sites from '" << input_sites_file << "' were written to '" << output_sites_file << "'." << endl;
+    }
+    return 0;
+}
+
+int build_index(int argc, char* argv[]) {
+    int first_file = 0;
+
+    for (first_file = 0; first_file < argc; ++first_file) {
+        if ((strcmp(argv[first_file], "-nt") == 0) && (first_file + 1 < argc)) {
+            TableReader::set_num_threads(atoi(argv[++first_file]));
+        } else {
+            break;
+        }
+    }
+    if (first_file == argc) {
+        print_usage();
+        return 1;
+    }
+    for (int i = first_file; i < argc; ++i) {
+        try {
+            TableReader reader;
+            reader.set_file_name(argv[i]);
+            reader.open();
+            string index_name = reader.build_index();
+            reader.close();
+            cout << "Row index for '" << argv[i] << "' was written to '" << index_name << "'." << endl;
+        } catch (exception& e) {
+            cerr << "Error: " << e.what() << endl;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int pack_genotypes(int argc, char* argv[]) {
+    const int GENO_NON_DATA_COLS = 2;
+    bool locus_major = (argc == 3) && (strcmp(argv[0], "-loci") == 0);
+
+    if (locus_major) {
+        --argc;
+        ++argv;
+    }
+    if ((argc != 2) || !PackedGenotypeReader::is_packed(argv[1])) {
+        print_usage();
+        return 1;
+    }
+    string input_file(argv[0]);
+    string output_file(argv[1]);
+    try {
+        TableReader reader;
+        PackedGenotypeWriter writer;
+        vector<char*> tokens;
+        long int invalid = -1;
+        unsigned int row = 0u;
+        unsigned int n_samples = 0u;
+
+        reader.set_file_name(input_file);
+        reader.open();
+        if (locus_major) { // the file is sized for all samples, so they are counted first
+            while (reader.read_row(tokens, '\t') >= 0) {
+                ++n_samples;
+            }
+            reader.reset();
+        }
+        while (reader.read_row(tokens, '\t') >= 0) {
+            ++row;
+            if (tokens.size() < GENO_NON_DATA_COLS) {
+                cerr << "Error: incorrect number of columns in row " << row << " in '" << input_file << "'." << endl;
+                return 1;
+            }
+            if ((row == 1u) && locus_major) {
+                writer.open_locus_major(output_file, n_samples, (unsigned int)(tokens.size() - GENO_NON_DATA_COLS));
+            } else if (row == 1u) {
+                writer.open(output_file, (unsigned int)(tokens.size() - GENO_NON_DATA_COLS));
+            }
+            if ((invalid = writer.write_row(tokens[0], tokens[1], tokens, GENO_NON_DATA_COLS)) >= 0) {
+                if (invalid < (long int)tokens.size()) {
+                    cerr << "Error: invalid value '" << tokens[invalid] << "' in (row " << row << ", column " << invalid << ") in the file '" << input_file << "'." << endl;
+                } else {
+                    cerr << "Error: incorrect number of columns in row " << row << " in '" << input_file << "'." << endl;
+                }
+                return 1;
+            }
+        }
+        reader.close();
+        if (row == 0u) {
+            cerr << "Error: no genotypes in '" << input_file << "'." << endl;
+            return 1;
+        }
+        writer.close();
+        cout << row << " samples were written to '" << output_file << "'." << endl;
+        return copy_sites(build_sites_filename(input_file), output_file);
+    } catch (exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return 1;
+    }
+}
+
+// Converts pileup files to the sparse format. Values are computed by PileupReader at the loci of the site file.
+int sparse_pileups(const string& sites_file, const string& input_file, const string& output_file) {
+    bool binary = SparseSeqReader::is_binary(output_file);
+    try {
+        SiteTable sites;
+        SparseSeqReader reader;
+        SparseSeqWriter binary_writer;
+        OutputWriter text_writer;
+        vector<SparseSeqReader::Record> records;
+        string population_id, individual_id, message;
+        unsigned int row = 0u;
+        unsigned long long n_records = 0u;
+        long int invalid = -1;
+
+        if (!sites.load(sites_file, nullptr, message)) {
+            cerr << message << endl;
+            return 1;
+        }
+        reader.set_file_name(input_file);
+        reader.set_locator([&sites](const string& chromosome, uint32_t position) { return sites.find(chromosome, position); });
+        reader.open((unsigned int)sites.size());
+        if (binary) {
+            binary_writer.open(output_file, (unsigned int)sites.size());
+        } else {
+            text_writer.open(output_file);
+            if (text_writer.fail()) {
+                cerr << "Error: cannot create a file named " << output_file << "." << endl;
+                return 1;
+            }
+        }
+        while (reader.read_sample(population_id, individual_id, records)) {
+            ++row;
+            // loci without reads are left out as in SEQ files
+            records.erase(remove_if(records.begin(), records.end(), [](const SparseSeqReader::Record& record) { return record.coverage == 0u; }), records.end());
+            if (binary) {
+                if ((invalid = binary_writer.write_sample(population_id.c_str(), individual_id.c_str(), records)) >= 0) {
+                    cerr << "Error: values at site " << records[invalid].locus + 1u << " of sample " << individual_id;
+                    cerr << " don't fit into the binary format; use the " << SparseSeqReader::TEXT_EXTENSION << " format." << endl;
+                    return 1;
+                }
+            } else {
+                text_writer << population_id << '\t' << individual_id;
+                for (auto&& covered : records) {
+                    text_writer << '\t' << covered.locus + 1u << ' ' << covered.coverage << ' ' << covered.reads << ' ' << covered.quality;
+                }
+                text_writer << endl;
+            }
+            n_records += records.size();
+        }
+        reader.close();
+        if (binary) {
+            binary_writer.close();
+        } else {
+            text_writer.close();
+            if (text_writer.fail()) {
+                cerr << "Error: cannot write '" << output_file << "'." << endl;
+                return 1;
+            }
+        }
+        cout << row << " samples with " << n_records << " covered loci were written to '" << output_file << "'." << endl;
+        return copy_sites(sites_file, output_file);
+    } catch (exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return 1;
+    }
+}
+
+int sparse_seq(int argc, char* argv[]) {
+    const int SEQ_NON_DATA_COLS = 2;
+    string sites_file;
+
+    if ((argc == 4) && (strcmp(argv[0], "-sites") == 0)) {
+        sites_file = argv[1];
+        argc -= 2;
+        argv += 2;
+    }
+    if ((argc != 2) || !SparseSeqReader::is_sparse(argv[1])) {
+        print_usage();
+        return 1;
+    }
+    string input_file(expand_file_list(argv[0]));
+    string output_file(argv[1]);
+    if (SparseSeqReader::is_pileup(input_file)) {
+        if (sites_file.empty()) {
+            print_usage();
+            return 1;
+        }
+        return sparse_pileups(sites_file, input_file, output_file);
+    }
+    bool binary = SparseSeqReader::is_binary(output_file);
+    try {
+        TableReader reader;
+        SparseSeqWriter binary_writer;
+        OutputWriter text_writer;
+        vector<char*> tokens;
+        vector<SparseSeqReader::Record> records;
+        SparseSeqReader::Record record;
+        unsigned int n_loci = 0u;
+        unsigned int row = 0u;
+        unsigned long long n_records = 0u;
+        long int invalid = -1;
+
+        reader.set_file_name(input_file);
+        reader.open();
+        while (reader.read_row(tokens, '\t') >= 0) {
+            ++row;
+            if (row == 1u) {
+                n_loci = (tokens.size() > SEQ_NON_DATA_COLS) ? (unsigned int)(tokens.size() - SEQ_NON_DATA_COLS) : 0u;
+                if (binary) {
+                    binary_writer.open(output_file, n_loci);
+                } else {
+                    text_writer.open(output_file);
+                    if (text_writer.fail()) {
+                        cerr << "Error: cannot create a file named " << output_file << "." << endl;
+                        return 1;
+                    }
+                }
+            }
+            if (tokens.size() != SEQ_NON_DATA_COLS + n_loci) {
+                cerr << "Error: incorrect number of columns in row " << row << " in '" << input_file << "'." << endl;
+                return 1;
+            }
+            records.clear();
+            for (unsigned int j = 0u; j < n_loci; ++j) {
+                const char* field = tokens[SEQ_NON_DATA_COLS + j];
+                if ((field[0] == '0') && (field[1] == ' ') && (field[2] == '0') && (field[3] == ' ') && (field[4] == '0') && (field[5] == '\0')) {
+                    continue; // uncovered locus
+                }
+                if (!SparseSeqReader::parse_values(field, record)) {
+                    cerr << "Error: invalid value '" << field << "' in (row " << row << ", column " << SEQ_NON_DATA_COLS + j << ") in the file '" << input_file << "'." << endl;
+                    return 1;
+                }
+                if (record.coverage > 0u) {
+                    record.locus = j;
+                    records.push_back(record);
+                }
+            }
+            if (binary) {
+                if ((invalid = binary_writer.write_sample(tokens[0], tokens[1], records)) >= 0) {
+                    cerr << "Error: value '" << tokens[SEQ_NON_DATA_COLS + records[invalid].locus] << "' in (row " << row << ", column " << SEQ_NON_DATA_COLS + records[invalid].locus;
+                    cerr << ") in the file '" << input_file << "' doesn't fit into the binary format; use the " << SparseSeqReader::TEXT_EXTENSION << " format." << endl;
+                    return 1;
+                }
+            } else {
+                text_writer << tokens[0] << '\t' << tokens[1];
+                for (auto&& covered : records) {
+                    text_writer << '\t' << covered.locus + 1u << ' ' << covered.coverage << ' ' << covered.reads << ' ' << covered.quality;
+                }
+                text_writer << endl;
+            }
+            n_records += records.size();
+        }
+        reader.close();
+        if (row == 0u) {
+            cerr << "Error: no samples in '" << input_file << "'." << endl;
+            return 1;
+        }
+        if (binary) {
+            binary_writer.close();
+        } else {
+            text_writer.close();
+            if (text_writer.fail()) {
+                cerr << "Error: cannot write '" << output_file << "'." << endl;
+                return 1;
+            }
+        }
+        cout << row << " samples with " << n_records << " covered loci were written to '" << output_file << "'." << endl;
+        return copy_sites(build_sites_filename(input_file), output_file);
+    } catch (exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return 1;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        print_usage();
+        return 1;
+    }
+    if (strcmp(argv[1], "index") == 0) {
+        return build_index(argc - 2, argv + 2);
+    }
+    if (strcmp(argv[1], "pack") == 0) {
+        return pack_genotypes(argc - 2, argv + 2);
+    }
+    if (strcmp(argv[1], "sparse") == 0) {
+        return sparse_seq(argc - 2, argv + 2);
+    }
+    print_usage();
+    return 1;
+}
@@ -19,11 +19,19 @@
 #include "Version.h"
 #include "aux.h"
 #include "TableReader.h"
+#include "MultiTableReader.h"
+#include "OutputWriter.h"
+#include "PackedGenotypeReader.h"
+#include "VcfReader.h"
+#include "SiteTable.h"
+#include "ReferenceSnapshotReader.h"
+#include "ReferenceSnapshotWriter.h"
 #include <iostream>
 #include <iomanip>
 #include <fstream>
 #include <string>
 #include <map>
+#include <future>
 #include <vector>
 
 #include <openblas/cblas.h>
@@ -62,6 +70,8 @@ const string ARG_PROCRUSTES_SCALE = "-rho";
 const string ARG_RANDOM_SEED= "-seed";
 const string ARG_KNN_ZSCORE= "-knn";
 const string ARG_NUM_THREADS = "-nt";
+const string ARG_COMPRESS_OUTPUT = "-gz";
+const string ARG_REF_SNAPSHOT = "-rs";
 
 const string default_str = "---this-is-a-default-string---";
 const int default_int = -999999998;
@@ -91,6 +101,8 @@ int PROCRUSTES_SCALE = default_int;  // 0: Fit the scaling parameter to maximize
 									 // 1: Fix the scaling to match the variance between X and Y
 int RANDOM_SEED = default_int;       // Random seed used in the program  
 int NUM_THREADS = default_int;        // Number of CPU cores for multi-threading parallel analysis 
+int COMPRESS_OUTPUT = default_int;    // 0: plain text output files; 1: BGZF-compressed output files (".gz" is added to names)
+string REF_SNAPSHOT = default_str;   // File name of the reference panel snapshot, which is reused if it matches the input files
 int KNN_ZSCORE = default_int;       // Number of nearest neigbors used to calculate the Z score for each study individual. 
 									
 // The following parameters will be determined from the input data files					 
@@ -125,8 +137,10 @@ int read_paramfile(string filename);
 int create_paramfile(string filename);
 int check_parameters();
 void print_configuration();
+string output_file_name(const string& suffix);
 
 int normalize(fmat &G, fmat &Gm, fmat &Gsd);
+int standardize(fmat &G, const fmat &Gm, const fmat &Gsd);
 int pca_cov(mat &M, int nPCs, mat &PC, rowvec &PCvar);
 int procrustes(mat &X, mat &Y, mat &Xnew, double &t, double &rho, mat &A, rowvec &b, int ps);
 double pprocrustes(mat &X, mat &Y, mat &Xnew, double &t, double &rho, mat &A, rowvec &b, int iter, double eps, int ps);
@@ -140,7 +154,7 @@ int main(int argc, char* argv[]){
 	int k=0;
 	int tmp=0;
 	ifstream fin;
-	ofstream fout;	
+	OutputWriter fout;
 	string str;
 	string outfile;	
 	time_t t1,t2;
@@ -208,6 +222,8 @@ int main(int argc, char* argv[]){
 	if(argi[ARG_RANDOM_SEED]!=default_int){RANDOM_SEED = argi[ARG_RANDOM_SEED];}
 	if(argi[ARG_KNN_ZSCORE]!=default_int){KNN_ZSCORE = argi[ARG_KNN_ZSCORE];}
 	if(argi[ARG_NUM_THREADS]!=default_int){NUM_THREADS = argi[ARG_NUM_THREADS];}
+	if(argi[ARG_COMPRESS_OUTPUT]!=default_int){COMPRESS_OUTPUT = argi[ARG_COMPRESS_OUTPUT];}
+	if(args[ARG_REF_SNAPSHOT]!=default_str){REF_SNAPSHOT = args[ARG_REF_SNAPSHOT];}
 	//##################  Read in and check parameter values  #######################
 	if(PARAM_FILE.compare(default_str)==0){ PARAM_FILE = "trace.conf"; }
 	int flag = read_paramfile(PARAM_FILE);
@@ -235,6 +251,11 @@ int main(int argc, char* argv[]){
 	if(RANDOM_SEED==default_int){ RANDOM_SEED = 0; }
 	if(KNN_ZSCORE==default_int){ KNN_ZSCORE = 10; }
 	if(NUM_THREADS==default_int){ NUM_THREADS = 8; }
+	if(COMPRESS_OUTPUT==default_int){ COMPRESS_OUTPUT = 0; }
+	if(GENO_FILE.compare(default_str)!=0){ GENO_FILE = expand_file_list(GENO_FILE); }  // list or pattern of files, e.g. one per chromosome
+	if(STUDY_FILE.compare(default_str)!=0){ STUDY_FILE = expand_file_list(STUDY_FILE); }
+	TableReader::set_num_threads(NUM_THREADS);  // used to decompress BGZF input files
+	TableReader::set_read_ahead(NUM_THREADS > 1 ? 3 : 0);  // decompress input files on a separate thread while rows are parsed
 	//###############################################################################
 	if(OUT_PREFIX.compare(default_str)==0){ OUT_PREFIX = "trace"; }
 	foutLog.close();
@@ -249,20 +270,20 @@ int main(int argc, char* argv[]){
 	}
 	
 	//############## Get values for REF_INDS, LOCI, INDS, NUM_PCs, and Check data format ################
-	int nrow = 0;
-	int ncol = 0;
+	int study_nrow = 0, study_ncol = 0;
+	int geno_nrow = 0, geno_ncol = 0;
+	int coord_nrow = 0, coord_ncol = 0;
 	flag = 1;
-	map<string,int> idxS;
-	map<string,int> idxG;
-	map<string,string> alleleS;
-	map<string,string> alleleG;	
-	vector<string> cmnsnp;
+	SiteTable study_sites;
+	SiteTable geno_sites;
+	vector<pair<size_t,size_t>> cmnsnp;  // shared loci: indices in GENO_FILE and STUDY_FILE
+	vector<string> ref_sites;  // keys of the shared loci, kept only to be written to REF_SNAPSHOT
 	uvec cmnS;
 	uvec cmnG;
 	int unmatchSite = 0;
 	int LOCI_trim = 0;
 	int Lex = 0;
-	map<string,int> exSNP;	
+	unordered_set<string> exSNP;
 	
 	gsl_rng *rng;
 	rng = gsl_rng_alloc(gsl_rng_taus);
@@ -281,26 +302,151 @@ int main(int argc, char* argv[]){
 			while (!fin.eof()) {
 				fin >> str;
 				if(str.length()>0 && str!=" "){
-					exSNP[str] = 1;
+					exSNP.insert(str);
 				}				
 			}
 			fin.close();		
 		}
 	}
 
-	if ((STUDY_FILE.compare(default_str) != 0) && (flag == 1)) {
-        TableReader geno_reader;
-        TableReader sites_reader;
-        LOCI_S = 0;
+	// Lists of files (e.g. one per chromosome) are read side by side as one table, which works for text files only.
+	// Lists of VCF files are read one after another.
+	for (auto&& listed_files: { STUDY_FILE, GENO_FILE }) {
+		for (auto&& name: split_file_list(is_file_list(listed_files) ? listed_files : "")) {
+			if (PackedGenotypeReader::is_packed(name) || (VcfReader::is_vcf(name) && !PackedGenotypeReader::can_read(listed_files))) {
+				cerr << "Error: '" << name << "' can't be a part of a list of files. Only text files, or only VCF files, can be listed." << endl;
+				foutLog << "Error: '" << name << "' can't be a part of a list of files. Only text files, or only VCF files, can be listed." << endl;
+				foutLog.close();
+				return 1;
+			}
+		}
+	}
+
+	// STUDY_FILE, GENO_FILE and COORD_FILE (with their site files) are independent of each other until the shared loci are
+	// found, so each one is scanned by a separate task. The results are reported in the usual order once all tasks finish.
+	int study_format = 1;
+	int geno_format = 1;
+	int coord_format = 1;
+	string study_message("");
+	string geno_message("");
+	string coord_message("");
+	bool study_sites_loaded = false;
+	bool geno_sites_loaded = false;
+	string study_sites_message("");
+	string geno_sites_message("");
+	future<void> study_task;
+	future<void> geno_task;
+	future<void> coord_task;
+
+	ReferenceSnapshotReader snapshot;
+	if ((REF_SNAPSHOT.compare(default_str) != 0) && (GENO_FILE.compare(default_str) != 0)) {
+		snapshot.open(REF_SNAPSHOT, GENO_FILE, build_sites_filename(GENO_FILE), (COORD_FILE.compare(default_str) != 0) ? COORD_FILE : "");
+		// format checks are skipped only if they were done when the snapshot was written
+		uint32_t checked = ReferenceSnapshotReader::CHECKED_GENO | ((COORD_FILE.compare(default_str) != 0) ? ReferenceSnapshotReader::CHECKED_COORD : 0u);
+		if (snapshot.is_open() && !snapshot.is_checked(checked)) {
+			snapshot.close();
+		}
+	}
+
+	if (STUDY_FILE.compare(default_str) != 0) {
         STUDY_SITE_FILE = build_sites_filename(STUDY_FILE);
-        vector<string> tokens;
-        string message("");
-
-        geno_reader.set_file_name(STUDY_FILE);
-        geno_reader.open();
-        geno_reader.get_dim(nrow, ncol, '\t');
-        INDS = nrow - STUDY_NON_DATA_ROWS;
-		int tmpLOCI = ncol - STUDY_NON_DATA_COLS;
+        study_task = async(launch::async, [&]() {
+            bool vcf = false;
+            if (PackedGenotypeReader::is_packed(STUDY_FILE)) { // dimensions are in the header, genotypes were checked when packing
+                PackedGenotypeReader packed_reader;
+                packed_reader.set_file_name(STUDY_FILE);
+                packed_reader.open();
+                study_nrow = STUDY_NON_DATA_ROWS + packed_reader.get_n_samples();
+                study_ncol = STUDY_NON_DATA_COLS + packed_reader.get_n_loci();
+                packed_reader.close();
+            } else if (PackedGenotypeReader::can_read(STUDY_FILE)) { // samples are in the VCF header, loci are counted with the sites
+                VcfReader vcf_reader;
+                vcf_reader.set_file_name(split_file_list(STUDY_FILE).front());
+                vcf_reader.open();
+                study_nrow = STUDY_NON_DATA_ROWS + (int)vcf_reader.get_sample_ids().size();
+                vcf_reader.close();
+                vcf = true;
+            } else {
+                MultiTableReader geno_reader(STUDY_NON_DATA_COLS);
+                geno_reader.set_file_name(STUDY_FILE);
+                geno_reader.open();
+                // dimensions and format are checked in a single pass
+                study_format = geno_reader.scan(study_nrow, study_ncol, '\t', STUDY_NON_DATA_ROWS, STUDY_NON_DATA_COLS, TableReader::Format::NPLOID_GT, true, study_message);
+                geno_reader.close();
+            }
+            study_sites_loaded = study_sites.load(STUDY_SITE_FILE, nullptr, study_sites_message);
+            if (vcf) {
+                study_ncol = STUDY_NON_DATA_COLS + (int)study_sites.size();
+            }
+        });
+	}
+
+	if (GENO_FILE.compare(default_str) != 0) {
+        GENO_SITE_FILE = build_sites_filename(GENO_FILE);
+        geno_task = async(launch::async, [&]() {
+            bool vcf = false;
+            if (snapshot.is_open()) { // dimensions and format were checked when the snapshot was written
+                geno_nrow = GENO_NON_DATA_ROWS + snapshot.get_geno_samples();
+                geno_ncol = GENO_NON_DATA_COLS + snapshot.get_geno_loci();
+            } else if (PackedGenotypeReader::is_packed(GENO_FILE)) { // dimensions are in the header, genotypes were checked when packing
+                PackedGenotypeReader packed_reader;
+                packed_reader.set_file_name(GENO_FILE);
+                packed_reader.open();
+                geno_nrow = GENO_NON_DATA_ROWS + packed_reader.get_n_samples();
+                geno_ncol = GENO_NON_DATA_COLS + packed_reader.get_n_loci();
+                packed_reader.close();
+            } else if (PackedGenotypeReader::can_read(GENO_FILE)) { // samples are in the VCF header, loci are counted with the sites
+                VcfReader vcf_reader;
+                vcf_reader.set_file_name(split_file_list(GENO_FILE).front());
+                vcf_reader.open();
+                geno_nrow = GENO_NON_DATA_ROWS + (int)vcf_reader.get_sample_ids().size();
+                vcf_reader.close();
+                vcf = true;
+            } else {
+                MultiTableReader geno_reader(GENO_NON_DATA_COLS);
+                geno_reader.set_file_name(GENO_FILE);
+                geno_reader.open();
+                // dimensions and format are checked in a single pass
+                geno_format = geno_reader.scan(geno_nrow, geno_ncol, '\t', GENO_NON_DATA_ROWS, GENO_NON_DATA_COLS, TableReader::Format::NPLOID_GT, true, geno_message);
+                geno_reader.close();
+            }
+            // sites in the EXCLUDE_LIST are flagged while the file is read
+            geno_sites_loaded = geno_sites.load(GENO_SITE_FILE, &exSNP, geno_sites_message);
+            if (vcf) {
+                geno_ncol = GENO_NON_DATA_COLS + (int)geno_sites.size();
+            }
+        });
+	}
+
+	if ((COORD_FILE.compare(default_str) != 0) && (GENO_FILE.compare(default_str) != 0)) {
+        coord_task = async(launch::async, [&]() {
+            if (snapshot.is_open()) { // dimensions and format were checked when the snapshot was written
+                coord_nrow = COORD_NON_DATA_ROWS + snapshot.get_geno_samples();
+                coord_ncol = COORD_NON_DATA_COLS + snapshot.get_coord_pcs();
+            } else {
+                TableReader coord_reader;
+                coord_reader.set_file_name(COORD_FILE);
+                coord_reader.open();
+                coord_format = coord_reader.scan(coord_nrow, coord_ncol, '\t', COORD_NON_DATA_ROWS, COORD_NON_DATA_COLS, TableReader::Format::FLOAT, true, coord_message);
+                coord_reader.close();
+            }
+        });
+	}
+
+	// get() rethrows errors of the readers in this thread
+	if (study_task.valid()) {
+		study_task.get();
+	}
+	if (geno_task.valid()) {
+		geno_task.get();
+	}
+	if (coord_task.valid()) {
+		coord_task.get();
+	}
+
+	if ((STUDY_FILE.compare(default_str) != 0) && (flag == 1)) {
+        INDS = study_nrow - STUDY_NON_DATA_ROWS;
+		int tmpLOCI = study_ncol - STUDY_NON_DATA_COLS;
 		cout << INDS << " individuals are detected in the STUDY_FILE." << endl;  
 		foutLog << INDS << " individuals are detected in the STUDY_FILE." << endl; 
 		if (INDS < 0) {
@@ -314,23 +460,13 @@ int main(int argc, char* argv[]){
 			flag = 0;
 		}
 
-        sites_reader.set_file_name(STUDY_SITE_FILE);
-        sites_reader.open();
-        sites_reader.read_row(tokens, '\t'); //skip header
-		while (sites_reader.read_row(tokens, '\t') >= 0) {
-		    if (tokens.size() != 5) {
-                cerr << "Error: incorrect number of columns in '" << STUDY_SITE_FILE << "'." << endl;
-                foutLog << "Error: incorrect number of columns in '" << STUDY_SITE_FILE << "'." << endl;
-                foutLog.close();
-                return 1;
-		    }
-		    string variant_name = tokens.at(0) + ":" + tokens.at(1);
-		    string variant_alleles = tokens.at(3) + "," + tokens.at(4);
-            idxS[variant_name] = LOCI_S;
-            alleleS[variant_name] = variant_alleles;
-            LOCI_S++;
-		}
-        sites_reader.close();
+        if (!study_sites_loaded) {
+            cerr << study_sites_message << endl;
+            foutLog << study_sites_message << endl;
+            foutLog.close();
+            return 1;
+        }
+        LOCI_S = study_sites.size();
 
 		cout << LOCI_S << " loci are detected in the STUDY_FILE." << endl; 
 		foutLog << LOCI_S << " loci are detected in the STUDY_FILE." << endl;
@@ -340,13 +476,12 @@ int main(int argc, char* argv[]){
 			flag = 0;
 		}
 		if (flag == 1) {
-            flag = geno_reader.check_format(GENO_NON_DATA_ROWS, GENO_NON_DATA_COLS, INDS, LOCI_S, TableReader::Format::NPLOID_GT, message);
-            if (message.length() > 0) {
-                cout << message << endl;
-                foutLog << message << endl;
+            flag = study_format;
+            if (study_message.length() > 0) {
+                cout << study_message << endl;
+                foutLog << study_message << endl;
             }
 		}
-        geno_reader.close();
 	} else {
 		cerr << "Error: STUDY_FILE (-s) is not specified." << endl;
 		foutLog << "Error: STUDY_FILE (-s) is not specified." << endl;
@@ -354,20 +489,15 @@ int main(int argc, char* argv[]){
 		return 1;
 	}
 	
+	if (snapshot.is_open() && (flag == 1)) {
+		cout << "Reference panel snapshot '" << REF_SNAPSHOT << "' matches the GENO_FILE." << endl;
+		foutLog << "Reference panel snapshot '" << REF_SNAPSHOT << "' matches the GENO_FILE." << endl;
+	}
+
 	if(GENO_FILE.compare(default_str) != 0 && flag == 1){
-	    TableReader geno_reader;
-        TableReader sites_reader;
-        LOCI_G = 0;
         LOCI = 0;
-        GENO_SITE_FILE = build_sites_filename(GENO_FILE);
-        vector<string> tokens;
-        string message("");
-
-        geno_reader.set_file_name(GENO_FILE);
-        geno_reader.open();
-        geno_reader.get_dim(nrow, ncol, '\t');
-		REF_INDS = nrow - GENO_NON_DATA_ROWS;
-		int tmpLOCI = ncol - GENO_NON_DATA_COLS;
+		REF_INDS = geno_nrow - GENO_NON_DATA_ROWS;
+		int tmpLOCI = geno_ncol - GENO_NON_DATA_COLS;
 		cout << REF_INDS << " individuals are detected in the GENO_FILE." << endl; 
 		foutLog << REF_INDS << " individuals are detected in the GENO_FILE." << endl; 		 		
 		if(REF_INDS < 0){
@@ -381,37 +511,27 @@ int main(int argc, char* argv[]){
 			flag = 0;
 		}
 
-        sites_reader.set_file_name(GENO_SITE_FILE);
-        sites_reader.open();
-        sites_reader.read_row(tokens, '\t'); //skip header TODO: check if header = CHR\tPOS\tID\tREF\tALT
-		while (sites_reader.read_row(tokens, '\t') >= 0) {
-		    if (tokens.size() != 5) {
-                cerr << "Error: incorrect number of columns in '" << GENO_SITE_FILE << "'." << endl;
-                foutLog << "Error: incorrect number of columns in '" << GENO_SITE_FILE << "'." << endl;
-                foutLog.close();
-                return 1;
-		    }
-		    string variant_name = tokens.at(0) + ":" + tokens.at(1);
-            string variant_alleles = tokens.at(3) + "," + tokens.at(4);
-            idxG[variant_name] = LOCI_G;
-            alleleG[variant_name] = variant_alleles;
-            ++LOCI_G;
-            if (idxS.count(variant_name) > 0) {
-                if (alleleS[variant_name].compare(variant_alleles) != 0 ) {
-                    cerr << "Warning: Two datasets have different alleles at locus [" << variant_name << "]: " << "[" << variant_alleles<< "] vs [" << alleleS[variant_name] << "]." << endl;
-                    foutLog << "Warning: Two datasets have different alleles at locus [" << variant_name << "]: " << "[" << variant_alleles << "] vs [" << alleleS[variant_name] << "]." << endl;
-                    ++unmatchSite;
-                } else if (exSNP.count(tokens.at(2)) > 0) { // use ID column
-                    ++Lex;
-                } else if (gsl_rng_uniform(rng) < TRIM_PROP) {
-                    ++LOCI_trim;
-                } else {
-                    cmnsnp.push_back(variant_name);
-                    ++LOCI;
-                }
+        if (!geno_sites_loaded) {
+            cerr << geno_sites_message << endl;
+            foutLog << geno_sites_message << endl;
+            foutLog.close();
+            return 1;
+        }
+        LOCI_G = geno_sites.size();
+        geno_sites.intersect(study_sites, [&](size_t g, size_t s, bool same_alleles) {
+            if (!same_alleles) {
+                cerr << "Warning: Two datasets have different alleles at locus [" << geno_sites.get_name(g) << "]: " << "[" << geno_sites.get_alleles(g) << "] vs [" << study_sites.get_alleles(s) << "]." << endl;
+                foutLog << "Warning: Two datasets have different alleles at locus [" << geno_sites.get_name(g) << "]: " << "[" << geno_sites.get_alleles(g) << "] vs [" << study_sites.get_alleles(s) << "]." << endl;
+                ++unmatchSite;
+            } else if (geno_sites.is_excluded(g)) { // use ID column
+                ++Lex;
+            } else if (gsl_rng_uniform(rng) < TRIM_PROP) {
+                ++LOCI_trim;
+            } else {
+                cmnsnp.emplace_back(geno_sites.get_last(g), s);
+                ++LOCI;
             }
-		}
-        sites_reader.close();
+        });
 
 		cout << LOCI_G << " loci are detected in the GENO_FILE." << endl; 
 		foutLog << LOCI_G << " loci are detected in the GENO_FILE." << endl;
@@ -424,23 +544,23 @@ int main(int argc, char* argv[]){
 			cmnS.set_size(LOCI);
 			cmnG.set_size(LOCI);
 			for(i=0; i<LOCI; i++){
-				cmnG(i)=idxG[cmnsnp[i]];
-				cmnS(i)=idxS[cmnsnp[i]];
+				cmnG(i)=cmnsnp[i].first;
+				cmnS(i)=cmnsnp[i].second;
+				if (REF_SNAPSHOT.compare(default_str) != 0) {
+					ref_sites.push_back(geno_sites.get_name(cmnG(i)));
+				}
 			}
-			cmnsnp.clear();
-			idxG.clear();
-			idxS.clear();
-			alleleG.clear();
-			alleleS.clear();
 		}
+		cmnsnp.clear();
+		geno_sites.clear();
+		study_sites.clear();
 		if (flag == 1) {
-            flag = geno_reader.check_format(GENO_NON_DATA_ROWS, GENO_NON_DATA_COLS, REF_INDS, LOCI_G, TableReader::Format::NPLOID_GT, message);
-            if (message.length() > 0) {
-                cout << message << endl;
-                foutLog << message << endl;
+            flag = geno_format;
+            if (geno_message.length() > 0) {
+                cout << geno_message << endl;
+                foutLog << geno_message << endl;
             }
 		}
-        geno_reader.close();
 	} else {
 		cerr << "Error: GENO_FILE (-g) is not specified." << endl;
 		foutLog << "Error: GENO_FILE (-g) is not specified." << endl;
@@ -450,14 +570,8 @@ int main(int argc, char* argv[]){
 	}
 
 	if(COORD_FILE.compare(default_str) != 0 && GENO_FILE.compare(default_str) != 0 && flag == 1){
-	    TableReader coord_reader;
-        string message("");
-
-        coord_reader.set_file_name(COORD_FILE);
-        coord_reader.open();
-        coord_reader.get_dim(nrow, ncol, '\t');
-		int tmpINDS = nrow - COORD_NON_DATA_ROWS;
-		NUM_PCS = ncol - COORD_NON_DATA_COLS;
+		int tmpINDS = coord_nrow - COORD_NON_DATA_ROWS;
+		NUM_PCS = coord_ncol - COORD_NON_DATA_COLS;
 		cout << tmpINDS << " individuals are detected in the COORD_FILE." << endl;
 		cout << NUM_PCS << " PCs are detected in the COORD_FILE." << endl;
 		foutLog << tmpINDS << " individuals are detected in the COORD_FILE." << endl;
@@ -477,13 +591,12 @@ int main(int argc, char* argv[]){
 			flag = 0;
 		}
 		if (flag == 1) {
-            flag = coord_reader.check_format(COORD_NON_DATA_ROWS, COORD_NON_DATA_COLS, REF_INDS, NUM_PCS, TableReader::Format::FLOAT, message);
-            if (message.length() > 0) {
-                cout << message << endl;
-                foutLog << message << endl;
+            flag = coord_format;
+            if (coord_message.length() > 0) {
+                cout << coord_message << endl;
+                foutLog << coord_message << endl;
             }
 		}
-        coord_reader.close();
 	}	
 	if(flag == 0){
 		foutLog.close();
@@ -573,6 +686,14 @@ int main(int argc, char* argv[]){
 	string *RefInfo2 = new string [REF_SIZE];
 	fmat RefD(REF_SIZE, LOCI);
 	mat refPC = zeros<mat>(REF_SIZE,DIM);
+	rowvec PCvar;
+	// === The reference panel is taken from REF_SNAPSHOT if it was prepared for the same loci, individuals and DIM ===
+	vector<uint32_t> ref_samples(Refset.begin(), Refset.end());
+	vector<uint32_t> ref_loci(cmnG.begin(), cmnG.end());
+	bool from_snapshot = snapshot.matches(ref_samples, ref_loci, DIM, { ReferenceSnapshotReader::REF_MEAN, ReferenceSnapshotReader::REF_SD,
+	        ReferenceSnapshotReader::REF_M, ReferenceSnapshotReader::REF_PC });
+	bool write_snapshot = (REF_SNAPSHOT.compare(default_str) != 0) && !from_snapshot;
+	ReferenceSnapshotWriter snapshot_writer;
 	//========================= Read the reference data ==========================
 	if(GENO_FILE.compare(default_str)!=0){
  		time ( &rawtime );
@@ -605,10 +726,7 @@ int main(int argc, char* argv[]){
 		}		
 		//=====================================================================================
 
-		TableReader reader;
-		vector<string> tokens;
-		int row = 0;
-		int ref_ind = 0;
+		MultiTableReader reader(GENO_NON_DATA_COLS);
 		int ref_subset_ind = 0;
 
 		reader.set_file_name(GENO_FILE);
@@ -620,24 +738,74 @@ int main(int argc, char* argv[]){
         foutLog << endl << asctime (timeinfo);
         foutLog << "Reading reference genotype data ..." << endl;
 
-        reader.open();
-        while(reader.read_row(tokens, '\t') >= 0) {
-            ++row;
-            if (row <= GENO_NON_DATA_ROWS) { // skip any headers
-                continue;
+        if (from_snapshot) { // genotypes are decoded from the 2-bit codes in the snapshot
+            for (ref_subset_ind = 0; ref_subset_ind < REF_SIZE; ++ref_subset_ind) {
+                const unsigned char* genotypes = snapshot.get_genotypes(ref_subset_ind);
+                RefInfo1[ref_subset_ind] = snapshot.get_population_id(ref_subset_ind);
+                RefInfo2[ref_subset_ind] = snapshot.get_individual_id(ref_subset_ind);
+                for(unsigned int i = 0; i < LOCI; ++i) {
+                    RefD(ref_subset_ind, i) = PackedGenotypeReader::get_value(genotypes, i);
+                }
             }
-            if (ref_ind == Refset[ref_subset_ind]) {
-                RefInfo1[ref_subset_ind] = tokens[0];
-                RefInfo2[ref_subset_ind] = tokens[1];
+        } else if (PackedGenotypeReader::can_read(GENO_FILE)) { // genotypes are decoded directly from the 2-bit codes (VCF files into them)
+            PackedGenotypeReader packed_reader;
+            packed_reader.set_file_name(GENO_FILE);
+            packed_reader.open();
+            for (ref_subset_ind = 0; ref_subset_ind < REF_SIZE; ++ref_subset_ind) {
+                RefInfo1[ref_subset_ind] = packed_reader.get_population_id(Refset[ref_subset_ind]);
+                RefInfo2[ref_subset_ind] = packed_reader.get_individual_id(Refset[ref_subset_ind]);
+                if (packed_reader.is_locus_major()) {
+                    continue;
+                }
+                const unsigned char* genotypes = packed_reader.get_row(Refset[ref_subset_ind]);
                 for(unsigned int i = 0; i < LOCI; ++i) {
-                    RefD(ref_subset_ind, i) = stof(tokens.at(GENO_NON_DATA_COLS + cmnG(i)));
+                    RefD(ref_subset_ind, i) = PackedGenotypeReader::get_value(genotypes, cmnG(i));
+                }
+            }
+            for(unsigned int i = 0; (i < LOCI) && packed_reader.is_locus_major(); ++i) { // RefD is filled column by column
+                const unsigned char* genotypes = packed_reader.get_locus(cmnG(i));
+                for (ref_subset_ind = 0; ref_subset_ind < REF_SIZE; ++ref_subset_ind) {
+                    RefD(ref_subset_ind, i) = PackedGenotypeReader::get_value(genotypes, Refset[ref_subset_ind]);
                 }
-                ++ref_subset_ind;
-                if (ref_subset_ind >= REF_SIZE) {
-                    break;
+            }
+            packed_reader.close();
+        } else {
+            reader.open();
+        }
+        if (reader.is_open()) { // rows are parsed on NUM_THREADS threads, each one straight into its row of RefD
+            vector<int> ref_index(Refset[REF_SIZE - 1] + 1, -1); // position of each sample in Refset
+            string geno_message;
+            for (ref_subset_ind = 0; ref_subset_ind < REF_SIZE; ++ref_subset_ind) {
+                ref_index[Refset[ref_subset_ind]] = ref_subset_ind;
+            }
+            reader.read_rows('\t', GENO_NON_DATA_ROWS + Refset[REF_SIZE - 1] + 1, [&](long int row, const vector<char*>& tokens, string& message) -> bool {
+                if ((row <= GENO_NON_DATA_ROWS) || (ref_index[row - GENO_NON_DATA_ROWS - 1] < 0)) { // skip any headers and samples outside of the reference
+                    return true;
+                }
+                int ref = ref_index[row - GENO_NON_DATA_ROWS - 1];
+                int genotype = 0;
+                RefInfo1[ref] = tokens.at(0);
+                RefInfo2[ref] = tokens.at(1);
+                for(unsigned int i = 0; i < LOCI; ++i) {
+                    if (!TableReader::parse_genotype(tokens.at(GENO_NON_DATA_COLS + cmnG(i)), genotype)) {
+                        message = "Error: invalid value '" + string(tokens[GENO_NON_DATA_COLS + cmnG(i)]) + "' in (row " + to_string(row) + ", column " +
+                                to_string(GENO_NON_DATA_COLS + cmnG(i)) + ") in the file '" + GENO_FILE + "'.";
+                        return false;
+                    }
+                    RefD(ref, i) = genotype;
                 }
+                return true;
+            }, geno_message);
+            if (!geno_message.empty()) {
+                cerr << geno_message << endl;
+                foutLog << geno_message << endl;
+                reader.close();
+                delete [] RefInfo1;
+                delete [] RefInfo2;
+                foutLog.close();
+                gsl_rng_free(rng);
+                return 1;
             }
-            ++ref_ind;
         }
 		reader.close();
 	}
@@ -646,16 +814,39 @@ int main(int argc, char* argv[]){
 	time ( &rawtime );
 	timeinfo = localtime ( &rawtime );
 	cout << endl << asctime (timeinfo);
-	cout << "Calculating reference covariance matrix ..." << endl;
-	foutLog << endl << asctime (timeinfo);
-	foutLog << "Calculating reference covariance matrix ..." << endl;	
 	fmat RefMean(LOCI,1);
 	fmat RefSD(LOCI,1);
-	normalize(RefD, RefMean, RefSD);		
-	mat RefM = conv_to<mat>::from(RefD*RefD.t());
+	mat RefM;
+	if (from_snapshot) {
+		cout << "Reading reference covariance matrix from the snapshot '" << REF_SNAPSHOT << "' ..." << endl;
+		foutLog << endl << asctime (timeinfo);
+		foutLog << "Reading reference covariance matrix from the snapshot '" << REF_SNAPSHOT << "' ..." << endl;
+		RefMean = fmat(snapshot.get_ref_mean(), 1, LOCI);
+		RefSD = fmat(snapshot.get_ref_sd(), 1, LOCI);
+		standardize(RefD, RefMean, RefSD);
+		RefM = mat(snapshot.get_ref_m(), REF_SIZE, REF_SIZE);
+	} else {
+		cout << "Calculating reference covariance matrix ..." << endl;
+		foutLog << endl << asctime (timeinfo);
+		foutLog << "Calculating reference covariance matrix ..." << endl;
+		if (write_snapshot) { // raw genotypes are packed before they are normalized
+			snapshot_writer.set_checked(ReferenceSnapshotReader::CHECKED_GENO | ReferenceSnapshotReader::CHECKED_COORD);
+			snapshot_writer.set_samples(ref_samples, RefInfo1, RefInfo2);
+			snapshot_writer.set_loci(ref_loci, ref_sites);
+			if (!snapshot_writer.set_genotypes(RefD.memptr())) {
+				cerr << "Warning: GENO_FILE has genotypes other than 0, 1, 2 and -9, which can't be stored in the REF_SNAPSHOT." << endl;
+				foutLog << "Warning: GENO_FILE has genotypes other than 0, 1, 2 and -9, which can't be stored in the REF_SNAPSHOT." << endl;
+				write_snapshot = false;
+			}
+		}
+		normalize(RefD, RefMean, RefSD);
+		RefM = conv_to<mat>::from(RefD*RefD.t());
+	}
 
 	//========================= Get reference coordinates  ==========================
-	if(COORD_FILE.compare(default_str)!=0 && GENO_FILE.compare(default_str)!=0){		
+	if(from_snapshot && COORD_FILE.compare(default_str)!=0){
+		refPC = mat(snapshot.get_ref_pc(), REF_SIZE, DIM);   // coordinates were read from the COORD_FILE when the snapshot was written
+	}else if(COORD_FILE.compare(default_str)!=0 && GENO_FILE.compare(default_str)!=0){		
 		fin.open(COORD_FILE.c_str());
 		if(fin.fail()){
 			cerr << "Error: cannot find the COORD_FILE '" << COORD_FILE << "'." << endl;
@@ -715,11 +906,15 @@ int main(int argc, char* argv[]){
 		cout << "Performing PCA on reference individuals ..." << endl;
 		foutLog << endl << asctime (timeinfo);
 		foutLog << "Performing PCA on reference individuals ..." << endl;	
-		rowvec PCvar = zeros<rowvec>(DIM);
-		pca_cov(RefM, DIM, refPC, PCvar);   // Perform PCA
+		if(from_snapshot){
+			refPC = mat(snapshot.get_ref_pc(), REF_SIZE, DIM);
+			PCvar = rowvec(snapshot.get_pc_var(), DIM);
+		}else{
+			PCvar = zeros<rowvec>(DIM);
+			pca_cov(RefM, DIM, refPC, PCvar);   // Perform PCA
+		}
 		//==================== Output reference PCs ==========================
-		outfile = OUT_PREFIX;
-		outfile.append(".RefPC.coord");
+		outfile = output_file_name(".RefPC.coord");
 		fout.open(outfile.c_str());
 		if(fout.fail()){
 			cerr << "Error: cannot create a file named " << outfile << "." << endl;
@@ -741,8 +936,7 @@ int main(int argc, char* argv[]){
 		cout << "Reference PCA coordinates are output to '" << outfile << "'." << endl;
 		foutLog << "Reference PCA coordinates are output to '" << outfile << "'." << endl;
 		//==================================================================
-		outfile = OUT_PREFIX;
-		outfile.append(".RefPC.var");
+		outfile = output_file_name(".RefPC.var");
 		fout.open(outfile.c_str());
 		if(fout.fail()){
 			cerr << "Error: cannot create a file named " << outfile << "." << endl;
@@ -755,24 +949,44 @@ int main(int argc, char* argv[]){
 			fout << j+1 << "\t" << PCvar(j) << endl;
 		}	
 		fout.close();
-		PCvar.clear();
 		cout << "Variances explained by PCs are output to '" << outfile << "'." << endl;
 		foutLog << "Variances explained by PCs are output to '" << outfile << "'." << endl;		
 	}
+	snapshot.close();
+	if(write_snapshot){
+		snapshot_writer.set_ref_stats(RefMean.memptr(), RefSD.memptr());
+		snapshot_writer.set_ref_m(RefM.memptr());
+		snapshot_writer.set_ref_pc(refPC.memptr(), DIM, (COORD_FILE.compare(default_str)!=0) ? nullptr : PCvar.memptr());
+		if(snapshot_writer.set_sources(GENO_FILE, GENO_SITE_FILE, (COORD_FILE.compare(default_str)!=0) ? COORD_FILE : "", REF_INDS, LOCI_G, NUM_PCS) &&
+		   snapshot_writer.write(REF_SNAPSHOT)){
+			cout << "Reference panel snapshot is output to '" << REF_SNAPSHOT << "'." << endl;
+			foutLog << "Reference panel snapshot is output to '" << REF_SNAPSHOT << "'." << endl;
+		}else{
+			cerr << "Warning: cannot create the reference panel snapshot '" << REF_SNAPSHOT << "'." << endl;
+			foutLog << "Warning: cannot create the reference panel snapshot '" << REF_SNAPSHOT << "'." << endl;
+		}
+	}
+	PCvar.clear();
 			
 	//========================= Read genotype data of the study sample ==========================
 
-    TableReader reader;
-    vector<string> tokens;
+    MultiTableReader reader(STUDY_NON_DATA_COLS);
+    vector<char*> tokens;
     int row = 0;
     i = 0;
 
-    reader.set_file_name(STUDY_FILE.c_str());
-    reader.open();
+    PackedGenotypeReader packed_reader;
+    bool packed = PackedGenotypeReader::can_read(STUDY_FILE); // VCF files are decoded into the same 2-bit codes
+    if (packed) {
+        packed_reader.set_file_name(STUDY_FILE);
+        packed_reader.open();
+    } else {
+        reader.set_file_name(STUDY_FILE.c_str());
+        reader.open();
+    }
 
 	//==== Open output file ====
-	outfile = OUT_PREFIX;
-	outfile.append(".ProPC.coord");
+	outfile = output_file_name(".ProPC.coord");
 	fout.open(outfile.c_str());
 	if(fout.fail()) {
 		delete [] RefInfo1;
@@ -799,26 +1013,57 @@ int main(int argc, char* argv[]){
 		AUTO_MODE = true;
 	}
 
-	while (reader.read_row(tokens, '\t') >= 0) {
-	    ++row;
-	    if (row <= STUDY_NON_DATA_ROWS) { // skip header lines;
-	        continue;
+	if (packed) { // rows of packed files have fixed size, so there is nothing to skip
+	    i = FIRST_IND - 1;
+	} else if ((FIRST_IND > 1) && reader.seek_row(STUDY_NON_DATA_ROWS + FIRST_IND - 1)) { // jump to FIRST_IND using the row index
+	    row = STUDY_NON_DATA_ROWS + FIRST_IND - 1;
+	    i = FIRST_IND - 1;
+	}
+	while (packed ? (i < (int)packed_reader.get_n_samples()) : (reader.read_row(tokens, '\t') >= 0)) {
+	    const unsigned char* genotypes = nullptr;
+	    if (packed) {
+	        ++i;
+	        if (i > LAST_IND) {
+	            break;
+	        }
+	        genotypes = packed_reader.is_locus_major() ? nullptr : packed_reader.get_row(i - 1);
+	    } else {
+	        ++row;
+	        if (row <= STUDY_NON_DATA_ROWS) { // skip header lines;
+	            continue;
+	        }
+	        ++i;
+	        if (i < FIRST_IND) {
+	            continue;
+	        }
+	        if (i > LAST_IND) {
+	            break;
+	        }
 	    }
-	    ++i;
-        if (i < FIRST_IND) {
-            continue;
-        }
-        if (i > LAST_IND) {
-            break;
-        }
-        string Info1 = tokens[0];
-		string Info2 = tokens[1];
-		frowvec tmpG(LOCI_S);
+        string Info1 = packed ? packed_reader.get_population_id(i - 1) : string(tokens[0]);
+		string Info2 = packed ? packed_reader.get_individual_id(i - 1) : string(tokens[1]);
 		frowvec G_one(LOCI);
 		int Lm = 0;           // Number of loci that are missing data
+		int genotype = 0;
 
         for (j = 0; j < LOCI; ++j) {
-            G_one(j) =  stof(tokens.at(STUDY_NON_DATA_COLS + cmnS(j)));
+            if (packed && (genotypes == nullptr)) { // locus-major file: the sample is at the same position in every locus
+                G_one(j) = PackedGenotypeReader::get_value(packed_reader.get_locus(cmnS(j)), i - 1);
+            } else if (packed) {
+                G_one(j) = PackedGenotypeReader::get_value(genotypes, cmnS(j));
+            } else if (TableReader::parse_genotype(tokens.at(STUDY_NON_DATA_COLS + cmnS(j)), genotype)) {
+                G_one(j) = genotype;
+            } else {
+                cerr << "Error: invalid value '" << tokens[STUDY_NON_DATA_COLS + cmnS(j)] << "' in (row " << row << ", column " << STUDY_NON_DATA_COLS + cmnS(j) << ") in the file '" << STUDY_FILE << "'." << endl;
+                foutLog << "Error: invalid value '" << tokens[STUDY_NON_DATA_COLS + cmnS(j)] << "' in (row " << row << ", column " << STUDY_NON_DATA_COLS + cmnS(j) << ") in the file '" << STUDY_FILE << "'." << endl;
+                fout.close();
+                reader.close();
+                delete [] RefInfo1;
+                delete [] RefInfo2;
+                foutLog.close();
+                gsl_rng_free(rng);
+                return 1;
+            }
             if (G_one(j) == -9) {
                 Lm++;
             } else if (MASK_PROP > 0) {
@@ -983,6 +1228,7 @@ int main(int argc, char* argv[]){
 	delete [] RefInfo2;
 
 	reader.close();
+	packed_reader.close();
 
 	fout.close();
 	cout << "Procrustean PCA coordinates are output to '" << outfile << "'." << endl;
@@ -1026,6 +1272,8 @@ bool parse_cmd_line(int argc, char* argv[], map<string,string> &args, map<string
 	argi[ARG_RANDOM_SEED] = default_int;
 	argi[ARG_KNN_ZSCORE] = default_int;
 	argi[ARG_NUM_THREADS] = default_int;
+	argi[ARG_COMPRESS_OUTPUT] = default_int;
+	args[ARG_REF_SNAPSHOT] = default_str;
 	
 	for(int i = 1; i < argc-1; i++){
 		if(args.count(argv[i]) > 0){
@@ -1102,10 +1350,23 @@ int normalize(fmat &G, fmat &Gm, fmat &Gsd){
 		}
 	}
 	Gsd = stddev(G, 0);
+	standardize(G, Gm, Gsd);
+	return 1;
+}
+//############## Center and scale genotypes with given means and SDs (missing genotypes are set to the mean) ##############
+int standardize(fmat &G, const fmat &Gm, const fmat &Gsd){
+	int i=0;
+	int N = G.n_rows;
+	int L = G.n_cols;
  	for (int j = 0; j < L; j++){
 		if (Gsd(j) == 0) {    // Monophmorphic sites are set to 0
 			G.col(j) = zeros<fvec>(N);
 		} else {
+			for (i = 0; i < N; i++) {
+				if (G(i,j) == -9) {
+					G(i,j) = Gm(j);
+				}
+			}
 			G.col(j) = (G.col(j) - Gm(j)) / Gsd(j);
 		}
 	}
@@ -1249,6 +1510,10 @@ int create_paramfile(string filename){
 	fout << endl << "KNN_ZSCORE         # Number of nearest neigbors used to calculate the Z score for each study individual (must be an integer >2; default 10)" <<endl;
 	fout << endl << "RANDOM_SEED        # Seed for the random number generator in the program (must be a non-negative integer; default 0)" <<endl;
 	fout << endl << "NUM_THREADS        # Number of CPU cores for multi-threading parallel analysis (must be a positive integer; default 8)" <<endl; 
+	fout << endl << "COMPRESS_OUTPUT    # Compress output files with BGZF and add '.gz' to their names (must be 0 or 1; default 0)" <<endl;
+	fout << endl << "REF_SNAPSHOT       # File name of the reference panel snapshot (include path if in a different directory)" <<endl;
+	fout <<         "                   # The snapshot is used if it matches GENO_FILE, COORD_FILE, DIM and the selected loci and reference individuals;" <<endl;
+	fout <<         "                   # otherwise it is (re)written from the loaded reference panel" <<endl;
 	
  	fout << "\n\n" << "###----Command line arguments----###" <<endl <<endl;
 	fout << "# -p     parameterfile (this file)" <<endl;
@@ -1271,6 +1536,8 @@ int create_paramfile(string filename){
 	fout << "# -knn   KNN_ZSCORE" << endl;
 	fout << "# -seed  RANDOM_SEED" << endl;
 	fout << "# -nt    NUM_THREADS" << endl;
+	fout << "# -gz    COMPRESS_OUTPUT" << endl;
+	fout << "# -rs    REF_SNAPSHOT" << endl;
 	
 	fout << "\n" << "###----End of file----###";
 	fout.close();
@@ -1573,6 +1840,33 @@ int read_paramfile(string filename){
 			}else{
 				getline(fin, str);
 			}			
+		}else if(str.compare("REF_SNAPSHOT")==0){
+			fin>>str;
+			if(str[0]!='#'){
+				if(REF_SNAPSHOT == default_str){
+					REF_SNAPSHOT = str;
+				}
+			}else{
+				getline(fin, str);
+			}				
+		}else if(str.compare("COMPRESS_OUTPUT")==0){
+			fin>>str;
+			if(str[0]!='#'){
+				if(is_int(str) && (atoi(str.c_str())==0 || atoi(str.c_str())==1)){
+					if(COMPRESS_OUTPUT == default_int){
+						COMPRESS_OUTPUT = atoi(str.c_str());
+					}
+				}else{
+					if(COMPRESS_OUTPUT != default_int){
+						cerr<< "Warning: COMPRESS_OUTPUT in the parameter file is not 0 or 1." <<endl;
+						foutLog<< "Warning: COMPRESS_OUTPUT in the parameter file is not 0 or 1." <<endl;
+					}else{
+						COMPRESS_OUTPUT = default_int-1;
+					}
+				}
+			}else{
+				getline(fin, str);
+			}
 		}else if(str.compare("NUM_THREADS")==0){
 			fin>>str;
 			if(str[0]!='#'){
@@ -1634,6 +1928,12 @@ void print_configuration(){
 	cout << "KNN_ZSCORE (-knn)" << "\t" << KNN_ZSCORE << endl;
 	cout << "RANDOM_SEED (-seed)" << "\t" << RANDOM_SEED << endl;
 	cout << "NUM_THREADS (-nt)" << "\t" << NUM_THREADS << endl;
+	if(COMPRESS_OUTPUT>0){
+		cout << "COMPRESS_OUTPUT (-gz)" << "\t" << COMPRESS_OUTPUT << endl;
+	}
+	if(REF_SNAPSHOT.compare(default_str)!=0){
+		cout << "REF_SNAPSHOT (-rs)" << "\t" << REF_SNAPSHOT << endl;
+	}
 	cout << "-------------------------------------------------" << endl; 
 
 	foutLog <<endl << "Parameter values used in execution:" <<endl;
@@ -1672,6 +1972,12 @@ void print_configuration(){
 	foutLog << "KNN_ZSCORE (-knn)" << "\t" << KNN_ZSCORE << endl;
 	foutLog << "RANDOM_SEED (-seed)" << "\t" << RANDOM_SEED << endl;
 	foutLog << "NUM_THREADS (-nt)" << "\t" << NUM_THREADS << endl;
+	if(COMPRESS_OUTPUT>0){
+		foutLog << "COMPRESS_OUTPUT (-gz)" << "\t" << COMPRESS_OUTPUT << endl;
+	}
+	if(REF_SNAPSHOT.compare(default_str)!=0){
+		foutLog << "REF_SNAPSHOT (-rs)" << "\t" << REF_SNAPSHOT << endl;
+	}
 	foutLog << "-------------------------------------------------" << endl; 
 }
 //################# Function to check parameter values  ##################
@@ -1839,7 +2145,20 @@ int check_parameters(){
 		cerr << "Error: invalid value for NUM_THREADS (-nt)." << endl;
 		foutLog << "Error: invalid value for NUM_THREADS (-nt)." << endl;
 		flag = 0;
+	}
+	if(COMPRESS_OUTPUT!=0 && COMPRESS_OUTPUT!=1){
+		cerr << "Error: invalid value for COMPRESS_OUTPUT (-gz)." << endl;
+		foutLog << "Error: invalid value for COMPRESS_OUTPUT (-gz)." << endl;
+		flag = 0;
 	}	
 	//============================================================================
 	return flag;
 }
+//############## Name of an output file: OUT_PREFIX + suffix (+ ".gz" if the output is compressed) ##############
+string output_file_name(const string& suffix){
+	string filename = OUT_PREFIX + suffix;
+	if(COMPRESS_OUTPUT==1){
+		filename.append(OutputWriter::EXTENSION);
+	}
+	return filename;
+}
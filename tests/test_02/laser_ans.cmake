@@ -1,4 +1,4 @@
-execute_process(COMMAND ${LASER} -g ${GENO_REF} -c ${COORD_REF} -s ${SEQ_STUDY} -o test_laser RESULT_VARIABLE laser_exit_code)
+execute_process(COMMAND ${LASER} -g ${GENO_REF} -c ${COORD_REF} -s ${SEQ_STUDY} -nt 1 -o test_laser RESULT_VARIABLE laser_exit_code)
 if(laser_exit_code)
    message(FATAL_ERROR "LASER failed.")
 endif()
@@ -0,0 +1,15 @@
+# with more than one thread every sample has its own generator, so the results must not depend on the number of threads
+execute_process(COMMAND ${LASER} -g ${GENO_REF} -c ${COORD_REF} -s ${SEQ_STUDY} -nt 2 -o test_laser_nt2 RESULT_VARIABLE laser_exit_code)
+if(laser_exit_code)
+   message(FATAL_ERROR "LASER failed.")
+endif()
+
+execute_process(COMMAND ${LASER} -g ${GENO_REF} -c ${COORD_REF} -s ${SEQ_STUDY} -nt 4 -o test_laser_nt4 RESULT_VARIABLE laser_exit_code)
+if(laser_exit_code)
+   message(FATAL_ERROR "LASER failed.")
+endif()
+
+execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files test_laser_nt2.SeqPC.coord test_laser_nt4.SeqPC.coord RESULT_VARIABLE test_exit_code)
+if(test_exit_code)
+   message(FATAL_ERROR "LASER results depend on the number of threads.")
+endif()
\ No newline at end of file
@@ -0,0 +1,26 @@
+file(REMOVE test_laser.snapshot)
+
+execute_process(COMMAND ${LASER} -g ${GENO_REF} -c ${COORD_REF} -s ${SEQ_STUDY} -rs test_laser.snapshot -o test_laser_rs1 RESULT_VARIABLE laser_exit_code)
+if(laser_exit_code)
+   message(FATAL_ERROR "LASER failed.")
+endif()
+if(NOT EXISTS test_laser.snapshot)
+   message(FATAL_ERROR "LASER didn't write the reference panel snapshot.")
+endif()
+
+execute_process(COMMAND ${LASER} -g ${GENO_REF} -c ${COORD_REF} -s ${SEQ_STUDY} -rs test_laser.snapshot -o test_laser_rs2 RESULT_VARIABLE laser_exit_code)
+if(laser_exit_code)
+   message(FATAL_ERROR "LASER failed.")
+endif()
+
+file(READ test_laser_rs2.log laser_log)
+string(FIND "${laser_log}" "Reference panel snapshot 'test_laser.snapshot' matches the GENO_FILE." snapshot_loaded)
+string(FIND "${laser_log}" "Reference panel snapshot is output" snapshot_written)
+if((snapshot_loaded EQUAL -1) OR NOT (snapshot_written EQUAL -1))
+   message(FATAL_ERROR "LASER didn't load the reference panel snapshot.")
+endif()
+
+execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files test_laser_rs1.SeqPC.coord test_laser_rs2.SeqPC.coord RESULT_VARIABLE test_exit_code)
+if(test_exit_code)
+   message(FATAL_ERROR "LASER didn't replicate results with the reference panel snapshot.")
+endif()
\ No newline at end of file
@@ -0,0 +1,28 @@
+# input/*.vcf have the genotypes of input/*.geno; the genotypes that are -9 in input/*.geno are missing, haploid or
+# multi-allelic in input/*.vcf, so the results must be the same
+foreach(format geno vcf)
+   execute_process(COMMAND ${LASER} -g input/HGDP_30_chr22.${format} -k 4 -pca 1 -o test_pca_${format} RESULT_VARIABLE laser_exit_code)
+   if(laser_exit_code)
+      message(FATAL_ERROR "LASER failed.")
+   endif()
+
+   execute_process(COMMAND ${TRACE} -g input/HGDP_30_chr22.${format} -s input/HGDP_10_chr22.${format} -k 4 -o test_trace_${format} RESULT_VARIABLE trace_exit_code)
+   if(trace_exit_code)
+      message(FATAL_ERROR "TRACE failed.")
+   endif()
+endforeach()
+
+execute_process(COMMAND ${TESTLASER} compare_tables test_pca_geno.RefPC.coord test_pca_vcf.RefPC.coord ssffff 0.0001 RESULT_VARIABLE test_exit_code)
+if(test_exit_code)
+   message(FATAL_ERROR "LASER results differ for GENO and VCF files.")
+endif()
+
+execute_process(COMMAND ${TESTLASER} compare_tables test_trace_geno.ProPC.coord test_trace_vcf.ProPC.coord ssddffff 0.0001 RESULT_VARIABLE test_exit_code)
+if(test_exit_code)
+   message(FATAL_ERROR "TRACE results differ for GENO and VCF files: *.ProPC.coord files differ")
+endif()
+
+execute_process(COMMAND ${TESTLASER} compare_tables test_trace_geno.RefPC.coord test_trace_vcf.RefPC.coord ssffff 0.0001 RESULT_VARIABLE test_exit_code)
+if(test_exit_code)
+   message(FATAL_ERROR "TRACE results differ for GENO and VCF files: *.RefPC.coord files differ")
+endif()
\ No newline at end of file
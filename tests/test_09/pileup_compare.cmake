@@ -0,0 +1,16 @@
+# good/pileup.seq was made by pileup2seq.py from input/*.pileup and input/pileup.site, with the inserted and deleted
+# sequences removed from the pileups beforehand, because pileup2seq.py counts them as read bases
+execute_process(COMMAND ${LASERTOOLS} sparse -sites input/pileup.site input/NA12878.pileup,input/sample2.pileup test_pileup.sseq RESULT_VARIABLE lasertools_exit_code)
+if(lasertools_exit_code)
+   message(FATAL_ERROR "lasertools failed.")
+endif()
+
+execute_process(COMMAND ${LASERTOOLS} sparse good/pileup.seq test_seq.sseq RESULT_VARIABLE lasertools_exit_code)
+if(lasertools_exit_code)
+   message(FATAL_ERROR "lasertools failed.")
+endif()
+
+execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files test_pileup.sseq test_seq.sseq RESULT_VARIABLE test_exit_code)
+if(test_exit_code)
+   message(FATAL_ERROR "Pileup files and pileup2seq.py output differ.")
+endif()
\ No newline at end of file
@@ -0,0 +1,21 @@
+execute_process(COMMAND ${LASER} -g ${GENO_REF} -c ${COORD_REF} -s ${SEQ_STUDY} -o test_dense RESULT_VARIABLE laser_exit_code)
+if(laser_exit_code)
+   message(FATAL_ERROR "LASER failed.")
+endif()
+
+foreach(format sseq bseq)
+   execute_process(COMMAND ${LASERTOOLS} sparse ${SEQ_STUDY} test_sparse.${format} RESULT_VARIABLE lasertools_exit_code)
+   if(lasertools_exit_code)
+      message(FATAL_ERROR "lasertools failed.")
+   endif()
+
+   execute_process(COMMAND ${LASER} -g ${GENO_REF} -c ${COORD_REF} -s test_sparse.${format} -o test_${format} RESULT_VARIABLE laser_exit_code)
+   if(laser_exit_code)
+      message(FATAL_ERROR "LASER failed.")
+   endif()
+
+   execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files test_dense.SeqPC.coord test_${format}.SeqPC.coord RESULT_VARIABLE test_exit_code)
+   if(test_exit_code)
+      message(FATAL_ERROR "LASER results differ for SEQ and ${format} files.")
+   endif()
+endforeach()
\ No newline at end of file
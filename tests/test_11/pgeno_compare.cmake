@@ -0,0 +1,66 @@
+execute_process(COMMAND ${LASERTOOLS} pack ${GENO_REF} test_ref.pgeno RESULT_VARIABLE lasertools_exit_code)
+if(lasertools_exit_code)
+   message(FATAL_ERROR "lasertools failed.")
+endif()
+
+execute_process(COMMAND ${LASERTOOLS} pack ${GENO_STUDY} test_study.pgeno RESULT_VARIABLE lasertools_exit_code)
+if(lasertools_exit_code)
+   message(FATAL_ERROR "lasertools failed.")
+endif()
+
+# locus-major files, with which laser -pca 1 reads the reference panel block by block
+execute_process(COMMAND ${LASERTOOLS} pack -loci ${GENO_REF} test_ref_loci.pgeno RESULT_VARIABLE lasertools_exit_code)
+if(lasertools_exit_code)
+   message(FATAL_ERROR "lasertools failed.")
+endif()
+
+execute_process(COMMAND ${LASERTOOLS} pack -loci ${GENO_STUDY} test_study_loci.pgeno RESULT_VARIABLE lasertools_exit_code)
+if(lasertools_exit_code)
+   message(FATAL_ERROR "lasertools failed.")
+endif()
+
+# every program runs on the text files and on the packed files
+foreach(input geno pgeno loci)
+   if(input STREQUAL "geno")
+      set(ref ${GENO_REF})
+      set(study ${GENO_STUDY})
+   elseif(input STREQUAL "pgeno")
+      set(ref test_ref.pgeno)
+      set(study test_study.pgeno)
+   else()
+      set(ref test_ref_loci.pgeno)
+      set(study test_study_loci.pgeno)
+   endif()
+
+   execute_process(COMMAND ${LASER} -g ${ref} -k 4 -pca 1 -o test_pca_${input} RESULT_VARIABLE laser_exit_code)
+   if(laser_exit_code)
+      message(FATAL_ERROR "LASER failed.")
+   endif()
+
+   execute_process(COMMAND ${LASER} -g ${ref} -c ${COORD_REF} -s ${SEQ_STUDY} -o test_laser_${input} RESULT_VARIABLE laser_exit_code)
+   if(laser_exit_code)
+      message(FATAL_ERROR "LASER failed.")
+   endif()
+
+   execute_process(COMMAND ${TRACE} -g ${ref} -s ${study} -k 4 -x 1 -y 50 -o test_trace_${input} RESULT_VARIABLE trace_exit_code)
+   if(trace_exit_code)
+      message(FATAL_ERROR "TRACE failed.")
+   endif()
+endforeach()
+
+foreach(input pgeno loci)
+   execute_process(COMMAND ${TESTLASER} compare_tables test_pca_geno.RefPC.coord test_pca_${input}.RefPC.coord ssffff 0.0001 RESULT_VARIABLE test_exit_code)
+   if(test_exit_code)
+      message(FATAL_ERROR "LASER PCA results differ for GENO and ${input} files.")
+   endif()
+
+   execute_process(COMMAND ${TESTLASER} compare_tables test_laser_geno.SeqPC.coord test_laser_${input}.SeqPC.coord ssdfdffff 0.0001 RESULT_VARIABLE test_exit_code)
+   if(test_exit_code)
+      message(FATAL_ERROR "LASER results differ for GENO and ${input} files.")
+   endif()
+
+   execute_process(COMMAND ${TESTLASER} compare_tables test_trace_geno.ProPC.coord test_trace_${input}.ProPC.coord ssddffff 0.0001 RESULT_VARIABLE test_exit_code)
+   if(test_exit_code)
+      message(FATAL_ERROR "TRACE results differ for GENO and ${input} files.")
+   endif()
+endforeach()
\ No newline at end of file
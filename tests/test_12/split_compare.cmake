@@ -0,0 +1,84 @@
+string(REGEX REPLACE "\\.geno$" ".site" GENO_REF_SITE ${GENO_REF})
+string(REGEX REPLACE "\\.seq$" ".site" SEQ_STUDY_SITE ${SEQ_STUDY})
+
+# files are split by columns into files with the same samples and their own site files
+foreach(input ref seq)
+   if(input STREQUAL "ref")
+      set(table ${GENO_REF})
+      set(sites ${GENO_REF_SITE})
+      set(extension geno)
+   else()
+      set(table ${SEQ_STUDY})
+      set(sites ${SEQ_STUDY_SITE})
+      set(extension seq)
+   endif()
+   execute_process(COMMAND ${TESTLASER} split_columns ${table} 2 4000 test_${input}_1.${extension} test_${input}_2.${extension} RESULT_VARIABLE test_exit_code)
+   if(test_exit_code)
+      message(FATAL_ERROR "Can't split '${table}'.")
+   endif()
+   execute_process(COMMAND ${TESTLASER} split_rows ${sites} 1 4000 test_${input}_1.site test_${input}_2.site RESULT_VARIABLE test_exit_code)
+   if(test_exit_code)
+      message(FATAL_ERROR "Can't split '${sites}'.")
+   endif()
+endforeach()
+
+execute_process(COMMAND ${LASER} -g ${GENO_REF} -c ${COORD_REF} -s ${SEQ_STUDY} -o test_single RESULT_VARIABLE laser_exit_code)
+if(laser_exit_code)
+   message(FATAL_ERROR "LASER failed.")
+endif()
+
+execute_process(COMMAND ${LASER} -g test_ref_1.geno,test_ref_2.geno -c ${COORD_REF} -s test_seq_1.seq,test_seq_2.seq -o test_split RESULT_VARIABLE laser_exit_code)
+if(laser_exit_code)
+   message(FATAL_ERROR "LASER failed.")
+endif()
+
+execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files test_single.SeqPC.coord test_split.SeqPC.coord RESULT_VARIABLE test_exit_code)
+if(test_exit_code)
+   message(FATAL_ERROR "LASER results differ for single and split files.")
+endif()
+
+# coverage is added up from the rows of every split SEQ file while the files are scanned
+execute_process(COMMAND ${LASER} -g ${GENO_REF} -s ${SEQ_STUDY} -cov 2 -o test_cov_single RESULT_VARIABLE laser_exit_code)
+if(laser_exit_code)
+   message(FATAL_ERROR "LASER failed.")
+endif()
+
+execute_process(COMMAND ${LASER} -g test_ref_1.geno,test_ref_2.geno -s test_seq_1.seq,test_seq_2.seq -cov 2 -o test_cov_split RESULT_VARIABLE laser_exit_code)
+if(laser_exit_code)
+   message(FATAL_ERROR "LASER failed.")
+endif()
+
+foreach(coverage ind.cov loc.cov)
+   execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files test_cov_single.${coverage} test_cov_split.${coverage} RESULT_VARIABLE test_exit_code)
+   if(test_exit_code)
+      message(FATAL_ERROR "LASER coverage differs for single and split files: *.${coverage} files differ")
+   endif()
+endforeach()
+
+# files with fewer rows or other sample IDs are rejected
+execute_process(COMMAND ${TESTLASER} split_rows test_ref_2.geno 0 200 test_ref_short.geno test_ref_rest.geno RESULT_VARIABLE test_exit_code)
+if(test_exit_code)
+   message(FATAL_ERROR "Can't split 'test_ref_2.geno'.")
+endif()
+file(READ test_ref_2.site sites)
+file(WRITE test_ref_short.site "${sites}")
+
+execute_process(COMMAND ${LASER} -g test_ref_1.geno,test_ref_short.geno -c ${COORD_REF} -s ${SEQ_STUDY} -o test_rows
+        RESULT_VARIABLE laser_exit_code OUTPUT_VARIABLE laser_output ERROR_VARIABLE laser_output)
+string(FIND "${laser_output}" "Files 'test_ref_1.geno' and 'test_ref_short.geno' have different numbers of rows." error_found)
+if((NOT laser_exit_code) OR (error_found EQUAL -1))
+   message(FATAL_ERROR "LASER didn't report files with different numbers of rows.")
+endif()
+
+file(READ test_seq_2.seq samples)
+string(REPLACE "NA12892" "NA99999" samples "${samples}")
+file(WRITE test_seq_ids.seq "${samples}")
+file(READ test_seq_2.site sites)
+file(WRITE test_seq_ids.site "${sites}")
+
+execute_process(COMMAND ${LASER} -g ${GENO_REF} -c ${COORD_REF} -s test_seq_1.seq,test_seq_ids.seq -o test_ids
+        RESULT_VARIABLE laser_exit_code OUTPUT_VARIABLE laser_output ERROR_VARIABLE laser_output)
+string(FIND "${laser_output}" "Sample IDs in row 2 of 'test_seq_ids.seq' don't match 'test_seq_1.seq'." error_found)
+if((NOT laser_exit_code) OR (error_found EQUAL -1))
+   message(FATAL_ERROR "LASER didn't report files with different sample IDs.")
+endif()
\ No newline at end of file
@@ -0,0 +1,68 @@
+# rows FIRST_IND..LAST_IND of a run without index are compared with a run that jumps to FIRST_IND with the row index
+string(REGEX REPLACE "\\.geno$" ".site" GENO_STUDY_SITE ${GENO_STUDY})
+get_filename_component(study ${GENO_STUDY} NAME)
+file(REMOVE ${study}.ridx)
+file(COPY ${GENO_STUDY} ${GENO_STUDY_SITE} DESTINATION .)
+
+execute_process(COMMAND ${TRACE} -g ${GENO_REF} -s ${study} -k 4 -x 1 -y 60 -o test_trace_all RESULT_VARIABLE trace_exit_code)
+if(trace_exit_code)
+   message(FATAL_ERROR "TRACE failed.")
+endif()
+
+execute_process(COMMAND ${LASERTOOLS} index ${study} RESULT_VARIABLE lasertools_exit_code)
+if((lasertools_exit_code) OR (NOT EXISTS ${study}.ridx))
+   message(FATAL_ERROR "lasertools failed.")
+endif()
+
+execute_process(COMMAND ${TRACE} -g ${GENO_REF} -s ${study} -k 4 -x 41 -y 60 -o test_trace_indexed RESULT_VARIABLE trace_exit_code)
+if(trace_exit_code)
+   message(FATAL_ERROR "TRACE failed.")
+endif()
+
+execute_process(COMMAND ${TESTLASER} split_rows test_trace_all.ProPC.coord 1 40 test_trace_1_40.ProPC.coord test_trace_41_60.ProPC.coord RESULT_VARIABLE test_exit_code)
+if(test_exit_code)
+   message(FATAL_ERROR "Can't split 'test_trace_all.ProPC.coord'.")
+endif()
+
+execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files test_trace_41_60.ProPC.coord test_trace_indexed.ProPC.coord RESULT_VARIABLE test_exit_code)
+if(test_exit_code)
+   message(FATAL_ERROR "TRACE results differ with the row index of the STUDY_FILE.")
+endif()
+
+# plain and bgzip-compressed sparse SEQ files
+foreach(format sseq sseq.gz)
+   file(REMOVE test_seq.${format}.ridx)
+   execute_process(COMMAND ${LASERTOOLS} sparse ${SEQ_STUDY} test_seq.${format} RESULT_VARIABLE lasertools_exit_code)
+   if(lasertools_exit_code)
+      message(FATAL_ERROR "lasertools failed.")
+   endif()
+
+   execute_process(COMMAND ${LASER} -g ${GENO_REF} -c ${COORD_REF} -s test_seq.${format} -o test_laser_all RESULT_VARIABLE laser_exit_code)
+   if(laser_exit_code)
+      message(FATAL_ERROR "LASER failed.")
+   endif()
+
+   execute_process(COMMAND ${LASERTOOLS} index test_seq.${format} RESULT_VARIABLE lasertools_exit_code)
+   if((lasertools_exit_code) OR (NOT EXISTS test_seq.${format}.ridx))
+      message(FATAL_ERROR "lasertools failed.")
+   endif()
+
+   execute_process(COMMAND ${LASER} -g ${GENO_REF} -c ${COORD_REF} -s test_seq.${format} -x 3 -y 5 -o test_laser_indexed RESULT_VARIABLE laser_exit_code)
+   if(laser_exit_code)
+      message(FATAL_ERROR "LASER failed.")
+   endif()
+
+   execute_process(COMMAND ${TESTLASER} split_rows test_laser_all.SeqPC.coord 1 2 test_laser_1_2.SeqPC.coord test_laser_3_6.SeqPC.coord RESULT_VARIABLE test_exit_code)
+   if(test_exit_code)
+      message(FATAL_ERROR "Can't split 'test_laser_all.SeqPC.coord'.")
+   endif()
+   execute_process(COMMAND ${TESTLASER} split_rows test_laser_3_6.SeqPC.coord 1 3 test_laser_3_5.SeqPC.coord test_laser_6.SeqPC.coord RESULT_VARIABLE test_exit_code)
+   if(test_exit_code)
+      message(FATAL_ERROR "Can't split 'test_laser_3_6.SeqPC.coord'.")
+   endif()
+
+   execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files test_laser_3_5.SeqPC.coord test_laser_indexed.SeqPC.coord RESULT_VARIABLE test_exit_code)
+   if(test_exit_code)
+      message(FATAL_ERROR "LASER results differ with the row index of the ${format} SEQ_FILE.")
+   endif()
+endforeach()
\ No newline at end of file
@@ -0,0 +1,32 @@
+# output of a run with COMPRESS_OUTPUT 1 is read back through TableReader and compared with the plain text output
+execute_process(COMMAND ${LASER} -g ${GENO_REF} -s ${SEQ_STUDY} -k 4 -o test_laser_plain RESULT_VARIABLE laser_exit_code)
+if(laser_exit_code)
+   message(FATAL_ERROR "LASER failed.")
+endif()
+
+execute_process(COMMAND ${LASER} -g ${GENO_REF} -s ${SEQ_STUDY} -k 4 -gz 1 -o test_laser_gz RESULT_VARIABLE laser_exit_code)
+if(laser_exit_code)
+   message(FATAL_ERROR "LASER failed.")
+endif()
+
+foreach(suffix RefPC.coord RefPC.var SeqPC.coord)
+   if(NOT EXISTS test_laser_gz.${suffix}.gz)
+      message(FATAL_ERROR "LASER didn't write 'test_laser_gz.${suffix}.gz'.")
+   endif()
+
+   # gzip magic bytes and the extra field flag of BGZF blocks
+   file(READ test_laser_gz.${suffix}.gz magic LIMIT 4 HEX)
+   if(NOT magic STREQUAL "1f8b0804")
+      message(FATAL_ERROR "'test_laser_gz.${suffix}.gz' is not BGZF-compressed.")
+   endif()
+
+   execute_process(COMMAND ${TESTLASER} read_table test_laser_gz.${suffix}.gz test_laser_gz.${suffix} RESULT_VARIABLE test_exit_code)
+   if(test_exit_code)
+      message(FATAL_ERROR "Can't read 'test_laser_gz.${suffix}.gz'.")
+   endif()
+
+   execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files test_laser_plain.${suffix} test_laser_gz.${suffix} RESULT_VARIABLE test_exit_code)
+   if(test_exit_code)
+      message(FATAL_ERROR "LASER results differ in the compressed ${suffix} file.")
+   endif()
+endforeach()
\ No newline at end of file
@@ -0,0 +1,63 @@
+# the first run writes the binary cache of the SEQ_FILE, the next runs use it unless the SEQ_FILE has changed since
+string(REGEX REPLACE "\\.seq$" ".site" SEQ_STUDY_SITE ${SEQ_STUDY})
+get_filename_component(study ${SEQ_STUDY} NAME)
+file(REMOVE ${study}.seqcache)
+file(COPY ${SEQ_STUDY} ${SEQ_STUDY_SITE} DESTINATION .)
+
+execute_process(COMMAND ${LASER} -g ${GENO_REF} -c ${COORD_REF} -s ${study} -o test_laser_first RESULT_VARIABLE laser_exit_code)
+if(laser_exit_code)
+   message(FATAL_ERROR "LASER failed.")
+endif()
+if(NOT EXISTS ${study}.seqcache)
+   message(FATAL_ERROR "LASER didn't write '${study}.seqcache'.")
+endif()
+file(READ test_laser_first.log log)
+if(log MATCHES "Using binary cache")
+   message(FATAL_ERROR "LASER used a binary cache in the first run.")
+endif()
+
+execute_process(COMMAND ${LASER} -g ${GENO_REF} -c ${COORD_REF} -s ${study} -o test_laser_cached RESULT_VARIABLE laser_exit_code)
+if(laser_exit_code)
+   message(FATAL_ERROR "LASER failed.")
+endif()
+file(READ test_laser_cached.log log)
+if(NOT log MATCHES "Using binary cache '${study}\\.seqcache' of the SEQ_FILE\\.")
+   message(FATAL_ERROR "LASER didn't use '${study}.seqcache'.")
+endif()
+
+execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files test_laser_first.SeqPC.coord test_laser_cached.SeqPC.coord RESULT_VARIABLE test_exit_code)
+if(test_exit_code)
+   message(FATAL_ERROR "LASER results differ with the binary cache of the SEQ_FILE.")
+endif()
+
+# modification time of the SEQ_FILE is kept in the cache with 1 second precision
+execute_process(COMMAND ${CMAKE_COMMAND} -E sleep 1)
+execute_process(COMMAND ${CMAKE_COMMAND} -E touch ${study})
+
+execute_process(COMMAND ${LASER} -g ${GENO_REF} -c ${COORD_REF} -s ${study} -o test_laser_stale RESULT_VARIABLE laser_exit_code)
+if(laser_exit_code)
+   message(FATAL_ERROR "LASER failed.")
+endif()
+file(READ test_laser_stale.log log)
+if(log MATCHES "Using binary cache")
+   message(FATAL_ERROR "LASER used '${study}.seqcache' after the SEQ_FILE has changed.")
+endif()
+
+execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files test_laser_first.SeqPC.coord test_laser_stale.SeqPC.coord RESULT_VARIABLE test_exit_code)
+if(test_exit_code)
+   message(FATAL_ERROR "LASER results differ after the binary cache of the SEQ_FILE got stale.")
+endif()
+
+execute_process(COMMAND ${LASER} -g ${GENO_REF} -c ${COORD_REF} -s ${study} -o test_laser_rebuilt RESULT_VARIABLE laser_exit_code)
+if(laser_exit_code)
+   message(FATAL_ERROR "LASER failed.")
+endif()
+file(READ test_laser_rebuilt.log log)
+if(NOT log MATCHES "Using binary cache '${study}\\.seqcache' of the SEQ_FILE\\.")
+   message(FATAL_ERROR "LASER didn't rebuild '${study}.seqcache'.")
+endif()
+
+execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files test_laser_first.SeqPC.coord test_laser_rebuilt.SeqPC.coord RESULT_VARIABLE test_exit_code)
+if(test_exit_code)
+   message(FATAL_ERROR "LASER results differ with the rebuilt binary cache of the SEQ_FILE.")
+endif()
\ No newline at end of file
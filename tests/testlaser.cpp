@@ -10,6 +10,8 @@
 #include <vector>
 #include <utility>
 #include <cmath>
+#include <cstring>
+#include "TableReader.h"
 
 using namespace std;
 
@@ -146,6 +148,85 @@ int test_propc(const char* file_name1, const char* file_name2, const char* colum
     return 0;
 }
 
+// Splits a table by columns: both output tables get the index columns, the first one gets the next data_columns columns
+// and the second one the rest.
+int split_columns(const char* file_name, int index_columns, int data_columns, const char* output_file_name1, const char* output_file_name2) {
+    ifstream ifile_stream(file_name, ios::binary);
+    ofstream ofile_stream1(output_file_name1, ios::binary);
+    ofstream ofile_stream2(output_file_name2, ios::binary);
+    string line("");
+
+    if (ifile_stream.fail() || ofile_stream1.fail() || ofile_stream2.fail()) {
+        return 1;
+    }
+    while (getline(ifile_stream, line)) {
+        stringstream ss(line);
+        string token;
+        for (int i = 0; getline(ss, token, '\t'); ++i) {
+            if (i < index_columns) {
+                ofile_stream1 << (i > 0 ? "\t" : "") << token;
+                ofile_stream2 << (i > 0 ? "\t" : "") << token;
+            } else if (i < index_columns + data_columns) {
+                ofile_stream1 << (i > 0 ? "\t" : "") << token;
+            } else {
+                ofile_stream2 << (i > 0 ? "\t" : "") << token;
+            }
+        }
+        ofile_stream1 << endl;
+        ofile_stream2 << endl;
+    }
+    return (ofile_stream1.fail() || ofile_stream2.fail()) ? 1 : 0;
+}
+
+// Splits a table by rows: both output tables get the header rows, the first one gets the next rows rows and the second
+// one the rest.
+int split_rows(const char* file_name, int header_rows, int rows, const char* output_file_name1, const char* output_file_name2) {
+    ifstream ifile_stream(file_name, ios::binary);
+    ofstream ofile_stream1(output_file_name1, ios::binary);
+    ofstream ofile_stream2(output_file_name2, ios::binary);
+    string line("");
+
+    if (ifile_stream.fail() || ofile_stream1.fail() || ofile_stream2.fail()) {
+        return 1;
+    }
+    for (int i = 0; getline(ifile_stream, line); ++i) {
+        if (i < header_rows) {
+            ofile_stream1 << line << endl;
+            ofile_stream2 << line << endl;
+        } else if (i < header_rows + rows) {
+            ofile_stream1 << line << endl;
+        } else {
+            ofile_stream2 << line << endl;
+        }
+    }
+    return (ofile_stream1.fail() || ofile_stream2.fail()) ? 1 : 0;
+}
+
+// Writes the rows of a plain or compressed table, as read by TableReader, to a plain text file.
+int read_table(const char* file_name, const char* output_file_name) {
+    TableReader reader;
+    ofstream ofile_stream(output_file_name, ios::binary);
+    vector<char*> tokens;
+
+    if (ofile_stream.fail()) {
+        return 1;
+    }
+    try {
+        reader.set_file_name(file_name);
+        reader.open();
+        while (reader.read_row(tokens, '\t') >= 0) {
+            for (size_t i = 0u; i < tokens.size(); ++i) {
+                ofile_stream << (i > 0u ? "\t" : "") << tokens[i];
+            }
+            ofile_stream << endl;
+        }
+        reader.close();
+    } catch (exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return ofile_stream.fail() ? 1 : 0;
+}
 
 int main(int argc, char** argv) {
     if (argc < 2) {
@@ -162,5 +243,29 @@ int main(int argc, char** argv) {
         }
         return test_propc(argv[2], argv[3], argv[4], atof(argv[5]));
     }
+    if ((strcmp(argv[1], "split_columns") == 0) || (strcmp(argv[1], "split_rows") == 0)) {
+        // Positional arguments:
+        //  2 - file name with the table
+        //  3 - number of index columns (split_columns) or header rows (split_rows)
+        //  4 - number of data columns or rows in the first output table
+        //  5 - file name of the first output table
+        //  6 - file name of the second output table
+        if (argc != 7) {
+            return 1;
+        }
+        if (strcmp(argv[1], "split_columns") == 0) {
+            return split_columns(argv[2], atoi(argv[3]), atoi(argv[4]), argv[5], argv[6]);
+        }
+        return split_rows(argv[2], atoi(argv[3]), atoi(argv[4]), argv[5], argv[6]);
+    }
+    if (strcmp(argv[1], "read_table") == 0) {
+        // Positional arguments:
+        //  2 - file name with the (possibly compressed) table
+        //  3 - file name of the plain text output table
+        if (argc != 4) {
+            return 1;
+        }
+        return read_table(argv[2], argv[3]);
+    }
     return 1;
 }
\ No newline at end of file